@@ -0,0 +1,52 @@
+// async_io.h
+// Асинхронный конвейер файлового ввода-вывода для библиотек шифрования
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// Преобразование очередной порции входного файла.
+// Порции передаются строго по порядку; все, кроме последней, имеют
+// размер chunkSize. В конце вызывается один раз с size == 0, чтобы
+// преобразование могло дописать накопленное состояние.
+typedef std::function<void(const uint8_t* data, size_t size, std::vector<uint8_t>& output)> ChunkTransform;
+
+// Потоковая обработка inputFile -> outputFile. Несколько чтений и записей
+// находятся в полете, пока transform выполняется в вызывающем потоке.
+// Возвращает объем прочитанных данных.
+// Бросает std::runtime_error при ошибках открытия, чтения или записи.
+uint64_t transformFileAsync(const std::string& inputFile, const std::string& outputFile,
+                            size_t chunkSize, const ChunkTransform& transform);
+
+// То же для уже открытых дескрипторов (например, stdin/stdout в конвейере).
+// Память ограничена несколькими порциями независимо от объема данных.
+// Дескрипторы не закрываются.
+uint64_t transformStreamAsync(int inFd, int outFd, size_t chunkSize, const ChunkTransform& transform);
+
+// Файловый дескриптор, закрываемый автоматически
+class FileDescriptor {
+public:
+    explicit FileDescriptor(int fd) : fd(fd) {}
+    ~FileDescriptor() { if (fd >= 0) close(fd); }
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    int get() const { return fd; }
+private:
+    int fd;
+};
+
+// Позиционные чтение и запись ровно size байт для задач пула потоков;
+// бросают std::runtime_error
+void preadFull(int fd, uint8_t* buffer, size_t size, uint64_t offset);
+void pwriteFull(int fd, const uint8_t* buffer, size_t size, uint64_t offset);
+
+// Имя используемого механизма: "io_uring", "threads" или "sync".
+// Выбор можно зафиксировать переменной окружения CRYPTO_ASYNC_IO.
+const char* asyncIoBackendName();
+
+#endif // ASYNC_IO_H
@@ -0,0 +1,46 @@
+// batch_crypto.h
+// Пакетная обработка дерева каталогов на пуле потоков
+#ifndef BATCH_CRYPTO_H
+#define BATCH_CRYPTO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Итоги пакетной обработки
+struct BatchStats {
+    uint64_t files;
+    uint64_t bytes;      // объем входных данных
+    uint64_t failures;
+    double seconds;
+    std::vector<std::string> errors;  // первые сообщения об ошибках
+};
+
+// Описание операции над файлами.
+// Если задан processChunk, смещения входа и выхода совпадают (блочный шифр):
+// файл делится на порции chunkSize байт, которые обрабатываются
+// независимыми задачами. outputSize — верхняя граница размера результата;
+// processChunk возвращает число записанных байтов, которое может быть
+// меньше outLen только для последней порции (last == true), — выходной
+// файл тогда усекается.
+// Иначе каждый файл целиком обрабатывается функцией processWhole.
+struct BatchOperation {
+    size_t chunkSize = 0;
+    std::function<uint64_t(uint64_t inputSize)> outputSize;
+    std::function<size_t(const uint8_t* in, size_t inLen, uint8_t* out, size_t outLen, bool last)> processChunk;
+    std::function<void(const std::vector<uint8_t>& in, std::vector<uint8_t>& out)> processWhole;
+};
+
+// Обход inputDir и зеркальная запись результатов в outputDir.
+// Ошибки отдельных файлов не прерывают обработку, а учитываются в статистике.
+// Файлы обрабатываются на общем пуле (crypto_runtime.h), одновременно —
+// не больше threads задач; threads == 0 — весь пул.
+BatchStats processDirectory(const std::string& inputDir, const std::string& outputDir,
+                            const BatchOperation& operation, size_t threads = 0);
+
+// Вывод файлов/с и байт/с
+void printBatchStats(const BatchStats& stats);
+
+#endif // BATCH_CRYPTO_H
@@ -0,0 +1,71 @@
+// bounded_queue.h
+// Ограниченная очередь для конвейеров из нескольких потоков
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// Ограниченная очередь между потоками; close() будит всех ожидающих
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notFull.wait(lock, [&] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(value));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& value) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock, [&] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        value = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Без ожидания: при заполненной очереди значение отбрасывается
+    bool tryPush(T value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (closed || items.size() >= capacity) return false;
+        items.push_back(std::move(value));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (items.empty()) return false;
+        value = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mtx;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+};
+
+#endif // BOUNDED_QUEUE_H
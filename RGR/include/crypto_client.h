@@ -0,0 +1,60 @@
+// crypto_client.h
+// Клиент демона crypto_system (libcryptoclient.so)
+#ifndef CRYPTO_CLIENT_H
+#define CRYPTO_CLIENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "crypto_plugin.h"
+#include "daemon_protocol.h"
+
+struct CryptoResponse {
+    uint64_t id = 0;
+    int status = CRYPTO_PLUGIN_OK;    // код CRYPTO_PLUGIN_*
+    std::vector<uint8_t> data;        // результат или текст ошибки
+
+    bool ok() const { return status == CRYPTO_PLUGIN_OK; }
+    std::string error() const { return std::string(data.begin(), data.end()); }
+};
+
+// Одно соединение с демоном; объект используется из одного потока.
+// Ошибки соединения — std::runtime_error, ошибки модулей — в status ответа.
+class CryptoClient {
+public:
+    // socketPath пустой — defaultDaemonSocketPath()
+    explicit CryptoClient(const std::string& socketPath = "");
+    ~CryptoClient();
+
+    CryptoClient(const CryptoClient&) = delete;
+    CryptoClient& operator=(const CryptoClient&) = delete;
+
+    // Конвейерная отправка: возвращает номер запроса, не дожидаясь ответа.
+    // operation — CRYPTO_PLUGIN_ENCRYPT или CRYPTO_PLUGIN_DECRYPT,
+    // key — ключ в формате crypto_plugin.h (пустой для модулей без ключа).
+    uint64_t send(const std::string& module, int operation, const std::vector<uint8_t>& key,
+                  const uint8_t* data, size_t size);
+    // Очередной готовый ответ (в порядке готовности, не отправки)
+    void receive(CryptoResponse& response);
+
+    // Запрос с ожиданием его ответа; ответы на прочие запросы
+    // откладываются для последующих receive
+    CryptoResponse call(const std::string& module, int operation, const std::vector<uint8_t>& key,
+                        const uint8_t* data, size_t size);
+
+    size_t pending() const { return sent - received; }
+
+private:
+    void readResponse(CryptoResponse& response);
+
+    int fd;
+    uint64_t nextId;
+    size_t sent;
+    size_t received;
+    std::vector<uint8_t> frame;
+    std::unordered_map<uint64_t, CryptoResponse> deferred;
+};
+
+#endif // CRYPTO_CLIENT_H
@@ -0,0 +1,84 @@
+// crypto_daemon.h
+// Долгоживущий режим crypto_system: запросы шифрования через Unix-сокет
+#ifndef CRYPTO_DAEMON_H
+#define CRYPTO_DAEMON_H
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "daemon_protocol.h"
+#include "plugin_registry.h"
+#include "crypto_runtime.h"
+
+struct DaemonOptions {
+    std::string socketPath;       // пустой — defaultDaemonSocketPath()
+    size_t threads = 0;           // запросы в обработке (0 — размер общего пула)
+    size_t keyCacheSize = 64;     // контексты ключей, хранимые между запросами
+    size_t maxInFlight = 64;      // запросы одного соединения без отправленного ответа
+};
+
+// Модули и контексты ключей живут, пока работает демон.
+// Каждое соединение читает свой поток кадров; запросы выполняются на общем
+// пуле, готовые ответы отправляет поток записи соединения. Клиент, который
+// не читает ответы, тормозит только чтение своих запросов. Доступ к сокету
+// ограничен владельцем (права 0600): пароль проверяется при запуске демона.
+class CryptoDaemon {
+public:
+    CryptoDaemon(PluginRegistry& registry, const DaemonOptions& options);
+    ~CryptoDaemon();
+
+    CryptoDaemon(const CryptoDaemon&) = delete;
+    CryptoDaemon& operator=(const CryptoDaemon&) = delete;
+
+    // Создание сокета; false — ошибка (текст — в error)
+    bool listen(std::string& error);
+    // Прием соединений до вызова stop(); открытые соединения
+    // дорабатывают принятые запросы и закрываются
+    void serve();
+    // Безопасно вызывать из обработчика сигнала
+    void stop();
+
+    const std::string& socketPath() const { return options.socketPath; }
+    uint64_t requestsServed() const { return served; }
+    uint64_t requestsFailed() const { return failed; }
+
+private:
+    struct Connection;
+    struct KeyContext;
+
+    void readRequests(Connection& connection);
+    void writeResponses(Connection& connection);
+    void process(Connection& connection, const DaemonRequestHeader& header, std::vector<uint8_t>& body);
+    // frame — DAEMON_HEADER_SIZE байт под заголовок, затем тело ответа
+    void respond(Connection& connection, uint64_t id, int status, std::vector<uint8_t>&& frame);
+    std::shared_ptr<KeyContext> keyContext(const std::string& module, const uint8_t* key, size_t keyLength,
+                                           int& status, std::string& error);
+    void reapConnections(bool all);
+
+    PluginRegistry& registry;
+    DaemonOptions options;
+    TaskGroup requests;  // запросы на общем пуле процесса
+    int listenFd;
+    int wakePipe[2];
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> served;
+    std::atomic<uint64_t> failed;
+
+    std::mutex connectionsMutex;
+    std::list<std::unique_ptr<Connection>> connections;
+
+    // Кэш контекстов ключей с вытеснением по давности использования
+    struct CachedKey {
+        std::shared_ptr<KeyContext> context;
+        std::list<std::string>::iterator order;
+    };
+    std::mutex keysMutex;
+    std::list<std::string> keyOrder;  // в начале — последний использованный
+    std::unordered_map<std::string, CachedKey> keys;
+};
+
+#endif // CRYPTO_DAEMON_H
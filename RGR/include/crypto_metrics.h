@@ -0,0 +1,94 @@
+// crypto_metrics.h
+// Метрики операций модулей (libcryptort.so): гистограммы задержек и счетчики
+#ifndef CRYPTO_METRICS_H
+#define CRYPTO_METRICS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Гистограмма в духе HDR: 16 поддиапазонов на каждую степень двойки
+// наносекунд, относительная погрешность — не больше 6,25%
+const unsigned METRIC_SUB_BITS = 4;
+const size_t METRIC_SUB_COUNT = size_t(1) << METRIC_SUB_BITS;
+const size_t METRIC_BUCKETS = (64 - METRIC_SUB_BITS + 1) * METRIC_SUB_COUNT;
+// Число разных имен метрик в процессе; следующие не учитываются
+const size_t METRIC_MAX_COUNT = 64;
+
+// Метрика одной операции. Объявляется статическим объектом модуля;
+// метрики с одинаковым именем (из разных библиотек) суммируются.
+// Запись идет в счетчики текущего потока без блокировок.
+class OperationMetric {
+public:
+    OperationMetric(const char* name, const char* help);
+
+    void record(uint64_t nanoseconds, uint64_t bytes, bool failed = false) noexcept;
+
+private:
+    size_t index;
+};
+
+// $CRYPTO_SYSTEM_METRICS=0 — запись отключена (таймеры не читают часы)
+bool metricsEnabled();
+
+// Замер операции от создания до разрушения. Разрушение при исключении
+// учитывается как ошибка; bytes — объем данных операции.
+class MetricTimer {
+public:
+    explicit MetricTimer(OperationMetric& metric, uint64_t bytes = 0)
+        : metric(metric), bytes(bytes), exceptions(std::uncaught_exceptions()), enabled(metricsEnabled()) {
+        if (enabled) start = std::chrono::steady_clock::now();
+    }
+    ~MetricTimer() {
+        if (!enabled) return;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        metric.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), bytes,
+                      failed || std::uncaught_exceptions() > exceptions);
+    }
+
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+
+    void addBytes(uint64_t value) { bytes += value; }
+    void fail() { failed = true; }
+
+private:
+    OperationMetric& metric;
+    uint64_t bytes;
+    int exceptions;
+    bool enabled;
+    bool failed = false;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Сумма по всем потокам (включая завершившиеся) на момент вызова
+struct MetricSnapshot {
+    std::string name;
+    std::string help;
+    uint64_t count = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    std::vector<uint64_t> buckets;  // METRIC_BUCKETS значений
+
+    // Верхняя граница задержки для доли q (0..1) операций, нс
+    uint64_t percentile(double q) const;
+    // Число операций короче 2^power нс
+    uint64_t countBelowPowerOfTwo(unsigned power) const;
+};
+
+// Метрики, по которым была хотя бы одна операция, — в порядке регистрации
+std::vector<MetricSnapshot> snapshotMetrics();
+
+void writeMetricsJson(std::ostream& out);
+// Формат text exposition Prometheus: гистограмма длительности и счетчики
+void writeMetricsPrometheus(std::ostream& out);
+// format — "json" или "prometheus"; false — неизвестный формат
+bool writeMetrics(std::ostream& out, const std::string& format);
+
+#endif // CRYPTO_METRICS_H
@@ -0,0 +1,47 @@
+// crypto_pipeline.h
+// Цепочки модулей (например, 3-WAY -> Морзе) без промежуточных файлов
+#ifndef CRYPTO_PIPELINE_H
+#define CRYPTO_PIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "crypto_plugin.h"
+
+// Стадия — модуль с готовым контекстом init()
+struct PipelineStage {
+    std::string name;
+    const CryptoPluginDescriptor* plugin;
+    void* context;
+};
+
+struct PipelineStats {
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t chunks = 0;
+};
+
+// Формат результата encryptPipeline (числа — little-endian):
+//   "CSPIPE01", u8 число стадий, для каждой: u8 длина имени, имя;
+//   порции: u32 длина, результат всех стадий над очередной порцией входа;
+//   u32 0xFFFFFFFF — конец (без него поток считается оборванным).
+const size_t PIPELINE_DEFAULT_CHUNK = 1 << 20;
+const size_t PIPELINE_DEFAULT_QUEUE = 4;
+
+// Чтение входа, каждая стадия и запись выхода работают в своих потоках,
+// между ними — очереди на queueDepth порций, так что память ограничена
+// независимо от объема данных. Каждая порция — отдельное сообщение модуля.
+// Дескрипторы не закрываются; ошибки — std::runtime_error.
+PipelineStats encryptPipeline(const std::vector<PipelineStage>& stages, int inFd, int outFd,
+                              size_t chunkSize = PIPELINE_DEFAULT_CHUNK,
+                              size_t queueDepth = PIPELINE_DEFAULT_QUEUE);
+
+// Имена стадий из заголовка (в порядке шифрования); читается до decryptPipeline
+std::vector<std::string> readPipelineHeader(int inFd);
+
+// stages — в порядке заголовка, дешифрование идет с последней стадии
+PipelineStats decryptPipeline(const std::vector<PipelineStage>& stages, int inFd, int outFd,
+                              size_t queueDepth = PIPELINE_DEFAULT_QUEUE);
+
+#endif // CRYPTO_PIPELINE_H
@@ -0,0 +1,80 @@
+// crypto_plugin.h
+// Единый C-интерфейс модулей: шифрование и дешифрование буферов без терминала
+#ifndef CRYPTO_PLUGIN_H
+#define CRYPTO_PLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Версия интерфейса: меняется при несовместимом изменении дескриптора.
+// Новые поля добавляются только в конец, хост проверяет structSize.
+#define CRYPTO_PLUGIN_ABI_VERSION 1
+
+// Имя экспортируемой функции, возвращающей дескриптор модуля
+#define CRYPTO_PLUGIN_DESCRIPTOR_SYMBOL "crypto_plugin_descriptor"
+
+// Возможности модуля (битовая маска)
+#define CRYPTO_PLUGIN_CAP_ENCRYPT     0x01u  // есть encrypt
+#define CRYPTO_PLUGIN_CAP_DECRYPT     0x02u  // есть decrypt
+#define CRYPTO_PLUGIN_CAP_KEY         0x04u  // init требует ключ (формат — keyFormat)
+#define CRYPTO_PLUGIN_CAP_THREAD_SAFE 0x08u  // один контекст можно использовать из многих потоков
+
+// Коды возврата
+#define CRYPTO_PLUGIN_OK             0
+#define CRYPTO_PLUGIN_ERR_ARGUMENT  -1   // неверные аргументы
+#define CRYPTO_PLUGIN_ERR_KEY       -2   // неверный ключ
+#define CRYPTO_PLUGIN_ERR_BUFFER    -3   // мал выходной буфер; в *outLen — нужный размер
+#define CRYPTO_PLUGIN_ERR_DATA      -4   // поврежденные входные данные
+#define CRYPTO_PLUGIN_ERR_UNSUPPORTED -5 // операция не поддерживается
+#define CRYPTO_PLUGIN_ERR_INTERNAL  -6   // прочие ошибки (например, нехватка памяти)
+
+// Операция для maxOutput
+#define CRYPTO_PLUGIN_ENCRYPT 0
+#define CRYPTO_PLUGIN_DECRYPT 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Дескриптор модуля. Функции не бросают исключений и не обращаются
+// к stdin/stdout; сообщение об ошибке — по коду (cryptoPluginStatusText).
+typedef struct CryptoPluginDescriptor {
+    uint32_t abiVersion;        // CRYPTO_PLUGIN_ABI_VERSION модуля
+    uint32_t structSize;        // sizeof(CryptoPluginDescriptor) модуля
+    const char* name;           // короткое имя: "rsa", "threeway", "morse"
+    const char* description;
+    const char* keyFormat;      // описание ключа для init (NULL — ключ не нужен)
+    uint32_t capabilities;      // CRYPTO_PLUGIN_CAP_*
+
+    // Создание контекста с ключом key (keyLen байт)
+    int (*init)(const uint8_t* key, size_t keyLen, void** context);
+    // Верхняя граница размера результата операции над inputLen байтами
+    size_t (*maxOutput)(void* context, int operation, size_t inputLen);
+    // Обработка in в out (outCapacity байт); в *outLen — размер результата.
+    // Вызовы независимы: каждый буфер — отдельное сообщение.
+    int (*encrypt)(void* context, const uint8_t* in, size_t inLen,
+                   uint8_t* out, size_t outCapacity, size_t* outLen);
+    int (*decrypt)(void* context, const uint8_t* in, size_t inLen,
+                   uint8_t* out, size_t outCapacity, size_t* outLen);
+    void (*free)(void* context);
+} CryptoPluginDescriptor;
+
+typedef const CryptoPluginDescriptor* (*CryptoPluginDescriptorFunc)(void);
+
+static inline const char* cryptoPluginStatusText(int status) {
+    switch (status) {
+        case CRYPTO_PLUGIN_OK: return "успешно";
+        case CRYPTO_PLUGIN_ERR_ARGUMENT: return "неверные аргументы";
+        case CRYPTO_PLUGIN_ERR_KEY: return "неверный ключ";
+        case CRYPTO_PLUGIN_ERR_BUFFER: return "недостаточный размер выходного буфера";
+        case CRYPTO_PLUGIN_ERR_DATA: return "поврежденные входные данные";
+        case CRYPTO_PLUGIN_ERR_UNSUPPORTED: return "операция не поддерживается";
+        default: return "внутренняя ошибка модуля";
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRYPTO_PLUGIN_H
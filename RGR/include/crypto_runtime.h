@@ -0,0 +1,109 @@
+// crypto_runtime.h
+// Общая среда выполнения модулей (libcryptort.so): один пул потоков на процесс
+#ifndef CRYPTO_RUNTIME_H
+#define CRYPTO_RUNTIME_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "thread_pool.h"
+
+// Пул, общий для всех модулей процесса. Создается при первом обращении;
+// число потоков — $CRYPTO_RT_THREADS или число аппаратных потоков.
+// Ждать его целиком (wait) нельзя: задачи ставятся через TaskGroup.
+WorkStealingPool& cryptoRuntimePool();
+
+// Группа задач вызывающего кода на общем пуле. Одновременно выполняется
+// не больше maxConcurrency задач группы (0 — без ограничения, т. е. размер
+// пула), остальные ждут в очереди группы. wait() ждет только свои задачи
+// и, пока ждет, выполняет задачи пула, поэтому группы можно вкладывать
+// (в том числе ждать из рабочего потока пула).
+class TaskGroup {
+public:
+    typedef std::function<void()> Task;
+
+    explicit TaskGroup(size_t maxConcurrency = 0);
+    // Дожидается задач группы (исключения при этом отбрасываются)
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(Task task);
+    // Первое исключение задачи группы пробрасывается отсюда
+    void wait();
+    // Ожидание, пока незавершенных задач группы не станет меньше limit
+    void waitPendingBelow(size_t limit);
+
+    size_t concurrency() const { return limit; }
+
+private:
+    void start(Task task);
+    void finish();
+    void helpUntil(const std::function<bool()>& done);
+
+    WorkStealingPool& pool;
+    size_t limit;
+    std::mutex mtx;
+    std::condition_variable changed;
+    std::deque<Task> deferred;  // ждут освобождения места (maxConcurrency)
+    size_t running;             // поставлены в пул
+    size_t pending;             // не завершены, включая отложенные
+    std::exception_ptr firstError;
+};
+
+// Обработка [0, size) порциями по grain байт (последняя — короче) на общем
+// пуле; body(begin, end) вызывается для каждой порции ровно один раз,
+// одновременно — не больше maxThreads (0 — по размеру пула). Одна порция
+// или maxThreads == 1 — обработка в вызывающем потоке.
+void parallelForRange(size_t size, size_t grain, size_t maxThreads,
+                      const std::function<void(size_t begin, size_t end)>& body);
+
+// Рабочая память потока: выделение сдвигом указателя, освобождение —
+// откатом к отметке ScratchScope. Блоки сохраняются между вызовами,
+// поэтому повторные задачи потока не обращаются к malloc.
+class ScratchArena {
+public:
+    // Невыровненная память для size байт (выравнивание — 16 байт)
+    uint8_t* allocate(size_t size);
+    size_t capacity() const;
+
+private:
+    friend class ScratchScope;
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0;  // блок, из которого идет выделение
+    size_t used = 0;     // занято в текущем блоке
+};
+
+// Арена текущего потока
+ScratchArena& threadScratchArena();
+
+// Все выделенное из арены внутри области освобождается при выходе из нее
+class ScratchScope {
+public:
+    explicit ScratchScope(ScratchArena& arena = threadScratchArena());
+    ~ScratchScope();
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    uint8_t* allocate(size_t size) { return arena.allocate(size); }
+
+private:
+    ScratchArena& arena;
+    size_t savedBlock;
+    size_t savedUsed;
+};
+
+#endif // CRYPTO_RUNTIME_H
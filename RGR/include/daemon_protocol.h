@@ -0,0 +1,97 @@
+// daemon_protocol.h
+// Кадры запросов и ответов демона crypto_system (Unix-сокет)
+#ifndef DAEMON_PROTOCOL_H
+#define DAEMON_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+// Кадр запроса (числа — little-endian):
+//   u32 magic "CSRQ", u32 длина тела, u64 номер запроса,
+//   u8 операция (CRYPTO_PLUGIN_ENCRYPT/DECRYPT), u8 длина имени модуля, u16 длина ключа;
+//   тело: имя модуля, ключ в формате crypto_plugin.h, данные.
+// Кадр ответа:
+//   u32 magic "CSRS", u32 длина тела, u64 номер запроса, i32 код CRYPTO_PLUGIN_*;
+//   тело: результат или текст ошибки.
+// Запросы одного соединения можно отправлять не дожидаясь ответов;
+// ответы приходят по мере готовности и сопоставляются по номеру.
+const uint32_t DAEMON_REQUEST_MAGIC = 0x51525343;   // "CSRQ"
+const uint32_t DAEMON_RESPONSE_MAGIC = 0x53525343;  // "CSRS"
+const size_t DAEMON_HEADER_SIZE = 20;
+const uint32_t DAEMON_MAX_BODY = 64u << 20;
+
+struct DaemonRequestHeader {
+    uint32_t bodyLength;
+    uint64_t id;
+    uint8_t operation;
+    uint8_t moduleLength;
+    uint16_t keyLength;
+};
+
+struct DaemonResponseHeader {
+    uint32_t bodyLength;
+    uint64_t id;
+    int32_t status;
+};
+
+inline void daemonPutLE(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+inline uint64_t daemonGetLE(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+inline void writeDaemonRequestHeader(const DaemonRequestHeader& header, uint8_t* out) {
+    daemonPutLE(out, DAEMON_REQUEST_MAGIC, 4);
+    daemonPutLE(out + 4, header.bodyLength, 4);
+    daemonPutLE(out + 8, header.id, 8);
+    out[16] = header.operation;
+    out[17] = header.moduleLength;
+    daemonPutLE(out + 18, header.keyLength, 2);
+}
+
+// false — не кадр запроса или тело не согласовано с длинами полей
+inline bool readDaemonRequestHeader(const uint8_t* in, DaemonRequestHeader& header) {
+    if (daemonGetLE(in, 4) != DAEMON_REQUEST_MAGIC) return false;
+    header.bodyLength = static_cast<uint32_t>(daemonGetLE(in + 4, 4));
+    header.id = daemonGetLE(in + 8, 8);
+    header.operation = in[16];
+    header.moduleLength = in[17];
+    header.keyLength = static_cast<uint16_t>(daemonGetLE(in + 18, 2));
+    return header.bodyLength <= DAEMON_MAX_BODY &&
+           static_cast<size_t>(header.moduleLength) + header.keyLength <= header.bodyLength;
+}
+
+inline void writeDaemonResponseHeader(const DaemonResponseHeader& header, uint8_t* out) {
+    daemonPutLE(out, DAEMON_RESPONSE_MAGIC, 4);
+    daemonPutLE(out + 4, header.bodyLength, 4);
+    daemonPutLE(out + 8, header.id, 8);
+    daemonPutLE(out + 16, static_cast<uint32_t>(header.status), 4);
+}
+
+inline bool readDaemonResponseHeader(const uint8_t* in, DaemonResponseHeader& header) {
+    if (daemonGetLE(in, 4) != DAEMON_RESPONSE_MAGIC) return false;
+    header.bodyLength = static_cast<uint32_t>(daemonGetLE(in + 4, 4));
+    header.id = daemonGetLE(in + 8, 8);
+    header.status = static_cast<int32_t>(static_cast<uint32_t>(daemonGetLE(in + 16, 4)));
+    // Результат может быть больше запроса (код Морзе), поэтому тело ответа
+    // ограничено только разрядностью длины
+    return true;
+}
+
+// Путь сокета по умолчанию: $CRYPTO_SYSTEM_SOCKET или ./crypto_system.sock
+inline std::string defaultDaemonSocketPath() {
+    const char* path = getenv("CRYPTO_SYSTEM_SOCKET");
+    return path && *path ? path : "crypto_system.sock";
+}
+
+#endif // DAEMON_PROTOCOL_H
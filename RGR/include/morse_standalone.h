@@ -1,30 +1,80 @@
 #ifndef MORSE_STANDALONE_H
 #define MORSE_STANDALONE_H
 
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
+#include <istream>
+#include <ostream>
 
 using namespace std;
 
+// Таблицы кодов общие и строятся при компиляции, поэтому объект
+// не хранит состояния и создается бесплатно
 class MorseCode {
-private:
-    map<char, string> morseMap;      // Убрал static
-    map<string, char> reverseMap;    // Убрал static
-    
-    void initializeMaps();
-
 public:
     MorseCode();
+    // Код символа без выделения памяти (пустой — символ не поддерживается)
+    string_view encodeCharView(char c) const;
     string encodeChar(char c) const;
     string encodeString(const string& text) const;
+    char decodeChar(string_view morse) const;
     char decodeChar(const string& morse) const;
     string decodeString(const string& morse) const;
+
+    // Варианты без выделения памяти. Точная длина результата считается
+    // отдельным проходом; запись — в буфер или через итератор вывода.
+    // Буферный вариант возвращает длину результата и пишет только
+    // если она не больше capacity.
+    size_t encodedLength(string_view text) const;
+    size_t encodeString(string_view text, char* out, size_t capacity) const;
+    template <class OutputIt>
+    OutputIt encodeString(string_view text, OutputIt out) const;
+
+    size_t decodedLength(string_view morse) const;
+    size_t decodeString(string_view morse, char* out, size_t capacity) const;
+    template <class OutputIt>
+    OutputIt decodeString(string_view morse, OutputIt out) const;
     bool isSupported(char c) const;
     void printSupportedChars() const;
     void runDemo() const;
 };
 
+template <class OutputIt>
+OutputIt MorseCode::encodeString(string_view text, OutputIt out) const {
+    bool firstChar = true;
+    for (char c : text) {
+        string_view morseChar = encodeCharView(c);
+        if (morseChar.empty()) continue;
+        if (!firstChar) {
+            *out++ = ' ';
+        }
+        out = copy(morseChar.begin(), morseChar.end(), out);
+        firstChar = false;
+    }
+    return out;
+}
+
+// Лексемы разделены пробелами (любым их числом)
+template <class OutputIt>
+OutputIt MorseCode::decodeString(string_view morse, OutputIt out) const {
+    size_t i = 0;
+    while (i < morse.size()) {
+        if (morse[i] == ' ') {
+            i++;
+            continue;
+        }
+        size_t end = morse.find(' ', i);
+        if (end == string_view::npos) {
+            end = morse.size();
+        }
+        *out++ = decodeChar(morse.substr(i, end - i));
+        i = end;
+    }
+    return out;
+}
+
 // Структуры для бинарного кодирования
 struct MorseEncodedResult {
     vector<unsigned char> binary_data;
@@ -42,10 +92,71 @@ struct MorseFileOperationResult {
     string message;
 };
 
-// Функции для бинарного кодирования
+// Функции для бинарного кодирования.
+// Все функции модуля можно вызывать из нескольких потоков одновременно:
+// таблицы неизменяемы и строятся при компиляции, общего состояния нет.
 MorseEncodedResult encodeTextToMorse(const string &plaintext);
+// Крупные входы (больше 1 МБ) кодируются участками на общем пуле;
+// threads == 0 — весь пул, 1 — однопоточно
+MorseEncodedResult encodeTextToMorse(const string &plaintext, size_t threads);
 MorseDecodedResult decodeTextFromMorse(const vector<unsigned char> &binary_data);
+// Декодирование многих буферов на общем пуле; результаты — в порядке
+// входов. threads == 0 — весь пул.
+vector<MorseDecodedResult> decodeTextFromMorseBatch(const vector<vector<unsigned char>> &inputs,
+                                                    size_t threads = 0);
 MorseFileOperationResult encodeFileToMorse(const string &inputFilePath, const string &outputFilePath);
 MorseFileOperationResult decodeFileFromMorse(const string &inputFilePath, const string &outputFilePath);
 
+// Потоковые варианты в постоянной памяти (например, stdin/stdout в конвейере).
+// Если вывод не допускает позиционирования, в заголовке остается
+// UINT64_MAX, и декодер читает биты до конца данных.
+MorseFileOperationResult encodeStreamToMorse(istream &input, ostream &output);
+MorseFileOperationResult decodeStreamFromMorse(istream &input, ostream &output);
+
+// Кадровый формат ("MORSEFR1", затем кадры по 64 КБ с собственными
+// счетчиками байт и бит): кодируется и декодируется в постоянной памяти
+// при любом размере данных. decodeTextFromMorse, decodeStreamFromMorse
+// и decodeFileFromMorse распознают его автоматически.
+MorseFileOperationResult encodeStreamToMorseFramed(istream &input, ostream &output);
+MorseFileOperationResult encodeFileToMorseFramed(const string &inputFilePath, const string &outputFilePath);
+
+// Адаптивный формат ("MORSEAD1"): коды полубайтов назначаются по частотам
+// данных (частым — короткие), таблица хранится в заголовке. Для текста
+// код заметно короче. Поток читается дважды, поэтому вход должен
+// допускать позиционирование (файл). Декодируется теми же функциями.
+MorseEncodedResult encodeTextToMorseAdaptive(const string &plaintext, size_t threads = 0);
+MorseFileOperationResult encodeStreamToMorseAdaptive(istream &input, ostream &output);
+MorseFileOperationResult encodeFileToMorseAdaptive(const string &inputFilePath, const string &outputFilePath);
+
+// Звуковой сигнал: PCM 16 бит, моно
+struct MorseAudioOptions {
+    double wpm = 20;              // скорость знаков, слов/мин (по слову PARIS)
+    double farnsworthWpm = 0;     // общая скорость по Фарнсворту; 0 — равна wpm
+    double toneHz = 700;
+    unsigned sampleRate = 8000;
+    double amplitude = 0.8;       // доля полной шкалы
+    double rampMs = 5;            // длительность фронтов тона
+};
+
+// Озвучивание текста в WAV в постоянной памяти; символы без кода Морзе
+// пропускаются, пробельные символы разделяют слова. Если вывод не
+// допускает позиционирования, размеры в заголовке остаются 0xFFFFFFFF.
+MorseFileOperationResult encodeStreamToMorseWav(istream &input, ostream &output, const MorseAudioOptions &options);
+MorseFileOperationResult encodeFileToMorseWav(const string &inputFilePath, const string &outputFilePath,
+                                              const MorseAudioOptions &options);
+
+// Распознавание WAV (PCM 16 бит, берется первый канал) за один проход в
+// постоянной памяти. Используются toneHz — частота тона и wpm — начальная
+// оценка скорости (дальше длина точки подстраивается по сигналу).
+MorseFileOperationResult decodeStreamFromMorseWav(istream &input, ostream &output, const MorseAudioOptions &options);
+MorseFileOperationResult decodeFileFromMorseWav(const string &inputFilePath, const string &outputFilePath,
+                                                const MorseAudioOptions &options);
+
+extern "C" {
+    void run_morse_demo();
+    // Режим фильтра: argv = {"encode"|"encode-raw"|"encode-adaptive"|"decode"|"text-encode"|"text-decode"}
+    // или {"wav", [слов/мин, [Гц, [общая скорость]]]}, {"wav-decode", [Гц, [слов/мин]]}
+    int run_morse_filter(int argc, char* argv[]);
+}
+
 #endif // MORSE_STANDALONE_H
\ No newline at end of file
@@ -0,0 +1,72 @@
+// plugin_registry.h
+// Модули из каталога библиотек: поиск при запуске, загрузка при первом обращении
+#ifndef PLUGIN_REGISTRY_H
+#define PLUGIN_REGISTRY_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "crypto_plugin.h"
+
+// Модуль — файл lib<имя>.so в каталоге, экспортирующий crypto_plugin_descriptor.
+// При создании реестра каталог только просматривается (символ ищется в
+// таблице ELF), библиотека открывается при первом обращении
+// (или заранее, в фоновом потоке warmUp). Все методы потокобезопасны.
+class PluginRegistry {
+public:
+    // dir пустой — $CRYPTO_SYSTEM_PLUGIN_DIR или ./lib
+    explicit PluginRegistry(const std::string& dir = "");
+    // Останавливает фоновую загрузку и закрывает библиотеки
+    ~PluginRegistry();
+
+    PluginRegistry(const PluginRegistry&) = delete;
+    PluginRegistry& operator=(const PluginRegistry&) = delete;
+
+    const std::string& directory() const { return dir; }
+    std::vector<std::string> names() const;
+    bool has(const std::string& name) const;
+    std::string path(const std::string& name) const;
+
+    // Дескриптор библиотеки; nullptr — ошибка (текст — в error).
+    // Если библиотеку уже загружает warmUp, вызов ждет ее.
+    void* handle(const std::string& name, std::string& error);
+    void* symbol(const std::string& name, const char* symbolName, std::string& error);
+    // Дескриптор crypto_plugin.h с проверкой версии интерфейса
+    const CryptoPluginDescriptor* descriptor(const std::string& name, std::string& error);
+
+    // Фоновая загрузка всех модулей с немедленным связыванием (RTLD_NOW),
+    // пока пользователь читает меню
+    void warmUp();
+
+    // Время загрузки каждой открытой библиотеки
+    void report(std::ostream& out) const;
+
+private:
+    struct Entry {
+        std::string name;
+        std::string path;
+        std::once_flag once;
+        void* handle = nullptr;
+        std::string error;
+        double loadMs = 0;
+        bool background = false;
+    };
+
+    Entry* find(const std::string& name) const;
+    void load(Entry& entry, int flags, bool background);
+
+    std::string dir;
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::thread warmer;
+    std::atomic<bool> stopping;
+};
+
+// Дескриптор crypto_plugin.h из открытой библиотеки; nullptr — модуль
+// его не экспортирует или собран под несовместимую версию
+const CryptoPluginDescriptor* loadPluginDescriptor(void* handle, std::string& error);
+
+#endif // PLUGIN_REGISTRY_H
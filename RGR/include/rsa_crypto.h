@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include "batch_crypto.h"
 
 #ifdef _WIN32
     #ifdef RSA_EXPORTS
@@ -32,4 +33,10 @@ extern "C" {
     RSA_API void run_rsa_crypto();
 }
 
+// Пакетная обработка дерева каталогов (каждый файл — отдельная задача)
+RSA_API BatchStats encryptDirectoryRSA(const std::string& inputDir, const std::string& outputDir,
+                                       int64_t e, int64_t n, size_t threads = 0);
+RSA_API BatchStats decryptDirectoryRSA(const std::string& inputDir, const std::string& outputDir,
+                                       int64_t d, int64_t n, size_t threads = 0);
+
 #endif
\ No newline at end of file
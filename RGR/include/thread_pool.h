@@ -0,0 +1,72 @@
+// thread_pool.h
+// Пул потоков с перехватом задач (work stealing)
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// У каждого рабочего потока своя очередь: владелец берет задачи с конца
+// (LIFO, горячий кэш), простаивающие потоки крадут с начала чужих очередей.
+// Задачи, порожденные внутри рабочего потока, попадают в его очередь.
+class WorkStealingPool {
+public:
+    typedef std::function<void()> Task;
+
+    // threadCount == 0 — по числу аппаратных потоков
+    explicit WorkStealingPool(size_t threadCount = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(Task task);
+
+    // Ожидание завершения всех задач, включая порожденные ими.
+    // Первое исключение, выброшенное задачей, пробрасывается отсюда.
+    // Нельзя вызывать из рабочего потока этого же пула.
+    void wait();
+
+    // Ожидание, пока число незавершенных задач не станет меньше limit
+    // (ограничивает память при постановке миллионов задач)
+    void waitPendingBelow(size_t limit);
+
+    // Выполнение одной задачи из очередей пула в вызывающем потоке
+    // (ожидающий поток помогает вместо простоя); false — очереди пусты
+    bool runOneTask();
+
+    size_t threadCount() const { return workers.size(); }
+
+private:
+    struct WorkerQueue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    bool popOrSteal(size_t self, Task& task);
+    void runTask(Task& task);
+    void workerLoop(size_t index);
+    void finishTask();
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued;    // задачи в очередях
+    std::atomic<size_t> pending;   // поставленные, но не завершенные задачи
+    std::atomic<size_t> throttle;  // порог waitPendingBelow (0 — не ждет никто)
+    std::atomic<size_t> nextQueue;
+    bool stopping;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::exception_ptr firstError;
+};
+
+#endif // THREAD_POOL_H
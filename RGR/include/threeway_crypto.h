@@ -2,20 +2,87 @@
 #ifndef THREEWAY_CRYPTO_H
 #define THREEWAY_CRYPTO_H
 
+#include <array>
 #include <cstdint>
+#include <cstddef>
+#include <span>
 #include <string>
 #include <vector>
+#include "batch_crypto.h"
 
 struct ThreeWayKeys {
     uint32_t key[3];
 };
 
+// Размер выходного буфера для шифрования сообщения длины messageLen.
+// Шифртекст всех путей (сообщения, файлы, потоки, пакетная обработка,
+// модуль crypto_plugin) — целое число блоков: открытый текст дополняется
+// от 1 до 12 байтами, равными числу байтов дополнения, поэтому длина
+// восстанавливается точно.
+size_t requiredSizeThreeWay(size_t messageLen);
+
+// Шифрование/дешифрование в буфер вызывающей стороны без выделения памяти.
+// Возвращают число записанных байтов; при нехватке места в out
+// бросают std::length_error, при неверном размере шифртекста или
+// дополнении — std::runtime_error.
+size_t encryptMessageThreeWay(std::span<const uint8_t> message, std::span<uint8_t> out, const ThreeWayKeys& keys);
+size_t decryptMessageThreeWay(std::span<const uint8_t> encrypted, std::span<uint8_t> out, const ThreeWayKeys& keys);
+
+std::vector<uint8_t> encryptMessageThreeWay(const std::string& message, const ThreeWayKeys& keys);
+std::string decryptMessageThreeWay(const std::vector<uint8_t>& encrypted, const ThreeWayKeys& keys);
+
+// Потоковое шифрование между открытыми дескрипторами (каналы, stdin/stdout)
+// в постоянной памяти; формат совпадает с файловым
+void encryptStreamThreeWay(int inFd, int outFd, const ThreeWayKeys& keys);
+void decryptStreamThreeWay(int inFd, int outFd, const ThreeWayKeys& keys);
+
+// Контейнер с произвольным доступом: CTR-чанки фиксированного размера
+// и индекс смещений чанков в конце файла
+void encryptFileThreeWaySeekable(const std::string& inputFile, const std::string& outputFile, const ThreeWayKeys& keys);
+// Расшифровка length байт открытого текста начиная с offset;
+// читаются только чанки, пересекающиеся с диапазоном
+std::vector<uint8_t> decryptRangeThreeWay(const std::string& file, uint64_t offset, size_t length, const ThreeWayKeys& keys);
+// Размер открытого текста, хранящегося в контейнере
+uint64_t seekablePlaintextSizeThreeWay(const std::string& file);
+
+// Пакетная обработка дерева каталогов; крупные файлы делятся на порции
+BatchStats encryptDirectoryThreeWay(const std::string& inputDir, const std::string& outputDir,
+                                    const ThreeWayKeys& keys, size_t threads = 0);
+BatchStats decryptDirectoryThreeWay(const std::string& inputDir, const std::string& outputDir,
+                                    const ThreeWayKeys& keys, size_t threads = 0);
+
+// Имитовставка PMAC на основе 3-WAY: блоки обрабатываются независимо,
+// поэтому порции сообщения считаются на общем пуле (threads == 0 —
+// весь пул) и объединяются XOR в конце
+const size_t THREE_WAY_MAC_SIZE = 12;
+typedef std::array<uint8_t, THREE_WAY_MAC_SIZE> ThreeWayTag;
+
+ThreeWayTag macThreeWay(std::span<const uint8_t> data, const ThreeWayKeys& keys, size_t threads = 0);
+
+// Файлы с проверкой целостности: шифртекст (с тем же дополнением, что
+// у остальных путей), затем тег PMAC по шифртексту. Дешифрование бросает
+// std::runtime_error, если тег или дополнение неверны (выходной файл
+// при этом не создается).
+void encryptFileThreeWayAuthenticated(const std::string& inputFile, const std::string& outputFile,
+                                      const ThreeWayKeys& keys, size_t threads = 0);
+void decryptFileThreeWayAuthenticated(const std::string& inputFile, const std::string& outputFile,
+                                      const ThreeWayKeys& keys, size_t threads = 0);
+bool verifyFileThreeWay(const std::string& file, const ThreeWayKeys& keys, size_t threads = 0);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 void run_threeway_crypto();
 
+// Режим фильтра stdin -> stdout: argv = {"encrypt"|"decrypt", "--key-file", ПУТЬ}
+// или {"encrypt"|"decrypt", "--key-fd", N}; ключ — в формате threeway_keys.txt.
+// Возвращает код завершения процесса.
+int run_threeway_filter(int argc, char* argv[]);
+
+// Имя активной реализации блочных ядер: "scalar", "sse4.1", "avx2" или "avx512"
+const char* threeway_kernel_variant();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,35 @@
+// threeway_kernels.h
+// Блочные ядра 3-WAY с выбором реализации под процессор
+#ifndef THREEWAY_KERNELS_H
+#define THREEWAY_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Константы для упрощенного 3-WAY
+const int THREE_WAY_BLOCK_SIZE = 12; // 96 бит = 12 байт
+const int THREE_WAY_ROUNDS = 4;      // Простое количество раундов
+
+// Обработка blocks подряд идущих 12-байтных блоков (in и out могут совпадать)
+typedef void (*ThreeWayBlocksFunc)(const uint8_t* in, uint8_t* out, size_t blocks,
+                                   const uint32_t roundKeys[THREE_WAY_ROUNDS][3]);
+
+// Указатели на ядра, привязываются один раз при загрузке библиотеки
+extern ThreeWayBlocksFunc threeWayEncryptBlocks;
+extern ThreeWayBlocksFunc threeWayDecryptBlocks;
+
+// Операции над одним блоком
+void generateRoundKeys(const uint32_t key[3], uint32_t roundKeys[THREE_WAY_ROUNDS][3]);
+void threeWayEncrypt(uint32_t block[3], const uint32_t roundKeys[THREE_WAY_ROUNDS][3]);
+void threeWayDecrypt(uint32_t block[3], const uint32_t roundKeys[THREE_WAY_ROUNDS][3]);
+void packBytesToBlock(const uint8_t* bytes, uint32_t block[3]);
+void unpackBlockToBytes(const uint32_t block[3], uint8_t* bytes);
+
+// Дополнение последнего блока: tailLen (< 12) байт открытого текста,
+// затем 12 - tailLen байт, каждый из которых равен их числу (от 1 до 12).
+// Единый формат всех путей 3-WAY: сообщения, файлы, потоки, модуль.
+void padThreeWayBlock(const uint8_t* tail, size_t tailLen, uint8_t block[THREE_WAY_BLOCK_SIZE]);
+// Число байтов дополнения в расшифрованном последнем блоке; 0 — дополнение неверно
+size_t threeWayPaddingLength(const uint8_t block[THREE_WAY_BLOCK_SIZE]);
+
+#endif // THREEWAY_KERNELS_H
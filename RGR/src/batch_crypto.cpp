@@ -0,0 +1,242 @@
+#include "../include/batch_crypto.h"
+#include "../include/crypto_runtime.h"
+#include "../include/async_io.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Сколько незавершенных задач на поток допускается при обходе каталога
+const size_t BATCH_PENDING_PER_THREAD = 64;
+// Сколько сообщений об ошибках сохраняется в статистике
+const size_t BATCH_MAX_ERRORS = 10;
+
+// Счетчики, общие для всех задач пакета
+struct BatchCounters {
+    atomic<uint64_t> files{0};
+    atomic<uint64_t> bytes{0};
+    atomic<uint64_t> failures{0};
+    mutex errorMutex;
+    vector<string> errors;
+
+    void fail(const string& path, const string& message) {
+        failures++;
+        lock_guard<mutex> lock(errorMutex);
+        if (errors.size() < BATCH_MAX_ERRORS) {
+            errors.push_back(path + ": " + message);
+        }
+    }
+};
+
+static int openInput(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw runtime_error("Не удалось открыть входной файл");
+    return fd;
+}
+
+static int openOutput(const string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) throw runtime_error("Не удалось создать выходной файл");
+    return fd;
+}
+
+// Крупный файл, порции которого обрабатываются разными задачами.
+// Файл засчитывается, когда последняя задача освобождает состояние;
+// результат неудачной обработки удаляется.
+struct ChunkedFile {
+    string path;
+    string outputPath;
+    int inFd = -1;
+    int outFd = -1;
+    uint64_t inputSize = 0;
+    uint64_t outputSize = 0;
+    atomic<bool> failed{false};
+    BatchCounters* counters = nullptr;
+
+    ~ChunkedFile() {
+        if (inFd >= 0) close(inFd);
+        if (outFd >= 0) close(outFd);
+        if (!failed) {
+            counters->files++;
+        } else if (outFd >= 0) {
+            unlink(outputPath.c_str());
+        }
+    }
+};
+
+static void processChunkTask(const shared_ptr<ChunkedFile>& file, uint64_t offset, size_t chunkSize,
+                             const BatchOperation& operation) {
+    if (file->failed) return;
+    try {
+        size_t inLen = static_cast<size_t>(min<uint64_t>(chunkSize, file->inputSize - offset));
+        bool last = offset + inLen == file->inputSize;
+        size_t outLen = last ? static_cast<size_t>(file->outputSize - offset) : inLen;
+
+        ScratchScope scratch;
+        uint8_t* input = scratch.allocate(inLen);
+        uint8_t* output = scratch.allocate(outLen);
+        preadFull(file->inFd, input, inLen, offset);
+        size_t produced = operation.processChunk(input, inLen, output, outLen, last);
+        pwriteFull(file->outFd, output, produced, offset);
+        // Остальные порции лежат раньше, поэтому усечение их не затрагивает
+        if (produced < outLen && ftruncate(file->outFd, static_cast<off_t>(offset + produced)) != 0) {
+            throw runtime_error(string("Ошибка усечения файла: ") + strerror(errno));
+        }
+        file->counters->bytes += inLen;
+    } catch (const exception& e) {
+        if (!file->failed.exchange(true)) {
+            file->counters->fail(file->path, e.what());
+        }
+    }
+}
+
+static void processSmallFileTask(const string& inputPath, const string& outputPath,
+                                 const BatchOperation& operation, BatchCounters& counters) {
+    int inFd = -1, outFd = -1;
+    try {
+        inFd = openInput(inputPath);
+        struct stat st;
+        if (fstat(inFd, &st) != 0) throw runtime_error("Не удалось определить размер файла");
+        size_t size = static_cast<size_t>(st.st_size);
+
+        // Буферы принадлежат вызову: задача может выполняться вложенно
+        // в другую задачу того же потока (TaskGroup::wait помогает пулу)
+        vector<uint8_t> input(size);
+        vector<uint8_t> output;
+        preadFull(inFd, input.data(), size, 0);
+
+        if (operation.processChunk) {
+            output.resize(static_cast<size_t>(operation.outputSize(size)));
+            output.resize(operation.processChunk(input.data(), size, output.data(), output.size(), true));
+        } else {
+            operation.processWhole(input, output);
+        }
+
+        outFd = openOutput(outputPath);
+        pwriteFull(outFd, output.data(), output.size(), 0);
+        counters.files++;
+        counters.bytes += size;
+    } catch (const exception& e) {
+        counters.fail(inputPath, e.what());
+    }
+    if (inFd >= 0) close(inFd);
+    if (outFd >= 0) close(outFd);
+}
+
+// Постановка задач для одного файла
+static void scheduleFile(TaskGroup& group, const fs::path& input, const fs::path& output, uint64_t size,
+                         const BatchOperation& operation, BatchCounters& counters) {
+    if (!operation.processChunk || size <= operation.chunkSize) {
+        group.run([input, output, &operation, &counters] {
+            processSmallFileTask(input.string(), output.string(), operation, counters);
+        });
+        return;
+    }
+
+    shared_ptr<ChunkedFile> file(new ChunkedFile());
+    file->path = input.string();
+    file->outputPath = output.string();
+    file->counters = &counters;
+    file->inputSize = size;
+    file->outputSize = operation.outputSize(size);
+    try {
+        file->inFd = openInput(input.string());
+        file->outFd = openOutput(output.string());
+        if (ftruncate(file->outFd, static_cast<off_t>(file->outputSize)) != 0) {
+            throw runtime_error(string("Ошибка выделения места: ") + strerror(errno));
+        }
+    } catch (const exception& e) {
+        file->failed = true;
+        counters.fail(input.string(), e.what());
+        return;
+    }
+
+    for (uint64_t offset = 0; offset < size; offset += operation.chunkSize) {
+        group.run([file, offset, &operation] {
+            processChunkTask(file, offset, operation.chunkSize, operation);
+        });
+    }
+}
+
+BatchStats processDirectory(const string& inputDir, const string& outputDir,
+                            const BatchOperation& operation, size_t threads) {
+    fs::path inputRoot = fs::weakly_canonical(inputDir);
+    fs::path outputRoot = fs::weakly_canonical(outputDir);
+    if (!fs::is_directory(inputRoot)) {
+        throw runtime_error("Входной каталог не найден: " + inputDir);
+    }
+
+    // Выходной каталог внутри входного попал бы в обход
+    fs::path relative = outputRoot.lexically_relative(inputRoot);
+    if (!relative.empty() && *relative.begin() != "..") {
+        throw runtime_error("Выходной каталог не может находиться внутри входного");
+    }
+    fs::create_directories(outputRoot);
+
+    BatchCounters counters;
+    auto start = chrono::steady_clock::now();
+    {
+        TaskGroup group(threads);
+        size_t pendingLimit = BATCH_PENDING_PER_THREAD * group.concurrency();
+
+        error_code ec;
+        fs::recursive_directory_iterator it(inputRoot, fs::directory_options::skip_permission_denied, ec);
+        if (ec) {
+            throw runtime_error("Не удалось открыть каталог: " + inputDir);
+        }
+        for (; it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (ec) {
+                counters.fail(inputDir, ec.message());
+                break;
+            }
+
+            const fs::directory_entry& entry = *it;
+            fs::path target = outputRoot / entry.path().lexically_relative(inputRoot);
+            try {
+                if (entry.is_directory()) {
+                    fs::create_directories(target);
+                } else if (entry.is_regular_file()) {
+                    scheduleFile(group, entry.path(), target, entry.file_size(), operation, counters);
+                    group.waitPendingBelow(pendingLimit);
+                }
+            } catch (const exception& e) {
+                counters.fail(entry.path().string(), e.what());
+            }
+        }
+
+        group.wait();
+    }
+
+    BatchStats stats;
+    stats.files = counters.files;
+    stats.bytes = counters.bytes;
+    stats.failures = counters.failures;
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    stats.errors = counters.errors;
+    return stats;
+}
+
+void printBatchStats(const BatchStats& stats) {
+    double seconds = max(stats.seconds, 1e-9);
+    cout << "Обработано файлов: " << stats.files << ", ошибок: " << stats.failures << endl;
+    cout << fixed << setprecision(2);
+    cout << "Объем: " << stats.bytes / 1048576.0 << " МБ за " << stats.seconds << " с" << endl;
+    cout << "Скорость: " << stats.files / seconds << " файлов/с, "
+         << stats.bytes / 1048576.0 / seconds << " МБ/с" << endl;
+    cout.unsetf(ios::floatfield);
+    for (const string& error : stats.errors) {
+        cerr << "  ✗ " << error << endl;
+    }
+}
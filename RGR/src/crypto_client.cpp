@@ -0,0 +1,115 @@
+#include "../include/crypto_client.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+static void read_exact(int fd, uint8_t* buffer, size_t size) {
+    while (size > 0) {
+        ssize_t got = read(fd, buffer, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) throw runtime_error(string("Ошибка чтения ответа демона: ") + strerror(errno));
+        if (got == 0) throw runtime_error("Демон закрыл соединение");
+        buffer += got;
+        size -= static_cast<size_t>(got);
+    }
+}
+
+static void write_exact(int fd, const uint8_t* buffer, size_t size) {
+    while (size > 0) {
+        ssize_t sent = ::send(fd, buffer, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) throw runtime_error(string("Ошибка отправки запроса демону: ") + strerror(errno));
+        buffer += sent;
+        size -= static_cast<size_t>(sent);
+    }
+}
+
+CryptoClient::CryptoClient(const string& socketPath) : fd(-1), nextId(1), sent(0), received(0) {
+    string path = socketPath.empty() ? defaultDaemonSocketPath() : socketPath;
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("Слишком длинный путь сокета: " + path);
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        string reason = strerror(errno);
+        if (fd >= 0) close(fd);
+        throw runtime_error("Не удалось подключиться к демону " + path + ": " + reason);
+    }
+}
+
+CryptoClient::~CryptoClient() {
+    close(fd);
+}
+
+uint64_t CryptoClient::send(const string& module, int operation, const vector<uint8_t>& key,
+                            const uint8_t* data, size_t size) {
+    if (module.size() > UINT8_MAX || key.size() > UINT16_MAX) {
+        throw invalid_argument("Слишком длинное имя модуля или ключ");
+    }
+    size_t body = module.size() + key.size() + size;
+    if (body > DAEMON_MAX_BODY) {
+        throw invalid_argument("Запрос больше " + to_string(DAEMON_MAX_BODY) + " байт");
+    }
+
+    DaemonRequestHeader header = {static_cast<uint32_t>(body), nextId++, static_cast<uint8_t>(operation),
+                                  static_cast<uint8_t>(module.size()), static_cast<uint16_t>(key.size())};
+    // Заголовок, имя и ключ — одной записью; данные отправляются без копирования
+    frame.resize(DAEMON_HEADER_SIZE);
+    writeDaemonRequestHeader(header, frame.data());
+    frame.insert(frame.end(), module.begin(), module.end());
+    frame.insert(frame.end(), key.begin(), key.end());
+    write_exact(fd, frame.data(), frame.size());
+    write_exact(fd, data, size);
+    sent++;
+    return header.id;
+}
+
+void CryptoClient::readResponse(CryptoResponse& response) {
+    uint8_t raw[DAEMON_HEADER_SIZE];
+    read_exact(fd, raw, sizeof(raw));
+    DaemonResponseHeader header;
+    if (!readDaemonResponseHeader(raw, header)) {
+        throw runtime_error("Неверный кадр ответа демона");
+    }
+    response.id = header.id;
+    response.status = header.status;
+    response.data.resize(header.bodyLength);
+    read_exact(fd, response.data.data(), response.data.size());
+}
+
+void CryptoClient::receive(CryptoResponse& response) {
+    if (pending() == 0) {
+        throw logic_error("Нет запросов, ожидающих ответа");
+    }
+    if (!deferred.empty()) {
+        auto first = deferred.begin();
+        response = std::move(first->second);
+        deferred.erase(first);
+    } else {
+        readResponse(response);
+    }
+    received++;
+}
+
+CryptoResponse CryptoClient::call(const string& module, int operation, const vector<uint8_t>& key,
+                                  const uint8_t* data, size_t size) {
+    uint64_t id = send(module, operation, key, data, size);
+    CryptoResponse response;
+    readResponse(response);
+    while (response.id != id) {
+        uint64_t other = response.id;
+        deferred[other] = std::move(response);
+        readResponse(response);
+    }
+    received++;
+    return response;
+}
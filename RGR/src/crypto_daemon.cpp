@@ -0,0 +1,400 @@
+#include "../include/crypto_daemon.h"
+#include "../include/crypto_metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+// Сокет читает поток reader, пишет — поток writer; потоки пула только
+// ставят готовые кадры ответов в очередь и никогда не ждут клиента
+struct CryptoDaemon::Connection {
+    int fd = -1;
+    thread reader;
+    thread writer;
+    atomic<bool> finished{false};
+
+    mutex stateMutex;
+    condition_variable changed;
+    // Запросы, принятые из сокета, ответ на которые еще не отправлен
+    size_t inFlight = 0;
+    deque<vector<uint8_t>> outbox;  // готовые кадры ответов
+    bool readerDone = false;
+    bool broken = false;            // клиент ушел, ответы отбрасываются
+};
+
+// Контекст init() модуля для одного ключа; освобождается, когда вытеснен
+// из кэша и завершены использующие его запросы
+struct CryptoDaemon::KeyContext {
+    const CryptoPluginDescriptor* plugin = nullptr;
+    void* context = nullptr;
+    mutex use;  // для модулей без CRYPTO_PLUGIN_CAP_THREAD_SAFE
+
+    ~KeyContext() {
+        if (plugin) plugin->free(context);
+    }
+};
+
+static bool read_full(int fd, uint8_t* buffer, size_t size) {
+    while (size > 0) {
+        ssize_t got = read(fd, buffer, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        buffer += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+// Число кадров, отправляемых одним системным вызовом
+const size_t DAEMON_SEND_BATCH = 64;
+
+// Все кадры подряд; sendmsg может принять их часть
+static bool send_frames(int fd, const vector<vector<uint8_t>>& frames) {
+    iovec parts[DAEMON_SEND_BATCH];
+    size_t count = 0;
+    for (const vector<uint8_t>& frame : frames) {
+        parts[count++] = {const_cast<uint8_t*>(frame.data()), frame.size()};
+    }
+    iovec* next = parts;
+    while (count > 0) {
+        msghdr message = {};
+        message.msg_iov = next;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        size_t done = static_cast<size_t>(sent);
+        while (count > 0 && done >= next->iov_len) {
+            done -= next->iov_len;
+            next++;
+            count--;
+        }
+        if (count > 0) {
+            next->iov_base = static_cast<uint8_t*>(next->iov_base) + done;
+            next->iov_len -= done;
+        }
+    }
+    return true;
+}
+
+CryptoDaemon::CryptoDaemon(PluginRegistry& registry, const DaemonOptions& daemonOptions)
+    : registry(registry), options(daemonOptions), requests(daemonOptions.threads), listenFd(-1),
+      stopping(false), served(0), failed(0) {
+    if (options.socketPath.empty()) {
+        options.socketPath = defaultDaemonSocketPath();
+    }
+    if (options.maxInFlight == 0) {
+        options.maxInFlight = 1;
+    }
+    if (pipe2(wakePipe, O_CLOEXEC) != 0) {
+        throw runtime_error("Не удалось создать канал остановки демона");
+    }
+}
+
+CryptoDaemon::~CryptoDaemon() {
+    stopping = true;
+    reapConnections(true);
+    requests.wait();
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(options.socketPath.c_str());
+    }
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+    // Контексты освобождаются модулями, которые еще загружены в реестре
+    keys.clear();
+    keyOrder.clear();
+}
+
+bool CryptoDaemon::listen(string& error) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (options.socketPath.size() >= sizeof(address.sun_path)) {
+        error = "слишком длинный путь сокета " + options.socketPath;
+        return false;
+    }
+    memcpy(address.sun_path, options.socketPath.c_str(), options.socketPath.size() + 1);
+
+    // Сокет, оставшийся от прежнего запуска, удаляется; работающий демон — нет
+    struct stat info;
+    if (lstat(options.socketPath.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            error = options.socketPath + " существует и не является сокетом";
+            return false;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool alive = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        if (probe >= 0) close(probe);
+        if (alive) {
+            error = "демон уже работает на " + options.socketPath;
+            return false;
+        }
+        unlink(options.socketPath.c_str());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = string("socket: ") + strerror(errno);
+        return false;
+    }
+    // Подключаться может только владелец
+    mode_t previous = umask(077);
+    int bound = bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    umask(previous);
+    if (bound != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        error = options.socketPath + ": " + strerror(errno);
+        close(fd);
+        return false;
+    }
+    listenFd = fd;
+    return true;
+}
+
+void CryptoDaemon::stop() {
+    stopping = true;
+    char signal = 0;
+    ssize_t ignored = write(wakePipe[1], &signal, 1);
+    (void)ignored;
+}
+
+void CryptoDaemon::serve() {
+    while (!stopping) {
+        pollfd fds[2] = {{listenFd, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+        // Раз в секунду закрываются соединения, завершенные клиентами
+        int ready = poll(fds, 2, 1000);
+        if (ready < 0 && errno != EINTR) break;
+        reapConnections(false);
+        if (ready <= 0 || (fds[1].revents & POLLIN)) continue;
+
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+
+        unique_ptr<Connection> connection(new Connection());
+        connection->fd = fd;
+        Connection& accepted = *connection;
+        lock_guard<mutex> lock(connectionsMutex);
+        connections.push_back(std::move(connection));
+        accepted.writer = thread([this, &accepted] { writeResponses(accepted); });
+        accepted.reader = thread([this, &accepted] { readRequests(accepted); });
+    }
+
+    // Новые запросы не читаются, принятые дорабатываются
+    {
+        lock_guard<mutex> lock(connectionsMutex);
+        for (const unique_ptr<Connection>& connection : connections) {
+            shutdown(connection->fd, SHUT_RD);
+        }
+    }
+    reapConnections(true);
+    requests.wait();
+}
+
+void CryptoDaemon::reapConnections(bool all) {
+    lock_guard<mutex> lock(connectionsMutex);
+    for (auto it = connections.begin(); it != connections.end();) {
+        Connection& connection = **it;
+        if (!all && !connection.finished) {
+            ++it;
+            continue;
+        }
+        if (connection.reader.joinable()) connection.reader.join();
+        if (connection.writer.joinable()) connection.writer.join();
+        close(connection.fd);
+        it = connections.erase(it);
+    }
+}
+
+void CryptoDaemon::readRequests(Connection& connection) {
+    uint8_t raw[DAEMON_HEADER_SIZE];
+    while (read_full(connection.fd, raw, sizeof(raw))) {
+        // Нарушение формата кадра — соединение закрывается
+        DaemonRequestHeader header;
+        if (!readDaemonRequestHeader(raw, header)) break;
+        shared_ptr<vector<uint8_t>> body = make_shared<vector<uint8_t>>(header.bodyLength);
+        if (!read_full(connection.fd, body->data(), body->size())) break;
+
+        // Клиент, не читающий ответы, упирается в maxInFlight:
+        // приостанавливается только чтение его запросов
+        {
+            unique_lock<mutex> lock(connection.stateMutex);
+            connection.changed.wait(lock, [&] { return connection.inFlight < options.maxInFlight; });
+            connection.inFlight++;
+        }
+        requests.run([this, &connection, header, body] { process(connection, header, *body); });
+    }
+
+    lock_guard<mutex> lock(connection.stateMutex);
+    connection.readerDone = true;
+    connection.changed.notify_all();
+}
+
+void CryptoDaemon::writeResponses(Connection& connection) {
+    unique_lock<mutex> lock(connection.stateMutex);
+    for (;;) {
+        // Соединение живет, пока не отправлены ответы на все принятые запросы
+        connection.changed.wait(lock, [&] {
+            return !connection.outbox.empty() || (connection.readerDone && connection.inFlight == 0);
+        });
+        if (connection.outbox.empty()) break;
+
+        // Накопившиеся ответы уходят вместе
+        vector<vector<uint8_t>> frames;
+        while (!connection.outbox.empty() && frames.size() < DAEMON_SEND_BATCH) {
+            frames.push_back(std::move(connection.outbox.front()));
+            connection.outbox.pop_front();
+        }
+        if (!connection.broken) {
+            lock.unlock();
+            bool sent = send_frames(connection.fd, frames);
+            lock.lock();
+            if (!sent) {
+                // Клиент ушел: остальные ответы отбрасываются, чтение прекращается
+                connection.broken = true;
+                shutdown(connection.fd, SHUT_RDWR);
+            }
+        }
+        connection.inFlight -= frames.size();
+        connection.changed.notify_all();
+    }
+    connection.finished = true;
+}
+
+shared_ptr<CryptoDaemon::KeyContext> CryptoDaemon::keyContext(const string& module, const uint8_t* key,
+                                                              size_t keyLength, int& status, string& error) {
+    string cacheKey = module;
+    cacheKey.push_back('\0');
+    cacheKey.append(reinterpret_cast<const char*>(key), keyLength);
+    {
+        lock_guard<mutex> lock(keysMutex);
+        auto found = keys.find(cacheKey);
+        if (found != keys.end()) {
+            keyOrder.splice(keyOrder.begin(), keyOrder, found->second.order);
+            return found->second.context;
+        }
+    }
+
+    const CryptoPluginDescriptor* plugin = registry.descriptor(module, error);
+    if (!plugin) {
+        status = CRYPTO_PLUGIN_ERR_UNSUPPORTED;
+        error = module + ": " + error;
+        return nullptr;
+    }
+    if (!(plugin->capabilities & CRYPTO_PLUGIN_CAP_KEY) && keyLength > 0) {
+        status = CRYPTO_PLUGIN_ERR_KEY;
+        error = "модулю " + module + " ключ не нужен";
+        return nullptr;
+    }
+
+    // init может быть дорогим (таблицы RSA), поэтому выполняется без блокировки;
+    // при гонке остается контекст, попавший в кэш первым
+    void* context = nullptr;
+    status = plugin->init(key, keyLength, &context);
+    if (status != CRYPTO_PLUGIN_OK) {
+        error = cryptoPluginStatusText(status);
+        return nullptr;
+    }
+    shared_ptr<KeyContext> created = make_shared<KeyContext>();
+    created->plugin = plugin;
+    created->context = context;
+
+    lock_guard<mutex> lock(keysMutex);
+    auto found = keys.find(cacheKey);
+    if (found != keys.end()) {
+        keyOrder.splice(keyOrder.begin(), keyOrder, found->second.order);
+        return found->second.context;
+    }
+    // Вытесняется ключ, дольше всех не использованный
+    while (!keyOrder.empty() && keys.size() >= options.keyCacheSize) {
+        keys.erase(keyOrder.back());
+        keyOrder.pop_back();
+    }
+    keyOrder.push_front(cacheKey);
+    keys.emplace(cacheKey, CachedKey{created, keyOrder.begin()});
+    return created;
+}
+
+// Время обработки запроса вместе с отправкой ответа
+static OperationMetric requestMetric("daemon_request", "Запрос к демону");
+
+void CryptoDaemon::process(Connection& connection, const DaemonRequestHeader& header, vector<uint8_t>& body) {
+    MetricTimer timer(requestMetric, body.size());
+    int status = CRYPTO_PLUGIN_OK;
+    string error;
+    try {
+        string module(reinterpret_cast<const char*>(body.data()), header.moduleLength);
+        const uint8_t* key = body.data() + header.moduleLength;
+        const uint8_t* data = key + header.keyLength;
+        size_t size = body.size() - header.moduleLength - header.keyLength;
+        bool encrypt = header.operation == CRYPTO_PLUGIN_ENCRYPT;
+
+        shared_ptr<KeyContext> context;
+        if (!encrypt && header.operation != CRYPTO_PLUGIN_DECRYPT) {
+            status = CRYPTO_PLUGIN_ERR_ARGUMENT;
+            error = "неизвестная операция";
+        } else {
+            context = keyContext(module, key, header.keyLength, status, error);
+        }
+
+        if (context) {
+            const CryptoPluginDescriptor* plugin = context->plugin;
+            if (!(plugin->capabilities & (encrypt ? CRYPTO_PLUGIN_CAP_ENCRYPT : CRYPTO_PLUGIN_CAP_DECRYPT))) {
+                status = CRYPTO_PLUGIN_ERR_UNSUPPORTED;
+                error = cryptoPluginStatusText(status);
+            } else {
+                unique_lock<mutex> lock(context->use, defer_lock);
+                if (!(plugin->capabilities & CRYPTO_PLUGIN_CAP_THREAD_SAFE)) lock.lock();
+
+                // Результат пишется сразу в кадр ответа после места под заголовок
+                auto run = encrypt ? plugin->encrypt : plugin->decrypt;
+                vector<uint8_t> frame(DAEMON_HEADER_SIZE + plugin->maxOutput(context->context, header.operation, size));
+                size_t produced = 0;
+                status = run(context->context, data, size, frame.data() + DAEMON_HEADER_SIZE,
+                             frame.size() - DAEMON_HEADER_SIZE, &produced);
+                if (status == CRYPTO_PLUGIN_ERR_BUFFER) {
+                    frame.resize(DAEMON_HEADER_SIZE + produced);
+                    status = run(context->context, data, size, frame.data() + DAEMON_HEADER_SIZE,
+                                 frame.size() - DAEMON_HEADER_SIZE, &produced);
+                }
+                if (status == CRYPTO_PLUGIN_OK && produced > UINT32_MAX) {
+                    status = CRYPTO_PLUGIN_ERR_BUFFER;
+                }
+                if (status == CRYPTO_PLUGIN_OK) {
+                    served++;
+                    frame.resize(DAEMON_HEADER_SIZE + produced);
+                    respond(connection, header.id, status, std::move(frame));
+                    return;
+                }
+                error = cryptoPluginStatusText(status);
+            }
+        }
+    } catch (const exception& e) {
+        status = CRYPTO_PLUGIN_ERR_INTERNAL;
+        error = e.what();
+    }
+    failed++;
+    timer.fail();
+    vector<uint8_t> frame(DAEMON_HEADER_SIZE + error.size());
+    copy(error.begin(), error.end(), frame.begin() + DAEMON_HEADER_SIZE);
+    respond(connection, header.id, status, std::move(frame));
+}
+
+void CryptoDaemon::respond(Connection& connection, uint64_t id, int status, vector<uint8_t>&& frame) {
+    DaemonResponseHeader header = {static_cast<uint32_t>(frame.size() - DAEMON_HEADER_SIZE), id, status};
+    writeDaemonResponseHeader(header, frame.data());
+
+    lock_guard<mutex> lock(connection.stateMutex);
+    connection.outbox.push_back(std::move(frame));
+    connection.changed.notify_all();
+}
@@ -0,0 +1,159 @@
+// Генератор нагрузки для демона crypto_system:
+//   crypto_loadgen [--socket ПУТЬ] [--module morse] [--operation encrypt|decrypt] [--key-hex HEX]
+//                  [--size БАЙТ] [--requests N] [--connections N] [--depth N]
+// Каждое соединение держит до depth запросов без ответа (конвейер).
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../include/crypto_client.h"
+
+using namespace std;
+
+struct LoadOptions {
+    string socket;
+    string module = "morse";
+    int operation = CRYPTO_PLUGIN_ENCRYPT;
+    vector<uint8_t> key;
+    size_t size = 1024;
+    size_t requests = 10000;
+    size_t connections = 4;
+    size_t depth = 16;
+};
+
+struct LoadResult {
+    vector<double> latencies;  // мкс
+    size_t errors = 0;
+    string firstError;
+};
+
+static void usage() {
+    cerr << "Использование: crypto_loadgen [--socket ПУТЬ] [--module ИМЯ] [--operation encrypt|decrypt]\n"
+         << "                      [--key-hex HEX] [--size БАЙТ] [--requests N] [--connections N] [--depth N]" << endl;
+}
+
+static bool parse_hex(const string& hex, vector<uint8_t>& out) {
+    if (hex.size() % 2 != 0) return false;
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        if (!isxdigit(static_cast<unsigned char>(hex[i])) || !isxdigit(static_cast<unsigned char>(hex[i + 1]))) {
+            return false;
+        }
+        out.push_back(static_cast<uint8_t>(stoul(hex.substr(i, 2), nullptr, 16)));
+    }
+    return true;
+}
+
+static void run_connection(const LoadOptions& options, size_t quota, const vector<uint8_t>& payload,
+                           LoadResult& result) {
+    typedef chrono::steady_clock Clock;
+    CryptoClient client(options.socket);
+    unordered_map<uint64_t, Clock::time_point> started;
+    CryptoResponse response;
+    size_t sent = 0;
+    while (sent < quota || client.pending() > 0) {
+        while (sent < quota && client.pending() < options.depth) {
+            uint64_t id = client.send(options.module, options.operation, options.key, payload.data(), payload.size());
+            started[id] = Clock::now();
+            sent++;
+        }
+        client.receive(response);
+        auto finished = Clock::now();
+        auto it = started.find(response.id);
+        result.latencies.push_back(chrono::duration<double, micro>(finished - it->second).count());
+        started.erase(it);
+        if (!response.ok()) {
+            if (result.errors++ == 0) result.firstError = response.error();
+        }
+    }
+}
+
+static double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (i + 1 >= argc) throw invalid_argument(arg);
+            string value = argv[++i];
+            if (arg == "--socket") options.socket = value;
+            else if (arg == "--module") options.module = value;
+            else if (arg == "--operation" && (value == "encrypt" || value == "decrypt"))
+                options.operation = value == "encrypt" ? CRYPTO_PLUGIN_ENCRYPT : CRYPTO_PLUGIN_DECRYPT;
+            else if (arg == "--key-hex" && parse_hex(value, options.key)) continue;
+            else if (arg == "--size") options.size = stoul(value);
+            else if (arg == "--requests") options.requests = stoul(value);
+            else if (arg == "--connections") options.connections = max<size_t>(1, stoul(value));
+            else if (arg == "--depth") options.depth = max<size_t>(1, stoul(value));
+            else throw invalid_argument(arg);
+        }
+    } catch (const exception&) {
+        usage();
+        return 2;
+    }
+
+    // Текст из латинских букв и пробелов подходит всем модулям
+    vector<uint8_t> payload(options.size);
+    mt19937 random(12345);
+    for (uint8_t& byte : payload) {
+        int letter = static_cast<int>(random() % 27);
+        byte = static_cast<uint8_t>(letter == 26 ? ' ' : 'A' + letter);
+    }
+
+    vector<LoadResult> results(options.connections);
+    vector<thread> workers;
+    mutex errorMutex;
+    string connectionError;
+    auto start = chrono::steady_clock::now();
+    for (size_t c = 0; c < options.connections; c++) {
+        size_t quota = options.requests / options.connections + (c < options.requests % options.connections ? 1 : 0);
+        workers.emplace_back([&, c, quota] {
+            try {
+                run_connection(options, quota, payload, results[c]);
+            } catch (const exception& e) {
+                lock_guard<mutex> lock(errorMutex);
+                connectionError = e.what();
+            }
+        });
+    }
+    for (thread& worker : workers) worker.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (!connectionError.empty()) {
+        cerr << "✗ " << connectionError << endl;
+        return 1;
+    }
+
+    vector<double> latencies;
+    size_t errors = 0;
+    for (const LoadResult& result : results) {
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        if (result.errors > 0 && errors == 0) {
+            cerr << "Первая ошибка: " << result.firstError << endl;
+        }
+        errors += result.errors;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    cout << fixed << setprecision(1);
+    cout << "Запросов: " << latencies.size() << ", ошибок: " << errors << ", время: " << seconds << " с" << endl;
+    cout << "Соединений: " << options.connections << ", глубина конвейера: " << options.depth
+         << ", размер запроса: " << options.size << " байт" << endl;
+    cout << "Пропускная способность: " << latencies.size() / seconds << " запросов/с, "
+         << latencies.size() * options.size / seconds / (1024 * 1024) << " МБ/с" << endl;
+    cout << "Задержка, мкс: p50 " << percentile(latencies, 0.5) << ", p90 " << percentile(latencies, 0.9)
+         << ", p99 " << percentile(latencies, 0.99) << ", макс " << (latencies.empty() ? 0 : latencies.back()) << endl;
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,279 @@
+#include "../include/crypto_metrics.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+using namespace std;
+
+// ==================== ХРАНЕНИЕ ====================
+
+// Счетчики одной метрики в одном потоке. Пишет только поток-владелец
+// (загрузка и запись без атомарного сложения), читает снимок.
+struct MetricShard {
+    atomic<uint64_t> count{0};
+    atomic<uint64_t> errors{0};
+    atomic<uint64_t> bytes{0};
+    atomic<uint64_t> totalNs{0};
+    atomic<uint64_t> maxNs{0};
+    array<atomic<uint64_t>, METRIC_BUCKETS> buckets{};
+};
+
+static void bump(atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+struct ThreadMetrics;
+
+struct MetricsRegistry {
+    mutex mtx;
+    vector<pair<string, string>> metrics;  // имя и описание
+    list<ThreadMetrics*> threads;
+    // Счетчики завершившихся потоков
+    array<unique_ptr<MetricShard>, METRIC_MAX_COUNT> retired;
+};
+
+// Реестр не разрушается: потоки могут завершаться после статических объектов
+static MetricsRegistry& metricsRegistry() {
+    static MetricsRegistry* registry = new MetricsRegistry;
+    return *registry;
+}
+
+static void addShard(MetricShard& to, const MetricShard& from) {
+    bump(to.count, from.count.load(memory_order_relaxed));
+    bump(to.errors, from.errors.load(memory_order_relaxed));
+    bump(to.bytes, from.bytes.load(memory_order_relaxed));
+    bump(to.totalNs, from.totalNs.load(memory_order_relaxed));
+    to.maxNs.store(max(to.maxNs.load(memory_order_relaxed), from.maxNs.load(memory_order_relaxed)),
+                   memory_order_relaxed);
+    for (size_t i = 0; i < METRIC_BUCKETS; i++) {
+        bump(to.buckets[i], from.buckets[i].load(memory_order_relaxed));
+    }
+}
+
+struct ThreadMetrics {
+    array<atomic<MetricShard*>, METRIC_MAX_COUNT> shards{};
+
+    ThreadMetrics() {
+        MetricsRegistry& registry = metricsRegistry();
+        lock_guard<mutex> lock(registry.mtx);
+        registry.threads.push_back(this);
+    }
+
+    // При завершении потока его счетчики переносятся в общие
+    ~ThreadMetrics() {
+        MetricsRegistry& registry = metricsRegistry();
+        lock_guard<mutex> lock(registry.mtx);
+        registry.threads.remove(this);
+        for (size_t i = 0; i < METRIC_MAX_COUNT; i++) {
+            unique_ptr<MetricShard> shard(shards[i].load());
+            if (!shard) continue;
+            if (!registry.retired[i]) registry.retired[i].reset(new MetricShard);
+            addShard(*registry.retired[i], *shard);
+        }
+    }
+
+    MetricShard* shard(size_t index) {
+        MetricShard* shard = shards[index].load(memory_order_relaxed);
+        if (!shard) {
+            shard = new (nothrow) MetricShard;
+            shards[index].store(shard, memory_order_release);
+        }
+        return shard;
+    }
+};
+
+static size_t bucketIndex(uint64_t value) {
+    if (value < METRIC_SUB_COUNT) return static_cast<size_t>(value);
+    unsigned power = 63 - __builtin_clzll(value);
+    return (power - METRIC_SUB_BITS + 1) * METRIC_SUB_COUNT +
+           ((value >> (power - METRIC_SUB_BITS)) & (METRIC_SUB_COUNT - 1));
+}
+
+// Верхняя граница поддиапазона (не включительно)
+static uint64_t bucketLimit(size_t index) {
+    if (index < METRIC_SUB_COUNT) return index + 1;
+    size_t group = index / METRIC_SUB_COUNT;
+    uint64_t sub = index % METRIC_SUB_COUNT;
+    if (group == METRIC_BUCKETS / METRIC_SUB_COUNT - 1 && sub == METRIC_SUB_COUNT - 1) return UINT64_MAX;
+    return (METRIC_SUB_COUNT + sub + 1) << (group - 1);
+}
+
+// ==================== ЗАПИСЬ ====================
+
+OperationMetric::OperationMetric(const char* name, const char* help) {
+    MetricsRegistry& registry = metricsRegistry();
+    lock_guard<mutex> lock(registry.mtx);
+    for (index = 0; index < registry.metrics.size(); index++) {
+        if (registry.metrics[index].first == name) return;
+    }
+    if (index < METRIC_MAX_COUNT) {
+        registry.metrics.emplace_back(name, help);
+    }
+}
+
+void OperationMetric::record(uint64_t nanoseconds, uint64_t bytes, bool failed) noexcept {
+    if (index >= METRIC_MAX_COUNT) return;
+    static thread_local ThreadMetrics threadMetrics;
+    MetricShard* shard = threadMetrics.shard(index);
+    if (!shard) return;
+
+    bump(shard->count, 1);
+    if (failed) bump(shard->errors, 1);
+    bump(shard->bytes, bytes);
+    bump(shard->totalNs, nanoseconds);
+    if (nanoseconds > shard->maxNs.load(memory_order_relaxed)) {
+        shard->maxNs.store(nanoseconds, memory_order_relaxed);
+    }
+    bump(shard->buckets[bucketIndex(nanoseconds)], 1);
+}
+
+bool metricsEnabled() {
+    static const bool enabled = [] {
+        const char* value = getenv("CRYPTO_SYSTEM_METRICS");
+        return !value || strcmp(value, "0") != 0;
+    }();
+    return enabled;
+}
+
+// ==================== СНИМОК ====================
+
+uint64_t MetricSnapshot::percentile(double q) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * count + 0.5);
+    rank = min(max<uint64_t>(rank, 1), count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) return min(bucketLimit(i) - 1, maxNs);
+    }
+    return maxNs;
+}
+
+uint64_t MetricSnapshot::countBelowPowerOfTwo(unsigned power) const {
+    size_t end = power < METRIC_SUB_BITS ? (size_t(1) << power)
+                                         : min(METRIC_BUCKETS, (power - METRIC_SUB_BITS + 1) * METRIC_SUB_COUNT);
+    uint64_t total = 0;
+    for (size_t i = 0; i < end; i++) total += buckets[i];
+    return total;
+}
+
+vector<MetricSnapshot> snapshotMetrics() {
+    MetricsRegistry& registry = metricsRegistry();
+    lock_guard<mutex> lock(registry.mtx);
+
+    vector<MetricSnapshot> result;
+    for (size_t i = 0; i < registry.metrics.size(); i++) {
+        MetricShard sum;
+        if (registry.retired[i]) addShard(sum, *registry.retired[i]);
+        for (ThreadMetrics* thread : registry.threads) {
+            MetricShard* shard = thread->shards[i].load(memory_order_acquire);
+            if (shard) addShard(sum, *shard);
+        }
+        if (sum.count.load() == 0) continue;
+
+        MetricSnapshot snapshot;
+        snapshot.name = registry.metrics[i].first;
+        snapshot.help = registry.metrics[i].second;
+        snapshot.count = sum.count.load();
+        snapshot.errors = sum.errors.load();
+        snapshot.bytes = sum.bytes.load();
+        snapshot.totalNs = sum.totalNs.load();
+        snapshot.maxNs = sum.maxNs.load();
+        snapshot.buckets.resize(METRIC_BUCKETS);
+        for (size_t b = 0; b < METRIC_BUCKETS; b++) {
+            snapshot.buckets[b] = sum.buckets[b].load();
+        }
+        result.push_back(std::move(snapshot));
+    }
+    return result;
+}
+
+// ==================== ВЫВОД ====================
+
+// Границы гистограммы Prometheus: степени двойки от ~1 мкс до ~17 с
+const unsigned PROMETHEUS_FIRST_POWER = 10;
+const unsigned PROMETHEUS_LAST_POWER = 34;
+
+static string jsonEscape(const string& text) {
+    string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            result += code;
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+void writeMetricsJson(ostream& out) {
+    vector<MetricSnapshot> snapshots = snapshotMetrics();
+    ostringstream text;
+    text << "{\"metrics\": [";
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        const MetricSnapshot& m = snapshots[i];
+        text << (i ? ",\n  " : "\n  ")
+             << "{\"name\": \"" << jsonEscape(m.name) << "\", \"help\": \"" << jsonEscape(m.help) << "\", "
+             << "\"count\": " << m.count << ", \"errors\": " << m.errors << ", \"bytes\": " << m.bytes << ", "
+             << "\"total_ns\": " << m.totalNs << ", \"max_ns\": " << m.maxNs << ", "
+             << "\"p50_ns\": " << m.percentile(0.5) << ", \"p90_ns\": " << m.percentile(0.9) << ", "
+             << "\"p99_ns\": " << m.percentile(0.99) << ", \"p999_ns\": " << m.percentile(0.999) << "}";
+    }
+    text << (snapshots.empty() ? "]}\n" : "\n]}\n");
+    out << text.str() << flush;
+}
+
+void writeMetricsPrometheus(ostream& out) {
+    vector<MetricSnapshot> snapshots = snapshotMetrics();
+    ostringstream text;
+    text << setprecision(9);
+
+    text << "# HELP crypto_operation_duration_seconds Длительность операций модулей\n"
+         << "# TYPE crypto_operation_duration_seconds histogram\n";
+    for (const MetricSnapshot& m : snapshots) {
+        string label = "operation=\"" + m.name + "\"";
+        for (unsigned power = PROMETHEUS_FIRST_POWER; power <= PROMETHEUS_LAST_POWER; power++) {
+            text << "crypto_operation_duration_seconds_bucket{" << label << ",le=\""
+                 << static_cast<double>(uint64_t(1) << power) * 1e-9 << "\"} " << m.countBelowPowerOfTwo(power) << "\n";
+        }
+        text << "crypto_operation_duration_seconds_bucket{" << label << ",le=\"+Inf\"} " << m.count << "\n"
+             << "crypto_operation_duration_seconds_sum{" << label << "} " << m.totalNs * 1e-9 << "\n"
+             << "crypto_operation_duration_seconds_count{" << label << "} " << m.count << "\n";
+    }
+
+    text << "# HELP crypto_operation_errors_total Операции, завершившиеся ошибкой\n"
+         << "# TYPE crypto_operation_errors_total counter\n";
+    for (const MetricSnapshot& m : snapshots) {
+        text << "crypto_operation_errors_total{operation=\"" << m.name << "\"} " << m.errors << "\n";
+    }
+    text << "# HELP crypto_operation_bytes_total Объем данных операций\n"
+         << "# TYPE crypto_operation_bytes_total counter\n";
+    for (const MetricSnapshot& m : snapshots) {
+        text << "crypto_operation_bytes_total{operation=\"" << m.name << "\"} " << m.bytes << "\n";
+    }
+    out << text.str() << flush;
+}
+
+bool writeMetrics(ostream& out, const string& format) {
+    if (format == "json") {
+        writeMetricsJson(out);
+    } else if (format == "prometheus") {
+        writeMetricsPrometheus(out);
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,242 @@
+#include "../include/crypto_pipeline.h"
+#include "../include/bounded_queue.h"
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+static const char PIPELINE_MAGIC[8] = {'C', 'S', 'P', 'I', 'P', 'E', '0', '1'};
+static const uint32_t PIPELINE_END = 0xFFFFFFFFu;
+// Защита от огромного выделения памяти на поврежденном входе
+static const uint32_t PIPELINE_MAX_FRAME = 1u << 30;
+
+// Чтение до size байт; меньше — только в конце потока
+static size_t read_up_to(int fd, uint8_t* buffer, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = read(fd, buffer + total, size - total);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw runtime_error(string("Ошибка чтения: ") + strerror(errno));
+        if (n == 0) break;
+        total += static_cast<size_t>(n);
+    }
+    return total;
+}
+
+static void read_exact(int fd, uint8_t* buffer, size_t size) {
+    if (read_up_to(fd, buffer, size) != size) {
+        throw runtime_error("Поток конвейера оборван");
+    }
+}
+
+static void write_all(int fd, const uint8_t* buffer, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, buffer, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw runtime_error(string("Ошибка записи: ") + strerror(errno));
+        buffer += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+static void write_u32(int fd, uint32_t value) {
+    uint8_t raw[4] = {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+                      static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)};
+    write_all(fd, raw, sizeof(raw));
+}
+
+static bool read_u32(int fd, uint32_t& value) {
+    uint8_t raw[4];
+    size_t got = read_up_to(fd, raw, sizeof(raw));
+    if (got == 0) return false;
+    if (got != sizeof(raw)) throw runtime_error("Поток конвейера оборван");
+    value = raw[0] | (raw[1] << 8) | (raw[2] << 16) | (static_cast<uint32_t>(raw[3]) << 24);
+    return true;
+}
+
+static void apply_stage(const PipelineStage& stage, bool encrypt, const vector<uint8_t>& in, vector<uint8_t>& out) {
+    int operation = encrypt ? CRYPTO_PLUGIN_ENCRYPT : CRYPTO_PLUGIN_DECRYPT;
+    auto run = encrypt ? stage.plugin->encrypt : stage.plugin->decrypt;
+    out.resize(stage.plugin->maxOutput(stage.context, operation, in.size()));
+    size_t produced = 0;
+    int status = run(stage.context, in.data(), in.size(), out.data(), out.size(), &produced);
+    if (status == CRYPTO_PLUGIN_ERR_BUFFER) {
+        out.resize(produced);
+        status = run(stage.context, in.data(), in.size(), out.data(), out.size(), &produced);
+    }
+    if (status != CRYPTO_PLUGIN_OK) {
+        throw runtime_error("Стадия " + stage.name + ": " + cryptoPluginStatusText(status));
+    }
+    out.resize(produced);
+}
+
+typedef function<bool(vector<uint8_t>&)> ChunkSource;
+typedef function<void(const vector<uint8_t>&)> ChunkSink;
+
+// source выполняется в потоке чтения, стадии — каждая в своем потоке,
+// sink — в вызывающем. Первая ошибка закрывает все очереди и пробрасывается.
+static void run_chain(const vector<PipelineStage>& stages, bool encrypt, size_t queueDepth,
+                      const ChunkSource& source, const ChunkSink& sink) {
+    typedef BoundedQueue<vector<uint8_t>> ChunkQueue;
+    size_t count = stages.size();
+    vector<unique_ptr<ChunkQueue>> queues;
+    for (size_t i = 0; i <= count; i++) {
+        queues.emplace_back(new ChunkQueue(max<size_t>(1, queueDepth)));
+    }
+
+    mutex errorMutex;
+    exception_ptr firstError;
+    auto fail = [&](exception_ptr error) {
+        {
+            lock_guard<mutex> lock(errorMutex);
+            if (!firstError) firstError = error;
+        }
+        for (const unique_ptr<ChunkQueue>& queue : queues) queue->close();
+    };
+
+    vector<thread> threads;
+    threads.emplace_back([&] {
+        try {
+            vector<uint8_t> chunk;
+            while (source(chunk) && queues[0]->push(std::move(chunk))) {
+                chunk = vector<uint8_t>();
+            }
+        } catch (...) {
+            fail(current_exception());
+        }
+        queues[0]->close();
+    });
+
+    for (size_t i = 0; i < count; i++) {
+        threads.emplace_back([&, i] {
+            const PipelineStage& stage = encrypt ? stages[i] : stages[count - 1 - i];
+            try {
+                vector<uint8_t> in, out;
+                while (queues[i]->pop(in)) {
+                    apply_stage(stage, encrypt, in, out);
+                    if (!queues[i + 1]->push(std::move(out))) break;
+                    // Буфер входа порции становится буфером следующего результата
+                    out = std::move(in);
+                }
+            } catch (...) {
+                fail(current_exception());
+            }
+            queues[i + 1]->close();
+        });
+    }
+
+    try {
+        vector<uint8_t> chunk;
+        while (queues[count]->pop(chunk)) {
+            sink(chunk);
+        }
+    } catch (...) {
+        fail(current_exception());
+    }
+
+    for (thread& worker : threads) worker.join();
+    if (firstError) rethrow_exception(firstError);
+}
+
+PipelineStats encryptPipeline(const vector<PipelineStage>& stages, int inFd, int outFd,
+                              size_t chunkSize, size_t queueDepth) {
+    if (stages.empty() || stages.size() > UINT8_MAX) {
+        throw invalid_argument("Неверное число стадий конвейера");
+    }
+    if (chunkSize == 0) chunkSize = PIPELINE_DEFAULT_CHUNK;
+
+    vector<uint8_t> header(PIPELINE_MAGIC, PIPELINE_MAGIC + sizeof(PIPELINE_MAGIC));
+    header.push_back(static_cast<uint8_t>(stages.size()));
+    for (const PipelineStage& stage : stages) {
+        if (stage.name.empty() || stage.name.size() > UINT8_MAX) {
+            throw invalid_argument("Неверное имя стадии конвейера");
+        }
+        header.push_back(static_cast<uint8_t>(stage.name.size()));
+        header.insert(header.end(), stage.name.begin(), stage.name.end());
+    }
+    write_all(outFd, header.data(), header.size());
+
+    PipelineStats stats;
+    stats.bytesOut = header.size();
+    run_chain(stages, true, queueDepth,
+        [&](vector<uint8_t>& chunk) {
+            chunk.resize(chunkSize);
+            chunk.resize(read_up_to(inFd, chunk.data(), chunkSize));
+            stats.bytesIn += chunk.size();
+            return !chunk.empty();
+        },
+        [&](const vector<uint8_t>& chunk) {
+            if (chunk.size() >= PIPELINE_MAX_FRAME) {
+                throw runtime_error("Слишком большая порция результата, уменьшите размер порции");
+            }
+            write_u32(outFd, static_cast<uint32_t>(chunk.size()));
+            write_all(outFd, chunk.data(), chunk.size());
+            stats.bytesOut += 4 + chunk.size();
+            stats.chunks++;
+        });
+
+    // Метка конца — только после успешной обработки всех порций
+    write_u32(outFd, PIPELINE_END);
+    stats.bytesOut += 4;
+    return stats;
+}
+
+vector<string> readPipelineHeader(int inFd) {
+    uint8_t magic[sizeof(PIPELINE_MAGIC) + 1];
+    if (read_up_to(inFd, magic, sizeof(magic)) != sizeof(magic) ||
+        memcmp(magic, PIPELINE_MAGIC, sizeof(PIPELINE_MAGIC)) != 0 || magic[sizeof(PIPELINE_MAGIC)] == 0) {
+        throw runtime_error("Вход не является результатом конвейера");
+    }
+
+    vector<string> names(magic[sizeof(PIPELINE_MAGIC)]);
+    for (string& name : names) {
+        uint8_t length;
+        read_exact(inFd, &length, 1);
+        name.resize(length);
+        read_exact(inFd, reinterpret_cast<uint8_t*>(&name[0]), length);
+    }
+    return names;
+}
+
+PipelineStats decryptPipeline(const vector<PipelineStage>& stages, int inFd, int outFd, size_t queueDepth) {
+    if (stages.empty()) {
+        throw invalid_argument("Неверное число стадий конвейера");
+    }
+
+    PipelineStats stats;
+    bool finished = false;
+    run_chain(stages, false, queueDepth,
+        [&](vector<uint8_t>& chunk) {
+            uint32_t length;
+            if (!read_u32(inFd, length)) {
+                throw runtime_error("Поток конвейера оборван: нет метки конца");
+            }
+            if (length == PIPELINE_END) {
+                finished = true;
+                return false;
+            }
+            if (length >= PIPELINE_MAX_FRAME) {
+                throw runtime_error("Поврежденный поток конвейера");
+            }
+            chunk.resize(length);
+            read_exact(inFd, chunk.data(), length);
+            stats.bytesIn += 4 + length;
+            return true;
+        },
+        [&](const vector<uint8_t>& chunk) {
+            write_all(outFd, chunk.data(), chunk.size());
+            stats.bytesOut += chunk.size();
+            stats.chunks++;
+        });
+
+    if (!finished) {
+        throw runtime_error("Поток конвейера оборван");
+    }
+    return stats;
+}
@@ -0,0 +1,183 @@
+#include "../include/crypto_runtime.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+// ==================== ОБЩИЙ ПУЛ ====================
+
+static size_t runtimeThreadCount() {
+    const char* value = getenv("CRYPTO_RT_THREADS");
+    if (value && *value) {
+        try {
+            size_t threads = stoul(value);
+            if (threads > 0) return threads;
+        } catch (const exception&) {
+            // Неверное значение — число потоков по умолчанию
+        }
+    }
+    return max(1u, thread::hardware_concurrency());
+}
+
+WorkStealingPool& cryptoRuntimePool() {
+    static WorkStealingPool pool(runtimeThreadCount());
+    return pool;
+}
+
+// ==================== ГРУППЫ ЗАДАЧ ====================
+
+TaskGroup::TaskGroup(size_t maxConcurrency)
+    : pool(cryptoRuntimePool()), running(0), pending(0) {
+    limit = maxConcurrency == 0 ? pool.threadCount() : min(maxConcurrency, pool.threadCount());
+}
+
+TaskGroup::~TaskGroup() {
+    helpUntil([this] { return pending == 0; });
+}
+
+void TaskGroup::run(Task task) {
+    {
+        lock_guard<mutex> lock(mtx);
+        pending++;
+        if (running >= limit) {
+            deferred.push_back(std::move(task));
+            return;
+        }
+        running++;
+    }
+    start(std::move(task));
+}
+
+void TaskGroup::start(Task task) {
+    pool.submit([this, task]() mutable {
+        try {
+            task();
+        } catch (...) {
+            lock_guard<mutex> lock(mtx);
+            if (!firstError) firstError = current_exception();
+        }
+        // Захваченное задачей состояние освобождается до finish(): после него
+        // wait() может вернуться и разрушить то, на что это состояние ссылается
+        task = nullptr;
+        finish();
+    });
+}
+
+void TaskGroup::finish() {
+    Task next;
+    {
+        // Уведомление под блокировкой: после него группа может быть разрушена
+        lock_guard<mutex> lock(mtx);
+        pending--;
+        if (!deferred.empty()) {
+            next = std::move(deferred.front());
+            deferred.pop_front();
+        } else {
+            running--;
+        }
+        changed.notify_all();
+    }
+    if (next) start(std::move(next));
+}
+
+void TaskGroup::helpUntil(const function<bool()>& done) {
+    while (true) {
+        {
+            lock_guard<mutex> lock(mtx);
+            if (done()) return;
+        }
+        if (pool.runOneTask()) continue;
+
+        // Очереди пусты: оставшиеся задачи группы уже выполняются
+        // другими потоками, достаточно дождаться их завершения
+        unique_lock<mutex> lock(mtx);
+        changed.wait(lock, done);
+        return;
+    }
+}
+
+void TaskGroup::wait() {
+    helpUntil([this] { return pending == 0; });
+    lock_guard<mutex> lock(mtx);
+    if (firstError) {
+        exception_ptr error = firstError;
+        firstError = nullptr;
+        rethrow_exception(error);
+    }
+}
+
+void TaskGroup::waitPendingBelow(size_t limit) {
+    helpUntil([this, limit] { return pending < limit; });
+}
+
+void parallelForRange(size_t size, size_t grain, size_t maxThreads,
+                      const function<void(size_t begin, size_t end)>& body) {
+    if (size == 0) return;
+    if (grain == 0) grain = size;
+    size_t chunks = (size + grain - 1) / grain;
+    if (chunks == 1 || maxThreads == 1) {
+        for (size_t begin = 0; begin < size; begin += grain) {
+            body(begin, min(size, begin + grain));
+        }
+        return;
+    }
+
+    TaskGroup group(maxThreads);
+    for (size_t c = 0; c < chunks; c++) {
+        group.run([&body, c, grain, size] {
+            size_t begin = c * grain;
+            body(begin, min(size, begin + grain));
+        });
+    }
+    group.wait();
+}
+
+// ==================== РАБОЧАЯ ПАМЯТЬ ПОТОКА ====================
+
+const size_t SCRATCH_MIN_BLOCK = 64 * 1024;
+const size_t SCRATCH_ALIGN = 16;
+
+uint8_t* ScratchArena::allocate(size_t size) {
+    size = (size + SCRATCH_ALIGN - 1) & ~(SCRATCH_ALIGN - 1);
+    for (; current < blocks.size(); current++, used = 0) {
+        if (blocks[current].size - used >= size) {
+            uint8_t* result = blocks[current].data.get() + used;
+            used += size;
+            return result;
+        }
+    }
+
+    size_t blockSize = max(size, blocks.empty() ? SCRATCH_MIN_BLOCK : blocks.back().size * 2);
+    blocks.push_back(Block{unique_ptr<uint8_t[]>(new uint8_t[blockSize]), blockSize});
+    current = blocks.size() - 1;
+    used = size;
+    return blocks.back().data.get();
+}
+
+size_t ScratchArena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks) total += block.size;
+    return total;
+}
+
+ScratchArena& threadScratchArena() {
+    static thread_local ScratchArena arena;
+    return arena;
+}
+
+ScratchScope::ScratchScope(ScratchArena& arena)
+    : arena(arena), savedBlock(arena.current), savedUsed(arena.used) {}
+
+ScratchScope::~ScratchScope() {
+    arena.current = savedBlock;
+    arena.used = savedUsed;
+    // Арена освобождена целиком: блоки сливаются в один, чтобы при
+    // следующих вызовах того же объема хватало одного блока
+    if (savedBlock == 0 && savedUsed == 0 && arena.blocks.size() > 1) {
+        size_t total = arena.capacity();
+        arena.blocks.clear();
+        arena.blocks.push_back(ScratchArena::Block{unique_ptr<uint8_t[]>(new uint8_t[total]), total});
+    }
+}
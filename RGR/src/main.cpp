@@ -1,5 +1,4 @@
 #include <iostream>
-#include <dlfcn.h>
 #include <string>
 #include <vector>
 #include <cstdint>
@@ -7,9 +6,29 @@
 #include <algorithm>
 #include <cctype>
 #include <termios.h>
+#include <fcntl.h>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
 #include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <csignal>
+#include <pthread.h>
+#include <thread>
+#include "../include/crypto_daemon.h"
+#include "../include/crypto_metrics.h"
+#include "../include/crypto_pipeline.h"
+#include "../include/crypto_plugin.h"
+#include "../include/plugin_registry.h"
+#include "../include/crypto_runtime.h"
 
 using namespace std;
+namespace fs = std::filesystem;
 
 // Простые объявления структур (без лишних деталей)
 struct RSAKeys {
@@ -23,29 +42,29 @@ struct ThreeWayKeys {
 };
 
 // Упрощенные типы для функций
-typedef void (*RunRSACryptoFunc)();
-typedef void (*RunThreeWayCryptoFunc)();
-typedef void (*RunMorseDemoFunc)();
+typedef void (*RunModuleFunc)(); // run_rsa_crypto, run_threeway_crypto, run_morse_demo
+typedef int (*RunFilterFunc)(int argc, char* argv[]);
 
 // Функция для скрытого ввода пароля
-string get_password(const string& prompt = "Введите пароль: ") {
+// (fd и out позволяют спрашивать пароль через терминал, когда stdin/stdout заняты данными)
+string get_password(const string& prompt = "Введите пароль: ", int fd = STDIN_FILENO, ostream& out = cout) {
     struct termios oldt, newt;
     string password;
     char c;
     
-    cout << prompt;
-    cout.flush();
+    out << prompt;
+    out.flush();
     
     // Сохраняем текущие настройки терминала
-    tcgetattr(STDIN_FILENO, &oldt);
+    tcgetattr(fd, &oldt);
     newt = oldt;
     
     // Отключаем отображение вводимых символов
     newt.c_lflag &= ~(ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &newt);
+    tcsetattr(fd, TCSANOW, &newt);
     
     // Читаем пароль посимвольно
-    while (read(STDIN_FILENO, &c, 1) == 1 && c != '\n' && c != '\r') {
+    while (read(fd, &c, 1) == 1 && c != '\n' && c != '\r') {
         if (c == 127 || c == 8) { // Backspace
             if (!password.empty()) {
                 password.pop_back();
@@ -56,9 +75,9 @@ string get_password(const string& prompt = "Введите пароль: ") {
     }
     
     // Восстанавливаем настройки терминала
-    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+    tcsetattr(fd, TCSANOW, &oldt);
     
-    cout << endl; // Переходим на новую строку после ввода пароля
+    out << endl; // Переходим на новую строку после ввода пароля
     return password;
 }
 
@@ -105,9 +124,12 @@ bool authenticate() {
     return false;
 }
 
+// Пароль упрощенной аутентификации
+const string SIMPLE_PASSWORD = "NGTU";
+
 // Альтернативная упрощенная аутентификация (без хеширования)
 bool simple_authenticate() {
-    const string correct_password = "NGTU";
+    const string correct_password = SIMPLE_PASSWORD;
     int attempts = 3;
     
     cout << "=== СИСТЕМА АУТЕНТИФИКАЦИИ ===" << endl;
@@ -133,6 +155,676 @@ bool simple_authenticate() {
     return false;
 }
 
+// Аутентификация в режиме фильтра и командной строки: stdin и stdout
+// заняты данными, поэтому пароль берется из дескриптора, из
+// CRYPTO_SYSTEM_PASSWORD или запрашивается через /dev/tty,
+// а сообщения выводятся только в stderr
+// password_fd >= 0 — пароль читается из этого дескриптора (до перевода строки)
+bool filter_authenticate(int password_fd = -1) {
+    const char* env_password = getenv("CRYPTO_SYSTEM_PASSWORD");
+    string password;
+    if (password_fd >= 0) {
+        char c;
+        while (read(password_fd, &c, 1) == 1 && c != '\n' && c != '\r') {
+            password += c;
+        }
+    } else if (env_password) {
+        password = env_password;
+    } else {
+        int tty = open("/dev/tty", O_RDWR | O_CLOEXEC);
+        if (tty < 0) {
+            cerr << "✗ Нет терминала для ввода пароля, задайте CRYPTO_SYSTEM_PASSWORD" << endl;
+            return false;
+        }
+        password = get_password("Введите пароль: ", tty, cerr);
+        close(tty);
+    }
+
+    if (password != SIMPLE_PASSWORD) {
+        cerr << "✗ Неверный пароль. Доступ запрещен." << endl;
+        return false;
+    }
+    return true;
+}
+
+// Режим фильтра для конвейеров:
+//   crypto_system filter threeway encrypt|decrypt --key-file ПУТЬ | --key-fd N
+//   crypto_system filter morse encode|encode-raw|decode|text-encode|text-decode
+// Функция фильтра модуля — run_<модуль>_filter
+int run_filter(PluginRegistry& registry, int argc, char* argv[]) {
+    if (argc < 1) {
+        cerr << "Использование: crypto_system filter threeway|morse <режим> [аргументы]" << endl;
+        return 2;
+    }
+
+    string module = argv[0];
+    if (!registry.has(module)) {
+        cerr << "Неизвестный модуль: " << module << endl;
+        return 2;
+    }
+
+    if (!filter_authenticate()) {
+        return 1;
+    }
+
+    string error;
+    string symbol = "run_" + module + "_filter";
+    RunFilterFunc runFilter = (RunFilterFunc)registry.symbol(module, symbol.c_str(), error);
+    if (!runFilter) {
+        cerr << "Ошибка загрузки функции фильтра: " << error << endl;
+        return 1;
+    }
+
+    return runFilter(argc - 1, argv + 1);
+}
+
+// crypto_system plugins — модули каталога библиотек, доступные через crypto_plugin.h
+int run_plugins(PluginRegistry& registry) {
+    vector<string> modules = registry.names();
+    if (modules.empty()) {
+        cerr << "✗ В каталоге " << registry.directory() << " нет модулей" << endl;
+        return 1;
+    }
+
+    int status = 0;
+    for (const string& module : modules) {
+        string library = registry.path(module);
+        string error;
+        const CryptoPluginDescriptor* descriptor = registry.descriptor(module, error);
+        if (!descriptor) {
+            cerr << "✗ " << library << ": " << error << endl;
+            status = 1;
+            continue;
+        }
+
+        uint32_t caps = descriptor->capabilities;
+        cout << descriptor->name << " (" << library << ", интерфейс v" << descriptor->abiVersion << ")" << endl;
+        cout << "  " << descriptor->description << endl;
+        cout << "  Операции: " << ((caps & CRYPTO_PLUGIN_CAP_ENCRYPT) ? "шифрование" : "")
+             << ((caps & CRYPTO_PLUGIN_CAP_ENCRYPT) && (caps & CRYPTO_PLUGIN_CAP_DECRYPT) ? ", " : "")
+             << ((caps & CRYPTO_PLUGIN_CAP_DECRYPT) ? "дешифрование" : "")
+             << ((caps & CRYPTO_PLUGIN_CAP_THREAD_SAFE) ? "; контекст потокобезопасен" : "") << endl;
+        cout << "  Ключ: " << ((caps & CRYPTO_PLUGIN_CAP_KEY) ? descriptor->keyFormat : "не нужен") << endl;
+    }
+    return status;
+}
+
+// ==================== КОМАНДНАЯ СТРОКА ====================
+//
+//   crypto_system <модуль> encrypt|decrypt [параметры] ВХОД ВЫХОД [ВХОД ВЫХОД ...]
+//   crypto_system <модуль> encrypt|decrypt [параметры] -o КАТАЛОГ ВХОД [ВХОД ...]
+// Параметры:
+//   --key-file ПУТЬ    файл ключей в формате rsa_keys.txt / threeway_keys.txt
+//   --key-id ID        файл ID из каталога ключей ($CRYPTO_SYSTEM_KEY_DIR, иначе ./keys)
+//   --password-fd N    пароль из дескриптора N (иначе CRYPTO_SYSTEM_PASSWORD или /dev/tty)
+//   --threads N        файлы в обработке (0 — размер общего пула, $CRYPTO_RT_THREADS)
+// Загружается только библиотека модуля, файлы обрабатываются через
+// интерфейс crypto_plugin.h, каждый файл — отдельное сообщение.
+// Шифртексты rsa и threeway побайтно совпадают с файлами меню и фильтра;
+// morse пишет формат с заголовком длины (как encodeTextToMorse), а при
+// декодировании принимает все форматы модуля. Данные, не являющиеся
+// шифртекстом модуля, отвергаются с отдельным сообщением.
+// Модуль — любая библиотека каталога модулей с дескриптором.
+// Сообщения выводятся в stderr; код 1 — хотя бы один файл не обработан.
+
+// Значение строки вида "Метка: значение" из файла ключей
+static bool key_file_value(const string& line, const string& label, string& value) {
+    if (line.compare(0, label.size(), label) != 0) return false;
+    size_t colon = line.find(':', label.size());
+    if (colon == string::npos) return false;
+    value = line.substr(colon + 1);
+    return true;
+}
+
+static void put_le(vector<uint8_t>& key, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        key.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// Ключ модуля в формате crypto_plugin.h из файла, сохраненного меню модуля
+static bool load_key_file(const string& module, const string& path, vector<uint8_t>& key, string& error) {
+    ifstream file(path);
+    if (!file) {
+        error = "не удалось открыть файл ключей " + path;
+        return false;
+    }
+
+    try {
+        string line, value;
+        if (module == "threeway") {
+            uint32_t parts[3];
+            bool found[3] = {false, false, false};
+            while (getline(file, line)) {
+                for (int i = 0; i < 3; i++) {
+                    if (key_file_value(line, "Key Part " + to_string(i), value)) {
+                        parts[i] = static_cast<uint32_t>(stoul(value, nullptr, 16));
+                        found[i] = true;
+                    }
+                }
+            }
+            if (!found[0] || !found[1] || !found[2]) {
+                error = "в файле ключей нет всех частей ключа 3-WAY";
+                return false;
+            }
+            for (uint32_t part : parts) put_le(key, part, 4);
+        } else if (module == "rsa") {
+            int64_t e = 0, d = 0, n = 0;
+            while (getline(file, line)) {
+                if (key_file_value(line, "Public Key (e)", value)) e = stoll(value);
+                else if (key_file_value(line, "Private Key (d)", value)) d = stoll(value);
+                else if (key_file_value(line, "Modulus (n)", value)) n = stoll(value);
+            }
+            put_le(key, static_cast<uint64_t>(e), 8);
+            put_le(key, static_cast<uint64_t>(d), 8);
+            put_le(key, static_cast<uint64_t>(n), 8);
+        } else {
+            error = "формат файла ключей модуля " + module + " неизвестен";
+            return false;
+        }
+    } catch (const exception&) {
+        error = "неверный формат файла ключей " + path;
+        return false;
+    }
+    return true;
+}
+
+static bool read_whole_file(const string& path, vector<uint8_t>& data) {
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file) return false;
+    streamsize size = file.tellg();
+    if (size < 0) return false;
+    data.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    return file.read(reinterpret_cast<char*>(data.data()), size) || size == 0;
+}
+
+static bool write_whole_file(const string& path, const uint8_t* data, size_t size) {
+    ofstream file(path, ios::binary | ios::trunc);
+    return file.write(reinterpret_cast<const char*>(data), size) && file.flush();
+}
+
+// Одно сообщение; false — ошибка (текст — в error). Буферы свои у каждого
+// вызова: поток, ожидающий TaskGroup, может выполнить чужую задачу внутри
+// плагина, и память файла освобождается сразу после записи.
+static bool process_file(const CryptoPluginDescriptor* plugin, void* context, bool encrypt,
+                         const string& input, const string& output, string& error) {
+    vector<uint8_t> input_data, output_data;
+    if (!read_whole_file(input, input_data)) {
+        error = "не удалось прочитать файл";
+        return false;
+    }
+
+    int operation = encrypt ? CRYPTO_PLUGIN_ENCRYPT : CRYPTO_PLUGIN_DECRYPT;
+    output_data.resize(plugin->maxOutput(context, operation, input_data.size()));
+    size_t produced = 0;
+    auto run = encrypt ? plugin->encrypt : plugin->decrypt;
+    int status = run(context, input_data.data(), input_data.size(),
+                     output_data.data(), output_data.size(), &produced);
+    if (status == CRYPTO_PLUGIN_ERR_BUFFER) {
+        output_data.resize(produced);
+        status = run(context, input_data.data(), input_data.size(),
+                     output_data.data(), output_data.size(), &produced);
+    }
+    if (status == CRYPTO_PLUGIN_ERR_DATA && !encrypt) {
+        error = string("файл не является шифртекстом модуля ") + plugin->name +
+                " в формате crypto_system либо ключ не подходит";
+        return false;
+    }
+    if (status != CRYPTO_PLUGIN_OK) {
+        error = cryptoPluginStatusText(status);
+        return false;
+    }
+
+    if (!write_whole_file(output, output_data.data(), produced)) {
+        error = "не удалось записать " + output;
+        return false;
+    }
+    return true;
+}
+
+static void headless_usage() {
+    cerr << "Использование: crypto_system rsa|threeway|morse encrypt|decrypt [--key-file ПУТЬ | --key-id ID]\n"
+         << "                 [--password-fd N] [--threads N] ВХОД ВЫХОД [ВХОД ВЫХОД ...]\n"
+         << "       crypto_system ... -o КАТАЛОГ ВХОД [ВХОД ...]" << endl;
+}
+
+int run_headless(PluginRegistry& registry, int argc, char* argv[]) {
+    if (argc < 2) {
+        headless_usage();
+        return 2;
+    }
+    string module = argv[0];
+    string mode = argv[1];
+    if (mode != "encrypt" && mode != "decrypt") {
+        headless_usage();
+        return 2;
+    }
+    if (!registry.has(module)) {
+        cerr << "Неизвестный модуль: " << module << " (каталог модулей " << registry.directory() << ")" << endl;
+        return 2;
+    }
+
+    string key_path, output_dir;
+    int password_fd = -1;
+    size_t threads = 0;
+    vector<string> files;
+    try {
+        for (int i = 2; i < argc; i++) {
+            string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--key-file" && has_value) {
+                key_path = argv[++i];
+            } else if (arg == "--key-id" && has_value) {
+                const char* dir = getenv("CRYPTO_SYSTEM_KEY_DIR");
+                key_path = (fs::path(dir ? dir : "keys") / argv[++i]).string();
+            } else if (arg == "--password-fd" && has_value) {
+                password_fd = stoi(argv[++i]);
+            } else if (arg == "--threads" && has_value) {
+                threads = stoul(argv[++i]);
+            } else if (arg == "-o" && has_value) {
+                output_dir = argv[++i];
+            } else if (arg.compare(0, 2, "--") == 0) {
+                throw invalid_argument(arg);
+            } else {
+                files.push_back(arg);
+            }
+        }
+    } catch (const exception&) {
+        headless_usage();
+        return 2;
+    }
+
+    // Пары ВХОД ВЫХОД или входы с каталогом результатов
+    vector<pair<string, string>> jobs;
+    if (!output_dir.empty()) {
+        for (const string& input : files) {
+            jobs.emplace_back(input, (fs::path(output_dir) / fs::path(input).filename()).string());
+        }
+    } else {
+        if (files.size() % 2 != 0) {
+            headless_usage();
+            return 2;
+        }
+        for (size_t i = 0; i < files.size(); i += 2) {
+            jobs.emplace_back(files[i], files[i + 1]);
+        }
+    }
+    if (jobs.empty()) {
+        headless_usage();
+        return 2;
+    }
+
+    if (!filter_authenticate(password_fd)) {
+        return 1;
+    }
+
+    string error;
+    const CryptoPluginDescriptor* plugin = registry.descriptor(module, error);
+    if (!plugin) {
+        cerr << "✗ " << module << ": " << error << endl;
+        return 1;
+    }
+
+    bool encrypt = mode == "encrypt";
+    if (!(plugin->capabilities & (encrypt ? CRYPTO_PLUGIN_CAP_ENCRYPT : CRYPTO_PLUGIN_CAP_DECRYPT))) {
+        cerr << "✗ Модуль " << module << " не поддерживает эту операцию" << endl;
+        return 2;
+    }
+
+    vector<uint8_t> key;
+    if (plugin->capabilities & CRYPTO_PLUGIN_CAP_KEY) {
+        if (key_path.empty()) {
+            cerr << "✗ Для модуля " << module << " нужен ключ: --key-file или --key-id" << endl;
+            return 2;
+        }
+        if (!load_key_file(module, key_path, key, error)) {
+            cerr << "✗ " << error << endl;
+            return 1;
+        }
+    } else if (!key_path.empty()) {
+        cerr << "✗ Модулю " << module << " ключ не нужен" << endl;
+        return 2;
+    }
+
+    void* context = nullptr;
+    int status = plugin->init(key.data(), key.size(), &context);
+    if (status != CRYPTO_PLUGIN_OK) {
+        cerr << "✗ " << cryptoPluginStatusText(status) << endl;
+        return 1;
+    }
+    if (!output_dir.empty()) {
+        fs::create_directories(output_dir);
+    }
+
+    atomic<size_t> failures{0};
+    mutex error_mutex;
+    auto process = [&](const pair<string, string>& job) {
+        string message;
+        if (!process_file(plugin, context, encrypt, job.first, job.second, message)) {
+            failures++;
+            lock_guard<mutex> lock(error_mutex);
+            cerr << "  ✗ " << job.first << ": " << message << endl;
+        }
+    };
+
+    // Контекст без потокобезопасности обрабатывает файлы по одному
+    if (!(plugin->capabilities & CRYPTO_PLUGIN_CAP_THREAD_SAFE)) {
+        threads = 1;
+    }
+    if (threads == 1 || jobs.size() == 1) {
+        for (const auto& job : jobs) process(job);
+    } else {
+        // Модуль выполняет свои задачи на том же общем пуле
+        TaskGroup group(threads);
+        for (const auto& job : jobs) {
+            group.run([&process, &job] { process(job); });
+        }
+        group.wait();
+    }
+
+    plugin->free(context);
+    cerr << "Обработано файлов: " << jobs.size() - failures << ", ошибок: " << failures << endl;
+    return failures ? 1 : 0;
+}
+
+// ==================== КОНВЕЙЕР ====================
+//
+//   crypto_system pipeline encrypt [параметры] СТАДИЯ[,СТАДИЯ...] ВХОД|- ВЫХОД|-
+//   crypto_system pipeline decrypt [параметры] ВХОД|- ВЫХОД|-
+// Параметры:
+//   --key МОДУЛЬ=ПУТЬ  файл ключей модуля (rsa_keys.txt / threeway_keys.txt)
+//   --chunk БАЙТ       размер порции входа (по умолчанию 1 МиБ)
+//   --queue N          порций в очереди между стадиями
+//   --password-fd N    пароль из дескриптора N
+// Например, threeway,morse: шифрование 3-WAY, затем код Морзе шифротекста.
+// Стадии работают в отдельных потоках, данные идут через память;
+// цепочка для дешифрования берется из заголовка входа.
+
+static void pipeline_usage() {
+    cerr << "Использование: crypto_system pipeline encrypt [--key МОДУЛЬ=ПУТЬ]... [--chunk БАЙТ] [--queue N]\n"
+         << "                 [--password-fd N] СТАДИЯ[,СТАДИЯ...] ВХОД|- ВЫХОД|-\n"
+         << "       crypto_system pipeline decrypt [--key МОДУЛЬ=ПУТЬ]... ВХОД|- ВЫХОД|-" << endl;
+}
+
+int run_pipeline(PluginRegistry& registry, int argc, char* argv[]) {
+    if (argc < 1 || (strcmp(argv[0], "encrypt") != 0 && strcmp(argv[0], "decrypt") != 0)) {
+        pipeline_usage();
+        return 2;
+    }
+    bool encrypt = strcmp(argv[0], "encrypt") == 0;
+
+    vector<pair<string, string>> key_paths;
+    size_t chunk_size = PIPELINE_DEFAULT_CHUNK;
+    size_t queue_depth = PIPELINE_DEFAULT_QUEUE;
+    int password_fd = -1;
+    vector<string> positional;
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--key" && has_value) {
+                string value = argv[++i];
+                size_t eq = value.find('=');
+                if (eq == string::npos || eq == 0) throw invalid_argument(value);
+                key_paths.emplace_back(value.substr(0, eq), value.substr(eq + 1));
+            } else if (arg == "--chunk" && has_value) {
+                chunk_size = stoul(argv[++i]);
+            } else if (arg == "--queue" && has_value) {
+                queue_depth = stoul(argv[++i]);
+            } else if (arg == "--password-fd" && has_value) {
+                password_fd = stoi(argv[++i]);
+            } else if (arg.compare(0, 2, "--") == 0) {
+                throw invalid_argument(arg);
+            } else {
+                positional.push_back(arg);
+            }
+        }
+    } catch (const exception&) {
+        pipeline_usage();
+        return 2;
+    }
+    if (positional.size() != (encrypt ? 3u : 2u) || chunk_size == 0) {
+        pipeline_usage();
+        return 2;
+    }
+    string input = positional[positional.size() - 2];
+    string output = positional.back();
+
+    vector<string> names;
+    if (encrypt) {
+        stringstream list(positional[0]);
+        string name;
+        while (getline(list, name, ',')) names.push_back(name);
+    }
+
+    int in_fd = STDIN_FILENO;
+    if (input != "-") {
+        in_fd = open(input.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in_fd < 0) {
+            cerr << "✗ Не удалось открыть " << input << ": " << strerror(errno) << endl;
+            return 1;
+        }
+    }
+    // Для дешифрования цепочка записана в начале входа
+    if (!encrypt) {
+        try {
+            names = readPipelineHeader(in_fd);
+        } catch (const exception& e) {
+            cerr << "✗ " << e.what() << endl;
+            if (in_fd != STDIN_FILENO) close(in_fd);
+            return 1;
+        }
+    }
+
+    int status = 0;
+    vector<PipelineStage> stages;
+    for (const string& name : names) {
+        if (!registry.has(name)) {
+            cerr << "Неизвестный модуль: " << name << " (каталог модулей " << registry.directory() << ")" << endl;
+            status = 2;
+        }
+    }
+    if (names.empty()) {
+        pipeline_usage();
+        status = 2;
+    }
+    if (status == 0 && !filter_authenticate(password_fd)) {
+        status = 1;
+    }
+
+    for (size_t i = 0; status == 0 && i < names.size(); i++) {
+        const string& name = names[i];
+        string error;
+        const CryptoPluginDescriptor* plugin = registry.descriptor(name, error);
+        if (!plugin) {
+            cerr << "✗ " << name << ": " << error << endl;
+            status = 1;
+            break;
+        }
+        if (!(plugin->capabilities & (encrypt ? CRYPTO_PLUGIN_CAP_ENCRYPT : CRYPTO_PLUGIN_CAP_DECRYPT))) {
+            cerr << "✗ Модуль " << name << " не поддерживает эту операцию" << endl;
+            status = 2;
+            break;
+        }
+
+        vector<uint8_t> key;
+        string key_path;
+        for (const auto& entry : key_paths) {
+            if (entry.first == name) key_path = entry.second;
+        }
+        if ((plugin->capabilities & CRYPTO_PLUGIN_CAP_KEY) && key_path.empty()) {
+            cerr << "✗ Для модуля " << name << " нужен ключ: --key " << name << "=ПУТЬ" << endl;
+            status = 2;
+            break;
+        }
+        if (!key_path.empty() && !load_key_file(name, key_path, key, error)) {
+            cerr << "✗ " << error << endl;
+            status = 1;
+            break;
+        }
+
+        void* context = nullptr;
+        int init_status = plugin->init(key.data(), key.size(), &context);
+        if (init_status != CRYPTO_PLUGIN_OK) {
+            cerr << "✗ " << name << ": " << cryptoPluginStatusText(init_status) << endl;
+            status = 1;
+            break;
+        }
+        stages.push_back({name, plugin, context});
+    }
+
+    int out_fd = STDOUT_FILENO;
+    if (status == 0 && output != "-") {
+        out_fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out_fd < 0) {
+            cerr << "✗ Не удалось создать " << output << ": " << strerror(errno) << endl;
+            status = 1;
+        }
+    }
+
+    if (status == 0) {
+        try {
+            PipelineStats stats = encrypt ? encryptPipeline(stages, in_fd, out_fd, chunk_size, queue_depth)
+                                          : decryptPipeline(stages, in_fd, out_fd, queue_depth);
+            cerr << "Конвейер";
+            for (size_t i = 0; i < names.size(); i++) {
+                cerr << (i == 0 ? ": " : " → ") << names[encrypt ? i : names.size() - 1 - i];
+            }
+            cerr << "; порций: " << stats.chunks << ", байт: " << stats.bytesIn << " → " << stats.bytesOut << endl;
+        } catch (const exception& e) {
+            cerr << "✗ " << e.what() << endl;
+            status = 1;
+            // Незавершенный результат не оставляется
+            if (out_fd != STDOUT_FILENO) unlink(output.c_str());
+        }
+    }
+
+    for (const PipelineStage& stage : stages) {
+        stage.plugin->free(stage.context);
+    }
+    if (in_fd != STDIN_FILENO) close(in_fd);
+    if (out_fd != STDOUT_FILENO && out_fd >= 0) close(out_fd);
+    return status;
+}
+
+// ==================== ДЕМОН ====================
+//
+//   crypto_system daemon [--socket ПУТЬ] [--threads N] [--password-fd N]
+// Пароль проверяется один раз при запуске; запросы принимаются через
+// Unix-сокет ($CRYPTO_SYSTEM_SOCKET, иначе ./crypto_system.sock) в формате
+// daemon_protocol.h (клиент — libcryptoclient.so). SIGINT/SIGTERM —
+// остановка после ответа на принятые запросы.
+
+static CryptoDaemon* running_daemon = nullptr;
+
+static void stop_daemon(int) {
+    if (running_daemon) running_daemon->stop();
+}
+
+int run_daemon(PluginRegistry& registry, int argc, char* argv[]) {
+    DaemonOptions options;
+    int password_fd = -1;
+    try {
+        for (int i = 0; i < argc; i++) {
+            string arg = argv[i];
+            if (i + 1 >= argc) throw invalid_argument(arg);
+            if (arg == "--socket") options.socketPath = argv[++i];
+            else if (arg == "--threads") options.threads = stoul(argv[++i]);
+            else if (arg == "--password-fd") password_fd = stoi(argv[++i]);
+            else throw invalid_argument(arg);
+        }
+    } catch (const exception&) {
+        cerr << "Использование: crypto_system daemon [--socket ПУТЬ] [--threads N] [--password-fd N]" << endl;
+        return 2;
+    }
+
+    if (!filter_authenticate(password_fd)) {
+        return 1;
+    }
+    // Модули загружаются до первого запроса
+    registry.warmUp();
+
+    CryptoDaemon daemon(registry, options);
+    string error;
+    if (!daemon.listen(error)) {
+        cerr << "✗ " << error << endl;
+        return 1;
+    }
+
+    running_daemon = &daemon;
+    signal(SIGINT, stop_daemon);
+    signal(SIGTERM, stop_daemon);
+    signal(SIGPIPE, SIG_IGN);
+    cerr << "Демон ожидает запросы на " << daemon.socketPath() << endl;
+    daemon.serve();
+    running_daemon = nullptr;
+
+    cerr << "Демон остановлен. Выполнено запросов: " << daemon.requestsServed()
+         << ", с ошибкой: " << daemon.requestsFailed() << endl;
+    return 0;
+}
+
+// ==================== МЕТРИКИ ====================
+//
+// Снимок метрик модулей (crypto_metrics.h) по сигналу SIGUSR1 пишется в
+// $CRYPTO_SYSTEM_METRICS_FILE (файл заменяется целиком), без него — в stderr.
+// Формат — $CRYPTO_SYSTEM_METRICS_FORMAT: prometheus (по умолчанию) или json.
+// Режимы командной строки и демон сохраняют метрики в файл и при завершении;
+// CRYPTO_SYSTEM_METRICS=0 отключает сбор.
+
+static string metrics_format() {
+    const char* value = getenv("CRYPTO_SYSTEM_METRICS_FORMAT");
+    return value && *value ? value : "prometheus";
+}
+
+static void save_metrics(bool to_stderr) {
+    const char* path = getenv("CRYPTO_SYSTEM_METRICS_FILE");
+    if (!path || !*path) {
+        if (to_stderr && !writeMetrics(cerr, metrics_format())) {
+            cerr << "✗ Неизвестный формат метрик: " << metrics_format() << endl;
+        }
+        return;
+    }
+
+    // Читатель файла не увидит частично записанный снимок
+    string temp = string(path) + ".tmp";
+    ofstream out(temp, ios::trunc);
+    bool written = out && writeMetrics(out, metrics_format());
+    out.close();
+    if (!written || !out || rename(temp.c_str(), path) != 0) {
+        unlink(temp.c_str());
+        cerr << "✗ Не удалось сохранить метрики в " << path << endl;
+    }
+}
+
+// Сигнал принимает отдельный поток (sigwait), поэтому снимок делается
+// обычным кодом, а не в обработчике. Маска задается до создания других
+// потоков и наследуется ими.
+static void start_metrics_signal_thread() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    if (pthread_sigmask(SIG_BLOCK, &signals, nullptr) != 0) {
+        return;
+    }
+    thread([signals] {
+        int signal_number;
+        while (sigwait(&signals, &signal_number) == 0) {
+            save_metrics(true);
+        }
+    }).detach();
+}
+
+static void show_metrics() {
+    cout << "\n=== Метрики производительности ===" << endl;
+    cout << "1. Prometheus" << endl;
+    cout << "2. JSON" << endl;
+    cout << "Выберите формат: ";
+    string format;
+    getline(cin, format);
+    writeMetrics(cout, format == "2" ? "json" : "prometheus");
+}
 
 void show_menu() {
     cout << "\n=== КРИПТОГРАФИЧЕСКАЯ СИСТЕМА & АЗБУКА МОРЗЕ ===" << endl;
@@ -140,6 +832,7 @@ void show_menu() {
     cout << "2. Запустить 3-WAY интерактивный режим" << endl;
     cout << "3. Запустить Азбуку Морзе" << endl;
     cout << "4. Выход" << endl;
+    cout << "5. Метрики производительности" << endl;
     cout << "Выберите действие: ";
 }
 
@@ -150,87 +843,92 @@ void show_welcome() {
     cout << "==========================================" << endl;
 }
 
-int main() {
-    show_welcome();
-    
-    // Аутентификация пользователя - используем упрощенную версию
-    if (!simple_authenticate()) {
-        cerr << "Программа завершена." << endl;
-        return 1;
+// CRYPTO_SYSTEM_TIMING=1 — время запуска и загрузки модулей в stderr
+static bool timing_enabled() {
+    const char* value = getenv("CRYPTO_SYSTEM_TIMING");
+    return value && *value && strcmp(value, "0") != 0;
+}
+
+static void report_timing(const PluginRegistry& registry, const char* stage,
+                          chrono::steady_clock::time_point start) {
+    if (!timing_enabled()) return;
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cerr << "[время] " << stage << ": " << fixed << setprecision(2) << ms << " мс" << endl;
+    registry.report(cerr);
+}
+
+// Интерактивный режим модуля: библиотека загружается при первом выборе
+// пункта меню (или уже загружена фоновым потоком)
+static void run_module_menu(PluginRegistry& registry, const string& module,
+                            const char* symbol, const string& title) {
+    string error;
+    RunModuleFunc run = (RunModuleFunc)registry.symbol(module, symbol, error);
+    if (!run) {
+        cerr << "✗ " << title << " функция не загружена: " << error << endl;
+        cerr << "Доступные модули в " << registry.directory() << ":";
+        for (const string& name : registry.names()) {
+            cerr << " " << name;
+        }
+        cerr << endl;
+        return;
     }
-    
-    void* rsa_handle = nullptr;
-    void* threeway_handle = nullptr;
-    void* morse_handle = nullptr;
-    char* error = nullptr;
-    
-    // Загружаем RSA библиотеку
-    rsa_handle = dlopen("./lib/librsa.so", RTLD_LAZY);
-    if (!rsa_handle) {
-        cerr << "Ошибка загрузки RSA библиотеки: " << dlerror() << endl;
-        cerr << "Убедитесь, что файл librsa.so находится в директории ./lib/" << endl;
-    } else {
-        cout << "✓ RSA библиотека успешно загружена!" << endl;
+    cout << "\n=== Запуск " << title << " ===" << endl;
+    run();
+}
+
+int main(int argc, char* argv[]) {
+    auto start = chrono::steady_clock::now();
+    start_metrics_signal_thread();
+    // Каталог только просматривается; библиотеки загружаются при первом обращении
+    PluginRegistry registry;
+
+    if (argc >= 2 && strcmp(argv[1], "filter") == 0) {
+        int status = run_filter(registry, argc - 2, argv + 2);
+        report_timing(registry, "фильтр", start);
+        save_metrics(false);
+        return status;
     }
-    
-    // Загружаем 3-WAY библиотеку
-    threeway_handle = dlopen("./lib/libthreeway.so", RTLD_LAZY);
-    if (!threeway_handle) {
-        cerr << "Ошибка загрузки 3-WAY библиотеки: " << dlerror() << endl;
-        cerr << "Убедитесь, что файл libthreeway.so находится в директории ./lib/" << endl;
-    } else {
-        cout << "✓ 3-WAY библиотека успешно загружена!" << endl;
+    if (argc >= 2 && strcmp(argv[1], "pipeline") == 0) {
+        int status = run_pipeline(registry, argc - 2, argv + 2);
+        report_timing(registry, "конвейер", start);
+        save_metrics(false);
+        return status;
     }
-    
-    // Загружаем Morse библиотеку
-    morse_handle = dlopen("./lib/libmorse.so", RTLD_LAZY);
-    if (!morse_handle) {
-        cerr << "Ошибка загрузки Morse библиотеки: " << dlerror() << endl;
-        cerr << "Убедитесь, что файл libmorse.so находится в директории ./lib/" << endl;
-    } else {
-        cout << "✓ Morse библиотека успешно загружена!" << endl;
+    if (argc >= 2 && strcmp(argv[1], "daemon") == 0) {
+        int status = run_daemon(registry, argc - 2, argv + 2);
+        save_metrics(false);
+        return status;
     }
-    
-    // Сбрасываем ошибки
-    dlerror();
-    
-    // Загружаем RSA функцию (если библиотека загружена)
-    RunRSACryptoFunc runRSACrypto = nullptr;
-    if (rsa_handle) {
-        runRSACrypto = (RunRSACryptoFunc)dlsym(rsa_handle, "run_rsa_crypto");
-        if ((error = dlerror()) != nullptr) {
-            cerr << "Ошибка загрузки RSA функции: " << error << endl;
-            runRSACrypto = nullptr;
-        }
+    if (argc >= 2 && strcmp(argv[1], "plugins") == 0) {
+        int status = run_plugins(registry);
+        report_timing(registry, "список модулей", start);
+        return status;
     }
-    
-    // Сбрасываем ошибки
-    dlerror();
-    
-    // Загружаем 3-WAY функцию (если библиотека загружена)
-    RunThreeWayCryptoFunc runThreeWayCrypto = nullptr;
-    if (threeway_handle) {
-        runThreeWayCrypto = (RunThreeWayCryptoFunc)dlsym(threeway_handle, "run_threeway_crypto");
-        if ((error = dlerror()) != nullptr) {
-            cerr << "Ошибка загрузки 3-WAY функции: " << error << endl;
-            runThreeWayCrypto = nullptr;
-        }
+    if (argc >= 3 && (strcmp(argv[2], "encrypt") == 0 || strcmp(argv[2], "decrypt") == 0)) {
+        int status = run_headless(registry, argc - 1, argv + 1);
+        report_timing(registry, "командная строка", start);
+        save_metrics(false);
+        return status;
     }
+
+    show_welcome();
     
-    // Сбрасываем ошибки
-    dlerror();
+    // Аутентификация пользователя - используем упрощенную версию
+    if (!simple_authenticate()) {
+        cerr << "Программа завершена." << endl;
+        return 1;
+    }
     
-    // Загружаем Morse функцию (если библиотека загружена)
-    RunMorseDemoFunc runMorseDemo = nullptr;
-    if (morse_handle) {
-        runMorseDemo = (RunMorseDemoFunc)dlsym(morse_handle, "run_morse_demo");
-        if ((error = dlerror()) != nullptr) {
-            cerr << "Ошибка загрузки Morse функции: " << error << endl;
-            runMorseDemo = nullptr;
-        }
+    // Пока пользователь выбирает пункт меню, модули загружаются в фоне
+    // (CRYPTO_SYSTEM_PRELOAD=0 — только по требованию)
+    const char* preload = getenv("CRYPTO_SYSTEM_PRELOAD");
+    if (!preload || strcmp(preload, "0") != 0) {
+        registry.warmUp();
     }
     
-    cout << "✓ Система инициализирована!" << endl;
+    cout << "✓ Система инициализирована! Модулей в " << registry.directory() << ": "
+         << registry.names().size() << endl;
+    report_timing(registry, "до меню", start);
     
     int choice;
     do {
@@ -240,40 +938,23 @@ int main() {
         
         switch (choice) {
             case 1:
-                if (runRSACrypto) {
-                    cout << "\n=== Запуск RSA системы ===" << endl;
-                    runRSACrypto();
-                } else {
-                    cerr << "✗ RSA функция не загружена!" << endl;
-                    cerr << "Доступные библиотеки в ./lib/:" << endl;
-                    system("ls -la ./lib/ 2>/dev/null || echo 'Директория ./lib/ не существует'");
-                }
+                run_module_menu(registry, "rsa", "run_rsa_crypto", "RSA системы");
                 break;
                 
             case 2:
-                if (runThreeWayCrypto) {
-                    cout << "\n=== Запуск 3-WAY системы ===" << endl;
-                    runThreeWayCrypto();
-                } else {
-                    cerr << "✗ 3-WAY функция не загружена!" << endl;
-                    cerr << "Доступные библиотеки в ./lib/:" << endl;
-                    system("ls -la ./lib/ 2>/dev/null || echo 'Директория ./lib/ не существует'");
-                }
+                run_module_menu(registry, "threeway", "run_threeway_crypto", "3-WAY системы");
                 break;
                 
             case 3:
-                if (runMorseDemo) {
-                    cout << "\n=== Запуск Азбуки Морзе ===" << endl;
-                    runMorseDemo();
-                } else {
-                    cerr << "✗ Morse функция не загружена!" << endl;
-                    cerr << "Доступные библиотеки в ./lib/:" << endl;
-                    system("ls -la ./lib/ 2>/dev/null || echo 'Директория ./lib/ не существует'");
-                }
+                run_module_menu(registry, "morse", "run_morse_demo", "Азбуки Морзе");
                 break;
             case 4:
                 cout << "Выход из программы." << endl;
                 break;
+
+            case 5:
+                show_metrics();
+                break;
                 
             default:
                 cout << "Неверный выбор! Пожалуйста, выберите от 1 до 5." << endl;
@@ -286,20 +967,7 @@ int main() {
         
     } while (choice != 4);
     
-    // Закрываем библиотеки
-    if (rsa_handle) {
-        dlclose(rsa_handle);
-        cout << "✓ RSA библиотека выгружена." << endl;
-    }
-    if (threeway_handle) {
-        dlclose(threeway_handle);
-        cout << "✓ 3-WAY библиотека выгружена." << endl;
-    }
-    if (morse_handle) {
-        dlclose(morse_handle);
-        cout << "✓ Morse библиотека выгружена." << endl;
-    }
-    
+    report_timing(registry, "сеанс", start);
     cout << "Сеанс работы завершен." << endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -1,402 +1,2215 @@
 #include "../include/morse_standalone.h"
+#include "../include/crypto_runtime.h"
+#include "../include/crypto_plugin.h"
+#include "../include/crypto_metrics.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <cctype>
 #include <vector>
-#include <map>
 #include <fstream>
 #include <cstdint>
 #include <cstring>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <numeric>
+#include <immintrin.h>
+#include <sys/stat.h>
 
 using namespace std;
 
+// Метрики операций (crypto_metrics.h)
+static OperationMetric encodeMetric("morse_encode", "Кодирование Морзе в памяти");
+static OperationMetric decodeMetric("morse_decode", "Декодирование Морзе в памяти");
+static OperationMetric fileEncodeMetric("morse_file_encode", "Кодирование Морзе файла");
+static OperationMetric fileDecodeMetric("morse_file_decode", "Декодирование Морзе файла");
+
 // ==================== КЛАСС MorseCode ====================
 
+// Таблицы строятся при компиляции:
+//  - encode: код для каждого из 256 значений char (nullptr — не поддерживается),
+//    length — его длина;
+//  - decode: двоичное дерево точек и тире в массиве. Корень — узел 1,
+//    точка ведет в 2i, тире — в 2i + 1; коды не длиннее 6 элементов,
+//    поэтому хватает 128 узлов. '\0' — узел без символа.
+struct MorseCharCode {
+    char symbol;
+    const char* code;
+};
+
+static constexpr MorseCharCode MORSE_ALPHABET[] = {
+    // ENGLISH ALPHABET
+    {'A', ".-"},   {'B', "-..."}, {'C', "-.-."}, {'D', "-.."},  {'E', "."},
+    {'F', "..-."}, {'G', "--."},  {'H', "...."}, {'I', ".."},   {'J', ".---"},
+    {'K', "-.-"},  {'L', ".-.."}, {'M', "--"},   {'N', "-."},   {'O', "---"},
+    {'P', ".--."}, {'Q', "--.-"}, {'R', ".-."},  {'S', "..."},  {'T', "-"},
+    {'U', "..-"},  {'V', "...-"}, {'W', ".--"},  {'X', "-..-"}, {'Y', "-.--"},
+    {'Z', "--.."},
+    //  ЧИСЛА
+    {'0', "-----"}, {'1', ".----"}, {'2', "..---"}, {'3', "...--"}, {'4', "....-"},
+    {'5', "....."}, {'6', "-...."}, {'7', "--..."}, {'8', "---.."}, {'9', "----."},
+    // СПЕЦ СИМВОЛЫ
+    {'.', ".-.-.-"}, {',', "--..--"}, {'?', "..--.."}, {'!', "-.-.--"}, {'@', ".--.-."},
+    {'/', "-..-."}
+};
+
+const int MORSE_TRIE_SIZE = 128;
+const char MORSE_WORD_SEPARATOR[] = "/";
+
+struct MorseTables {
+    const char* encode[256];
+    uint8_t length[256];
+    char decode[MORSE_TRIE_SIZE];
+};
+
+static constexpr int morseTrieIndex(const char* code) {
+    int node = 1;
+    for (; *code; ++code) {
+        node = 2 * node + (*code == '-' ? 1 : 0);
+    }
+    return node;
+}
+
+static constexpr MorseTables buildMorseTables() {
+    MorseTables tables{};
+    for (const MorseCharCode& entry : MORSE_ALPHABET) {
+        unsigned char symbol = static_cast<unsigned char>(entry.symbol);
+        tables.encode[symbol] = entry.code;
+        // Строчные буквы кодируются как заглавные
+        if (symbol >= 'A' && symbol <= 'Z') {
+            tables.encode[symbol - 'A' + 'a'] = entry.code;
+        }
+        tables.decode[morseTrieIndex(entry.code)] = entry.symbol;
+    }
+    tables.encode[static_cast<unsigned char>(' ')] = MORSE_WORD_SEPARATOR;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        const char* code = tables.encode[symbol];
+        while (code && code[tables.length[symbol]]) {
+            tables.length[symbol]++;
+        }
+    }
+    return tables;
+}
+
+static constexpr MorseTables MORSE_TABLES = buildMorseTables();
+
+static_assert(MORSE_TABLES.decode[morseTrieIndex("...")] == 'S', "дерево Морзе построено неверно");
+static_assert(MORSE_TABLES.decode[morseTrieIndex("-----")] == '0', "дерево Морзе построено неверно");
+
 MorseCode::MorseCode() {
-    initializeMaps();
 }
 
-void MorseCode::initializeMaps() {
-    morseMap.clear();
-    reverseMap.clear();
-    
-    // ENGLISH ALPHABET
-    morseMap['A'] = ".-";
-    morseMap['B'] = "-...";
-    morseMap['C'] = "-.-.";
-    morseMap['D'] = "-..";
-    morseMap['E'] = ".";
-    morseMap['F'] = "..-.";
-    morseMap['G'] = "--.";
-    morseMap['H'] = "....";
-    morseMap['I'] = "..";
-    morseMap['J'] = ".---";
-    morseMap['K'] = "-.-";
-    morseMap['L'] = ".-..";
-    morseMap['M'] = "--";
-    morseMap['N'] = "-.";
-    morseMap['O'] = "---";
-    morseMap['P'] = ".--.";
-    morseMap['Q'] = "--.-";
-    morseMap['R'] = ".-.";
-    morseMap['S'] = "...";
-    morseMap['T'] = "-";
-    morseMap['U'] = "..-";
-    morseMap['V'] = "...-";
-    morseMap['W'] = ".--";
-    morseMap['X'] = "-..-";
-    morseMap['Y'] = "-.--";
-    morseMap['Z'] = "--..";
-    
-    //  ЧИСЛА
-    morseMap['0'] = "-----";
-    morseMap['1'] = ".----";
-    morseMap['2'] = "..---";
-    morseMap['3'] = "...--";
-    morseMap['4'] = "....-";
-    morseMap['5'] = ".....";
-    morseMap['6'] = "-....";
-    morseMap['7'] = "--...";
-    morseMap['8'] = "---..";
-    morseMap['9'] = "----.";
-    
-    // СПЕЦ СИМВОЛЫ
-    morseMap['.'] = ".-.-.-";
-    morseMap[','] = "--..--";
-    morseMap['?'] = "..--..";
-    morseMap['!'] = "-.-.--";
-    morseMap['@'] = ".--.-.";
-    morseMap['/'] = "-..-.";
-    
-    // СОЗДАТЬ ОБРАТНУЮ КАРТУ
-    for (const auto& pair : morseMap) {
-        reverseMap[pair.second] = pair.first;
+string_view MorseCode::encodeCharView(char c) const {
+    unsigned char symbol = static_cast<unsigned char>(c);
+    const char* code = MORSE_TABLES.encode[symbol];
+    return code ? string_view(code, MORSE_TABLES.length[symbol]) : string_view();
+}
+
+string MorseCode::encodeChar(char c) const {
+    return string(encodeCharView(c));
+}
+
+size_t MorseCode::encodedLength(string_view text) const {
+    size_t length = 0, symbols = 0;
+    for (char c : text) {
+        size_t code = MORSE_TABLES.length[static_cast<unsigned char>(c)];
+        length += code;
+        symbols += code != 0;
+    }
+    // Коды разделяются одним пробелом
+    return symbols ? length + symbols - 1 : 0;
+}
+
+size_t MorseCode::encodeString(string_view text, char* out, size_t capacity) const {
+    size_t length = encodedLength(text);
+    if (length <= capacity) {
+        encodeString(text, out);
+    }
+    return length;
+}
+
+string MorseCode::encodeString(const string& text) const {
+    string result(encodedLength(text), '\0');
+    encodeString(string_view(text), result.data());
+    return result;
+}
+
+char MorseCode::decodeChar(string_view morse) const {
+    // Сначала проверьте наличие места
+    if (morse == MORSE_WORD_SEPARATOR) {
+        return ' ';
+    }
+
+    int node = 1;
+    for (char c : morse) {
+        if (c != '.' && c != '-') return '?';
+        node = 2 * node + (c == '-');
+        if (node >= MORSE_TRIE_SIZE) return '?';
+    }
+
+    char decoded = MORSE_TABLES.decode[node];
+    return decoded ? decoded : '?';
+}
+
+char MorseCode::decodeChar(const string& morse) const {
+    return decodeChar(string_view(morse));
+}
+
+size_t MorseCode::decodedLength(string_view morse) const {
+    // Один символ на каждое начало лексемы
+    size_t symbols = 0;
+    bool gap = true;
+    for (char c : morse) {
+        symbols += gap && c != ' ';
+        gap = c == ' ';
+    }
+    return symbols;
+}
+
+size_t MorseCode::decodeString(string_view morse, char* out, size_t capacity) const {
+    size_t length = decodedLength(morse);
+    if (length <= capacity) {
+        decodeString(morse, out);
+    }
+    return length;
+}
+
+string MorseCode::decodeString(const string& morse) const {
+    string result(decodedLength(morse), '\0');
+    decodeString(string_view(morse), result.data());
+    return result;
+}
+
+bool MorseCode::isSupported(char c) const {
+    return MORSE_TABLES.encode[static_cast<unsigned char>(c)] != nullptr;
+}
+
+void MorseCode::printSupportedChars() const {
+    cout << "=== ПОДДЕРЖИВАЕМЫЕ СИМВОЛЫ ===" << endl;
+    cout << "Буквы: ABCDEFGHIJKLMNOPQRSTUVWXYZ" << endl;
+    cout << "Числа: 0123456789" << endl;
+    cout << "спец символы: . , ? ! @ /" << endl;
+    cout << "Пробел: /" << endl;
+}
+
+void MorseCode::runDemo() const {
+    cout << "=== КОД МОРЗЕ ДЕМОНСТРАЦИОННЫЙ ===" << endl;
+    
+    // Проверка конкретных случаев
+    vector<pair<string, string>> tests = {
+        {"SOS", "... --- ..."},
+        {"HELLO", ".... . .-.. .-.. ---"},
+        {"WORLD", ".-- --- .-. .-.. -.."},
+        {"123", ".---- ..--- ...--"},
+        {"I LOVE YOU", ".. / .-.. --- ...- . / -.-- --- ..-"},
+        {"HELLO WORLD", ".... . .-.. .-.. --- / .-- --- .-. .-.. -.."}
+    };
+    
+    for (const auto& test : tests) {
+        cout << "\nTest: " << test.first << endl;
+        cout << "Ожидаемый Морзе: " << test.second << endl;
+        
+        // Кодировать
+        string encoded = encodeString(test.first);
+        cout << "Кодировать: " << encoded << endl;
+        
+        // Декрдировать 
+        string decoded = decodeString(test.second);
+        cout << "Декодировать: " << decoded << endl;
+        
+        bool encodeOk = (encoded == test.second);
+        bool decodeOk = (decoded == test.first);
+        
+        cout << "Кодировать: " << (encodeOk ? "OK" : "FAIL") << endl;
+        cout << "Декодировать: " << (decodeOk ? "OK" : "FAIL") << endl;
+    }
+}
+
+// ==================== БИНАРНОЕ КОДИРОВАНИЕ ====================
+
+// Коды полубайтов: все коды из 1-3 элементов и "....", "...-".
+// Это не 16 кратчайших по длине в битах: "..-.", ".-.." и "-..." (9 бит)
+// короче "---" (11 бит), но не входят в набор.
+static constexpr const char* NIBBLE_CODES[16] = {
+    ".",    "-",    "..",   ".-",
+    "-.",   "--",   "...",  "..-",
+    ".-.",  ".--",  "-..",  "-.-",
+    "--.",  "---",  "....", "...-"
+};
+
+// Длины в битах: точка — 1, тире — 111, пауза между элементами — 0,
+// между полубайтами — 000, между байтами — 0000000
+const unsigned DOT_LENGTH = 1;
+const unsigned DASH_LENGTH = 3;
+const unsigned ELEMENT_GAP_LENGTH = 1;
+const unsigned PART_GAP_LENGTH = 3;
+const unsigned BYTE_GAP_LENGTH = 7;
+
+// Битовая последовательность байта, старший бит — первый
+struct MorseByteCode {
+    uint32_t bits;
+    uint8_t length;   // с учетом паузы перед байтом (BYTE_GAP_LENGTH)
+};
+
+static constexpr void appendBits(MorseByteCode& code, uint32_t bits, unsigned length) {
+    code.bits = (code.bits << length) | bits;
+    code.length += length;
+}
+
+static constexpr void appendNibbleCode(MorseByteCode& code, const char* morse) {
+    for (size_t i = 0; morse[i]; ++i) {
+        if (i > 0) appendBits(code, 0, ELEMENT_GAP_LENGTH);
+        if (morse[i] == '.') appendBits(code, 0x1, DOT_LENGTH);
+        else appendBits(code, 0x7, DASH_LENGTH);
+    }
+}
+
+typedef array<MorseByteCode, 256> MorseByteCodes;
+
+// Номера кодов из NIBBLE_CODES для каждого значения полубайта,
+// отдельно для старшего и младшего
+struct MorseNibbleMap {
+    array<uint8_t, 16> high;
+    array<uint8_t, 16> low;
+};
+
+static constexpr MorseNibbleMap buildIdentityMap() {
+    MorseNibbleMap map{};
+    for (uint8_t nibble = 0; nibble < 16; ++nibble) {
+        map.high[nibble] = nibble;
+        map.low[nibble] = nibble;
+    }
+    return map;
+}
+
+static constexpr MorseNibbleMap MORSE_IDENTITY_MAP = buildIdentityMap();
+
+// Самый длинный байт: 25 бит кода + 7 бит паузы, поэтому хватает uint32_t
+static constexpr MorseByteCodes buildByteCodes(const MorseNibbleMap& map) {
+    MorseByteCodes codes{};
+    for (unsigned byte = 0; byte < 256; ++byte) {
+        MorseByteCode code{0, 0};
+        appendBits(code, 0, BYTE_GAP_LENGTH);
+        appendNibbleCode(code, NIBBLE_CODES[map.high[byte >> 4]]);
+        appendBits(code, 0, PART_GAP_LENGTH);
+        appendNibbleCode(code, NIBBLE_CODES[map.low[byte & 0x0F]]);
+        codes[byte] = code;
+    }
+    return codes;
+}
+
+static constexpr MorseByteCodes MORSE_BYTE_CODES = buildByteCodes(MORSE_IDENTITY_MAP);
+
+static_assert(MORSE_BYTE_CODES[0xDD].length == 32, "код байта не помещается в 32 бита");
+
+// Запись битовых последовательностей MSB-first через 64-битный аккумулятор.
+// Полные слова записываются в out целиком, поэтому буфер должен вмещать
+// ceil(бит / 8) байт.
+class MorseBitWriter {
+public:
+    explicit MorseBitWriter(uint8_t* out) : out(out), acc(0), count(0) {}
+
+    // Запись с битового смещения внутри первого байта out (0..7):
+    // старшие bitOffset бит первого байта остаются нулевыми
+    MorseBitWriter(uint8_t* out, unsigned bitOffset) : out(out), acc(0), count(bitOffset) {}
+
+    // length <= 32
+    void append(uint32_t bits, unsigned length) {
+        if (count + length <= 64) {
+            acc = (acc << length) | bits;
+            count += length;
+            if (count == 64) {
+                storeWord(acc);
+                acc = 0;
+                count = 0;
+            }
+        } else {
+            unsigned rest = count + length - 64;
+            storeWord((acc << (length - rest)) | (bits >> rest));
+            acc = bits & ((uint64_t(1) << rest) - 1);
+            count = rest;
+        }
+    }
+
+    void appendByte(unsigned char byte, bool first, const MorseByteCodes& codes = MORSE_BYTE_CODES) {
+        const MorseByteCode& code = codes[byte];
+        append(code.bits, first ? code.length - BYTE_GAP_LENGTH : code.length);
+    }
+
+    // Дописывает неполное слово, дополняя последний байт нулями
+    void finish() {
+        uint64_t word = count ? acc << (64 - count) : 0;
+        for (unsigned i = 0; i < (count + 7) / 8; ++i) {
+            *out++ = static_cast<uint8_t>(word >> (56 - 8 * i));
+        }
+        acc = 0;
+        count = 0;
+    }
+
+    // Как finish, но неполный последний байт возвращается в tail, а не
+    // записывается (его делят соседние участки при параллельной записи).
+    // Возвращает true, если такой байт есть.
+    bool finishPartial(uint8_t& tail) {
+        uint64_t word = count ? acc << (64 - count) : 0;
+        for (unsigned i = 0; i < count / 8; ++i) {
+            *out++ = static_cast<uint8_t>(word >> (56 - 8 * i));
+        }
+        bool partial = count % 8 != 0;
+        if (partial) {
+            tail = static_cast<uint8_t>(word >> (56 - 8 * (count / 8)));
+        }
+        acc = 0;
+        count = 0;
+        return partial;
+    }
+
+    uint8_t* position() const { return out; }
+    void setPosition(uint8_t* newOut) { out = newOut; }
+
+private:
+    void storeWord(uint64_t word) {
+        for (int i = 0; i < 8; ++i) {
+            out[i] = static_cast<uint8_t>(word >> (56 - 8 * i));
+        }
+        out += 8;
+    }
+
+    uint8_t* out;
+    uint64_t acc;
+    unsigned count;
+};
+
+// Длина кода последовательности байтов в битах (без паузы перед первым)
+static uint64_t morseBitLength(const uint8_t* data, size_t size, const MorseByteCodes& codes = MORSE_BYTE_CODES) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < size; ++i) {
+        bits += codes[data[i]].length;
+    }
+    return size > 0 ? bits - BYTE_GAP_LENGTH : 0;
+}
+
+// Кодирование в out (не менее ceil(бит / 8) байт); возвращает число записанных байт
+static size_t encodeMorseBits(const uint8_t* data, size_t size, uint8_t* out,
+                              const MorseByteCodes& codes = MORSE_BYTE_CODES) {
+    MorseBitWriter writer(out);
+    for (size_t i = 0; i < size; ++i) {
+        writer.appendByte(data[i], i == 0, codes);
+    }
+    writer.finish();
+    return writer.position() - out;
+}
+
+// Параллельное кодирование: код каждого байта самодостаточен, поэтому
+// участки кодируются независимо, как только известны их битовые смещения.
+//  1. длины участков в битах (параллельно), префиксная сумма смещений;
+//  2. каждый участок пишется прямо в итоговый буфер со своего смещения;
+//     байт на стыке двух участков пишет только следующий участок,
+//     а хвост предыдущего возвращается отдельно;
+//  3. хвосты объединяются со стыковыми байтами через OR.
+const size_t MORSE_PARALLEL_CHUNK = 1 << 20;
+
+// Битовые смещения участков; offsets[chunks] — общая длина
+static vector<uint64_t> morseChunkOffsets(const uint8_t* data, size_t size, const MorseByteCodes& codes,
+                                          size_t threads) {
+    size_t chunks = (size + MORSE_PARALLEL_CHUNK - 1) / MORSE_PARALLEL_CHUNK;
+    vector<uint64_t> offsets(chunks + 1, 0);
+    parallelForRange(size, MORSE_PARALLEL_CHUNK, threads, [&](size_t begin, size_t end) {
+        size_t c = begin / MORSE_PARALLEL_CHUNK;
+        uint64_t bits = morseBitLength(data + begin, end - begin, codes);
+        // Перед первым байтом каждого участка, кроме начального, идет пауза
+        offsets[c + 1] = c > 0 ? bits + BYTE_GAP_LENGTH : bits;
+    });
+    for (size_t c = 0; c < chunks; ++c) {
+        offsets[c + 1] += offsets[c];
+    }
+    return offsets;
+}
+
+// out должен быть обнулен: стыковые байты дописываются через OR
+static void encodeMorseBitsParallel(const uint8_t* data, size_t size, const vector<uint64_t>& offsets,
+                                    const MorseByteCodes& codes, uint8_t* out, size_t threads) {
+    size_t chunks = offsets.size() - 1;
+    vector<uint8_t> tails(chunks, 0);
+    vector<char> hasTail(chunks, 0);
+
+    parallelForRange(size, MORSE_PARALLEL_CHUNK, threads, [&](size_t begin, size_t end) {
+        size_t c = begin / MORSE_PARALLEL_CHUNK;
+        MorseBitWriter writer(out + offsets[c] / 8, static_cast<unsigned>(offsets[c] % 8));
+        for (size_t i = begin; i < end; ++i) {
+            writer.appendByte(data[i], i == 0, codes);
+        }
+        hasTail[c] = writer.finishPartial(tails[c]);
+    });
+
+    for (size_t c = 0; c < chunks; ++c) {
+        if (hasTail[c]) {
+            out[offsets[c + 1] / 8] |= tails[c];
+        }
+    }
+}
+
+MorseEncodedResult encodeTextToMorse(const string &text) {
+    return encodeTextToMorse(text, 0);
+}
+
+// Код data в out после prefix байт заголовка (заполняет вызывающий);
+// возвращает длину кода в битах
+static uint64_t encodeMorsePayload(const uint8_t* data, size_t size, const MorseByteCodes& codes,
+                                   size_t threads, size_t prefix, vector<unsigned char>& out) {
+    if (threads == 0) {
+        threads = cryptoRuntimePool().threadCount();
+    }
+    // На одном потоке параллельная схема только добавляет проход по данным
+    if (size <= MORSE_PARALLEL_CHUNK || threads <= 1) {
+        // Точный размер известен заранее: одно выделение памяти
+        uint64_t total_bits = morseBitLength(data, size, codes);
+        out.resize(prefix + (total_bits + 7) / 8);
+        encodeMorseBits(data, size, out.data() + prefix, codes);
+        return total_bits;
+    }
+
+    vector<uint64_t> offsets = morseChunkOffsets(data, size, codes, threads);
+    uint64_t total_bits = offsets.back();
+    out.assign(prefix + (total_bits + 7) / 8, 0);
+    encodeMorseBitsParallel(data, size, offsets, codes, out.data() + prefix, threads);
+    return total_bits;
+}
+
+MorseEncodedResult encodeTextToMorse(const string &text, size_t threads) {
+    MetricTimer timer(encodeMetric, text.size());
+    MorseEncodedResult result;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(text.data());
+    uint64_t total_bits = encodeMorsePayload(data, text.size(), MORSE_BYTE_CODES, threads,
+                                             sizeof(total_bits), result.binary_data);
+    memcpy(result.binary_data.data(), &total_bits, sizeof(total_bits));
+    result.success = true;
+    return result;
+}
+
+// ==================== ТАБЛИЧНЫЙ ДЕКОДЕР ====================
+//
+// Разбор битов: серия единиц — элемент (1 — точка, 3 — тире, иначе
+// игнорируется), три и более нулей или конец данных завершают полубайт.
+// Элемент применяется к узлу дерева кодов на первом нуле после серии,
+// полубайт выдается на третьем нуле, поэтому состояние конечно:
+//   узел дерева полубайтов (1..31, корень 1, точка — 2i, тире — 2i + 1;
+//     0 — код длиннее четырех элементов, не совпадет ни с чем)
+//   × фаза серии (7 значений) = 224 состояния.
+// Для каждой пары (состояние, входной байт) заранее вычислены следующее
+// состояние и до двух выданных полубайтов.
+
+enum MorseRunPhase : uint8_t {
+    RUN_IDLE = 0,   // после трех и более нулей (полубайт уже закрыт)
+    RUN_ZERO1,
+    RUN_ZERO2,
+    RUN_ONE1,
+    RUN_ONE2,
+    RUN_ONE3,
+    RUN_ONE_MORE,   // четыре и более единиц — не элемент
+    RUN_PHASES
+};
+
+const unsigned MORSE_NIBBLE_NODES = 32;
+const unsigned MORSE_DECODER_STATES = MORSE_NIBBLE_NODES * RUN_PHASES;
+const uint8_t MORSE_NO_NIBBLE = 0xFF;
+
+static constexpr array<uint8_t, MORSE_NIBBLE_NODES> buildNodeNibbles() {
+    array<uint8_t, MORSE_NIBBLE_NODES> nibbles{};
+    for (uint8_t& nibble : nibbles) nibble = MORSE_NO_NIBBLE;
+    for (unsigned nibble = 0; nibble < 16; ++nibble) {
+        nibbles[morseTrieIndex(NIBBLE_CODES[nibble])] = static_cast<uint8_t>(nibble);
+    }
+    return nibbles;
+}
+
+static constexpr array<uint8_t, MORSE_NIBBLE_NODES> MORSE_NODE_NIBBLES = buildNodeNibbles();
+
+struct MorseDecoderStep {
+    uint8_t node;
+    uint8_t phase;
+    uint8_t emitted;
+    uint8_t nibbles[2];
+};
+
+static constexpr uint8_t applyElement(uint8_t node, uint8_t phase) {
+    if (phase != RUN_ONE1 && phase != RUN_ONE3) return node;
+    if (node == 0 || node >= MORSE_NIBBLE_NODES / 2) return 0;
+    return static_cast<uint8_t>(2 * node + (phase == RUN_ONE3 ? 1 : 0));
+}
+
+static constexpr void closeNibble(MorseDecoderStep& step) {
+    uint8_t nibble = MORSE_NODE_NIBBLES[step.node];
+    if (nibble != MORSE_NO_NIBBLE) {
+        step.nibbles[step.emitted++] = nibble;
+    }
+    step.node = 1;
+}
+
+static constexpr void stepBit(MorseDecoderStep& step, bool bit) {
+    if (bit) {
+        if (step.phase >= RUN_ONE1) {
+            if (step.phase != RUN_ONE_MORE) step.phase++;
+        } else {
+            step.phase = RUN_ONE1;
+        }
+        return;
+    }
+
+    switch (step.phase) {
+        case RUN_IDLE:
+            break;
+        case RUN_ZERO1:
+            step.phase = RUN_ZERO2;
+            break;
+        case RUN_ZERO2:
+            closeNibble(step);
+            step.phase = RUN_IDLE;
+            break;
+        default:
+            step.node = applyElement(step.node, step.phase);
+            step.phase = RUN_ZERO1;
+    }
+}
+
+// Запись таблицы: биты 0-7 — следующее состояние, 8-9 — число полубайтов,
+// 12-15 и 16-19 — сами полубайты
+static constexpr array<array<uint32_t, 256>, MORSE_DECODER_STATES> buildDecoderTable() {
+    array<array<uint32_t, 256>, MORSE_DECODER_STATES> table{};
+    for (unsigned state = 0; state < MORSE_DECODER_STATES; ++state) {
+        for (unsigned byte = 0; byte < 256; ++byte) {
+            MorseDecoderStep step{static_cast<uint8_t>(state / RUN_PHASES),
+                                  static_cast<uint8_t>(state % RUN_PHASES), 0, {0, 0}};
+            for (int j = 7; j >= 0; --j) {
+                stepBit(step, (byte >> j) & 1);
+            }
+            table[state][byte] = (step.node * RUN_PHASES + step.phase) | (step.emitted << 8) |
+                                 (step.nibbles[0] << 12) | (step.nibbles[1] << 16);
+        }
+    }
+    return table;
+}
+
+// Не constexpr: 224 x 256 x 8 шагов превышают -fconstexpr-ops-limit при
+// -fsanitize=undefined. Компилятор свертывает таблицу сам, когда укладывается
+// в предел, иначе она строится при статической инициализации.
+static const array<array<uint32_t, 256>, MORSE_DECODER_STATES> MORSE_DECODER_TABLE = buildDecoderTable();
+
+// Порция входных байтов, полубайты которой собираются в буфере на стеке
+const size_t MORSE_DECODE_BLOCK = 4096;
+
+// Цепочка табличных переходов последовательна: следующее обращение ждет
+// предыдущее. Три нуля подряд всегда возвращают автомат в состояние
+// RUN_IDLE (полубайт закрыт, узел — корень), поэтому граница байта,
+// перед которой байт кончается на 000, — точка синхронизации: от нее
+// разбор можно начать независимо. Порция делится по таким точкам на
+// полосы, цепочки полос идут вперемешку и перекрываются в конвейере.
+const unsigned MORSE_DECODE_LANES = 4;
+const uint8_t MORSE_IDLE_STATE = 1 * RUN_PHASES + RUN_IDLE;
+
+// Первая точка синхронизации в (from, end): позиция после байта из
+// [from, end), младшие три бита которого нулевые; 0 — не найдена.
+// Байты проверяются по восемь в 64-битном слове.
+static size_t findMorseSyncPoint(const uint8_t* data, size_t from, size_t end) {
+    const uint64_t low_bits = 0x0707070707070707ull;
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t highs = 0x8080808080808080ull;
+    size_t i = from;
+    for (; i + 8 <= end; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        uint64_t tails = word & low_bits;
+        // Старший бит установлен у нулевых байтов (младший из них — точно)
+        uint64_t zero = (tails - ones) & ~tails & highs;
+        if (zero) {
+            size_t point = i + countr_zero(zero) / 8 + 1;
+            return point < end ? point : 0;
+        }
+    }
+    for (; i < end; ++i) {
+        if ((data[i] & 0x07) == 0) {
+            return i + 1 < end ? i + 1 : 0;
+        }
+    }
+    return 0;
+}
+
+// Полоса: входные байты, место для ее полубайтов и состояние автомата
+struct MorseDecodeLane {
+    const uint8_t* in;
+    size_t length;
+    uint8_t* nibbles;
+    size_t count;
+    uint8_t state;
+};
+
+static inline void stepMorseLane(MorseDecodeLane& lane, size_t i) {
+    uint32_t entry = MORSE_DECODER_TABLE[lane.state][lane.in[i]];
+    lane.state = static_cast<uint8_t>(entry);
+    lane.nibbles[lane.count] = (entry >> 12) & 0xF;
+    lane.nibbles[lane.count + 1] = (entry >> 16) & 0xF;
+    lane.count += (entry >> 8) & 0x3;
+}
+
+// Декодер над упакованными байтами; память постоянна, состояние
+// переносится между порциями
+class MorseTableDecoder {
+public:
+    MorseTableDecoder() : state(1 * RUN_PHASES + RUN_IDLE), high_nibble(true), current_byte(0) {}
+
+    // Подача size байт, из которых учитываются не более bits_left бит;
+    // bits_left уменьшается на число обработанных бит
+    void feed(const uint8_t* data, size_t size, uint64_t& bits_left, string& out) {
+        size_t full = static_cast<size_t>(min<uint64_t>(size, bits_left / 8));
+
+        // Полубайты пишутся без ветвлений (запись всегда двойная, указатель
+        // сдвигается на число выданных), затем склеиваются в байты.
+        // У каждой полосы своя область буфера: не больше двух полубайтов на байт.
+        uint8_t nibbles[2 * MORSE_DECODE_BLOCK + 2];
+        for (size_t block = 0; block < full; block += MORSE_DECODE_BLOCK) {
+            size_t end = min(full, block + MORSE_DECODE_BLOCK);
+            decodeBlock(data, block, end, nibbles, out);
+        }
+        bits_left -= uint64_t(full) * 8;
+
+        // Неполный последний байт разбирается побитно
+        if (full < size && bits_left > 0) {
+            MorseDecoderStep step = currentStep();
+            for (unsigned j = 0; j < bits_left; ++j) {
+                stepBit(step, (data[full] >> (7 - j)) & 1);
+            }
+            applyStep(step, out);
+            bits_left = 0;
+        }
+    }
+
+    // Конец данных: незавершенная серия единиц и полубайт закрываются
+    void finish(string& out) {
+        MorseDecoderStep step = currentStep();
+        step.node = applyElement(step.node, step.phase);
+        closeNibble(step);
+        step.phase = RUN_IDLE;
+        applyStep(step, out);
+    }
+
+private:
+    void decodeBlock(const uint8_t* data, size_t block, size_t end, uint8_t* nibbles, string& out) {
+        size_t bounds[MORSE_DECODE_LANES + 1];
+        size_t lane_count = 1;
+        bounds[0] = block;
+        for (unsigned k = 1; k < MORSE_DECODE_LANES; ++k) {
+            size_t nominal = block + (end - block) * k / MORSE_DECODE_LANES;
+            size_t point = findMorseSyncPoint(data, max(nominal, bounds[lane_count - 1]), end);
+            if (point == 0) break;
+            bounds[lane_count++] = point;
+        }
+        bounds[lane_count] = end;
+
+        MorseDecodeLane lanes[MORSE_DECODE_LANES];
+        for (size_t k = 0; k < lane_count; ++k) {
+            lanes[k] = MorseDecodeLane{data + bounds[k], bounds[k + 1] - bounds[k],
+                                       nibbles + 2 * (bounds[k] - block), 0,
+                                       k == 0 ? state : MORSE_IDLE_STATE};
+        }
+
+        static_assert(MORSE_DECODE_LANES == 4, "чередование полос ниже расписано на четыре");
+        size_t done = 0;
+        if (lane_count == MORSE_DECODE_LANES) {
+            size_t common = min(min(lanes[0].length, lanes[1].length), min(lanes[2].length, lanes[3].length));
+            for (; done < common; ++done) {
+                stepMorseLane(lanes[0], done);
+                stepMorseLane(lanes[1], done);
+                stepMorseLane(lanes[2], done);
+                stepMorseLane(lanes[3], done);
+            }
+        }
+
+        for (size_t k = 0; k < lane_count; ++k) {
+            for (size_t i = done; i < lanes[k].length; ++i) {
+                stepMorseLane(lanes[k], i);
+            }
+            pushNibbles(lanes[k].nibbles, lanes[k].count, out);
+        }
+        state = lanes[lane_count - 1].state;
+    }
+
+    MorseDecoderStep currentStep() const {
+        return MorseDecoderStep{static_cast<uint8_t>(state / RUN_PHASES),
+                                static_cast<uint8_t>(state % RUN_PHASES), 0, {0, 0}};
+    }
+
+    void applyStep(const MorseDecoderStep& step, string& out) {
+        for (unsigned i = 0; i < step.emitted; ++i) {
+            pushNibble(step.nibbles[i], out);
+        }
+        state = static_cast<uint8_t>(step.node * RUN_PHASES + step.phase);
+    }
+
+    void pushNibbles(const uint8_t* nibbles, size_t count, string& out) {
+        size_t i = 0;
+        if (!high_nibble && count > 0) {
+            pushNibble(nibbles[i++], out);
+        }
+        size_t pairs = (count - i) / 2;
+        size_t start = out.size();
+        out.resize(start + pairs);
+        for (size_t p = 0; p < pairs; ++p, i += 2) {
+            out[start + p] = static_cast<char>((nibbles[i] << 4) | nibbles[i + 1]);
+        }
+        if (i < count) {
+            pushNibble(nibbles[i], out);
+        }
+    }
+
+    void pushNibble(unsigned nibble, string& out) {
+        if (high_nibble) {
+            current_byte = static_cast<unsigned char>(nibble << 4);
+            high_nibble = false;
+        } else {
+            out += static_cast<char>(current_byte | nibble);
+            high_nibble = true;
+        }
+    }
+
+    uint8_t state;
+    bool high_nibble;
+    unsigned char current_byte;
+};
+
+// Размер порции потоковой обработки
+const size_t MORSE_STREAM_CHUNK = 1 << 16;
+
+// Заголовок при неизвестной заранее длине (вывод в канал):
+// декодер читает биты до конца данных, хвостовые нули дополнения
+// не меняют результат
+const uint64_t MORSE_UNKNOWN_LENGTH = UINT64_MAX;
+
+// ==================== КАДРОВЫЙ ФОРМАТ ====================
+//
+// Поток кадров для данных произвольного размера в постоянной памяти:
+//   "MORSEFR1"                                  — 8 байт сигнатуры
+//   кадр: u32 байт открытого текста, u32 бит, ceil(бит / 8) байт кода
+//   кадр с нулевым числом байт                  — конец данных
+// Числа little-endian. Каждый кадр кодируется независимо (первый байт
+// без паузы), поэтому кадры можно разбирать по отдельности, а длина
+// расшифрованного кадра проверяется. Сигнатура как uint64_t заголовок
+// старого формата означала бы ~3.5e18 бит, поэтому форматы различимы.
+
+const char MORSE_FRAMED_MAGIC[8] = {'M', 'O', 'R', 'S', 'E', 'F', 'R', '1'};
+const size_t MORSE_FRAME_BYTES = MORSE_STREAM_CHUNK;
+
+static void putLE32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint32_t getLE32(const uint8_t* in) {
+    return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+}
+
+// Заголовок и код одного кадра; возвращает размер кадра в out
+static size_t encodeMorseFrame(const uint8_t* data, size_t size, uint8_t* out) {
+    uint64_t bits = morseBitLength(data, size);
+    putLE32(out, static_cast<uint32_t>(size));
+    putLE32(out + 4, static_cast<uint32_t>(bits));
+    return 8 + encodeMorseBits(data, size, out + 8);
+}
+
+static bool decodeMorseFrame(const uint8_t* packed, uint32_t bytes, uint32_t bits, string& out) {
+    size_t start = out.size();
+    uint64_t bits_left = bits;
+    MorseTableDecoder decoder;
+    decoder.feed(packed, (bits + 7) / 8, bits_left, out);
+    decoder.finish(out);
+    return out.size() - start == bytes;
+}
+
+// Проверка заголовка кадра до чтения кода
+static bool validFrameHeader(uint32_t bytes, uint32_t bits) {
+    return bytes <= MORSE_FRAME_BYTES && bits <= uint64_t(bytes) * 32;
+}
+
+MorseFileOperationResult encodeStreamToMorseFramed(istream &input, ostream &output) {
+    output.write(MORSE_FRAMED_MAGIC, sizeof(MORSE_FRAMED_MAGIC));
+
+    vector<char> buffer(MORSE_FRAME_BYTES);
+    vector<uint8_t> frame(8 + MORSE_FRAME_BYTES * sizeof(uint32_t));
+    while (input.read(buffer.data(), buffer.size()) || input.gcount() > 0) {
+        size_t count = static_cast<size_t>(input.gcount());
+        size_t frame_size = encodeMorseFrame(reinterpret_cast<const uint8_t*>(buffer.data()), count, frame.data());
+        output.write(reinterpret_cast<const char*>(frame.data()), frame_size);
+        if (!output) {
+            return {false, "Ошибка записи выходных данных"};
+        }
+    }
+    if (input.bad()) {
+        return {false, "Ошибка чтения входных данных"};
+    }
+
+    uint8_t terminator[8] = {0};
+    output.write(reinterpret_cast<const char*>(terminator), sizeof(terminator));
+    output.flush();
+    if (!output) {
+        return {false, "Ошибка записи выходных данных"};
+    }
+    return {true, "Данные успешно закодированы"};
+}
+
+// Разбор кадров после сигнатуры
+static MorseFileOperationResult decodeFramedStream(istream &input, ostream &output) {
+    vector<uint8_t> packed(MORSE_FRAME_BYTES * sizeof(uint32_t));
+    string text;
+    while (true) {
+        uint8_t header[8];
+        if (!input.read(reinterpret_cast<char*>(header), sizeof(header))) {
+            return {false, "Данные обрываются: нет завершающего кадра"};
+        }
+        uint32_t bytes = getLE32(header);
+        uint32_t bits = getLE32(header + 4);
+        if (bytes == 0) {
+            break;
+        }
+        if (!validFrameHeader(bytes, bits)) {
+            return {false, "Поврежденный заголовок кадра"};
+        }
+        if (!input.read(reinterpret_cast<char*>(packed.data()), (bits + 7) / 8)) {
+            return {false, "Данные обрываются внутри кадра"};
+        }
+
+        text.clear();
+        if (!decodeMorseFrame(packed.data(), bytes, bits, text)) {
+            return {false, "Длина кадра не совпадает с заголовком"};
+        }
+        output.write(text.data(), text.size());
+        if (!output) {
+            return {false, "Ошибка записи выходных данных"};
+        }
+    }
+    output.flush();
+    return {true, "Данные успешно декодированы"};
+}
+
+static MorseDecodedResult decodeFramedMemory(const vector<unsigned char> &data) {
+    MorseDecodedResult result;
+    result.success = false;
+
+    size_t pos = sizeof(MORSE_FRAMED_MAGIC);
+    while (true) {
+        if (data.size() - pos < 8) {
+            result.error_message = "Данные обрываются: нет завершающего кадра";
+            return result;
+        }
+        uint32_t bytes = getLE32(&data[pos]);
+        uint32_t bits = getLE32(&data[pos + 4]);
+        pos += 8;
+        if (bytes == 0) {
+            break;
+        }
+        if (!validFrameHeader(bytes, bits) || data.size() - pos < (bits + 7) / 8) {
+            result.error_message = "Поврежденный кадр";
+            return result;
+        }
+        if (!decodeMorseFrame(&data[pos], bytes, bits, result.plaintext)) {
+            result.error_message = "Длина кадра не совпадает с заголовком";
+            return result;
+        }
+        pos += (bits + 7) / 8;
+    }
+
+    result.success = true;
+    return result;
+}
+
+// ==================== АДАПТИВНЫЕ КОДЫ ====================
+//
+// Коды полубайтов назначаются по частотам конкретного файла: самые частые
+// значения получают самые короткие коды. У текста распределения старших
+// и младших полубайтов совсем разные (старшие почти всегда 2, 4-7),
+// поэтому таблиц две. Набор кодов прежний (NIBBLE_CODES), меняется
+// только порядок, поэтому декодер использует ту же таблицу переходов:
+// он выдает номера кодов, которые затем переводятся обратно в байты.
+//   "MORSEAD1"                                 — 8 байт сигнатуры
+//   16 байт: номер кода для старших полубайтов 0..15, 16 байт — для младших
+//   u64 бит (little-endian), ceil(бит / 8) байт кода
+// Длина кода — сумма по полубайтам частота × длина кода, и сопоставление
+// частот по убыванию с длинами по возрастанию дает наименьшую сумму
+// для этого набора кодов.
+
+const char MORSE_ADAPTIVE_MAGIC[8] = {'M', 'O', 'R', 'S', 'E', 'A', 'D', '1'};
+const size_t MORSE_ADAPTIVE_HEADER_BYTES = sizeof(MORSE_ADAPTIVE_MAGIC) + 32 + sizeof(uint64_t);
+
+typedef array<uint64_t, 256> MorseByteCounts;
+
+// Частоты байтов. Четыре набора счетчиков по очереди: подряд идущие
+// одинаковые байты не ждут друг друга на одной ячейке памяти
+static void countMorseBytes(const uint8_t* data, size_t size, MorseByteCounts& counts) {
+    array<MorseByteCounts, 4> partial{};
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        partial[0][data[i]]++;
+        partial[1][data[i + 1]]++;
+        partial[2][data[i + 2]]++;
+        partial[3][data[i + 3]]++;
+    }
+    for (; i < size; ++i) {
+        partial[0][data[i]]++;
+    }
+    for (unsigned byte = 0; byte < 256; ++byte) {
+        counts[byte] += partial[0][byte] + partial[1][byte] + partial[2][byte] + partial[3][byte];
+    }
+}
+
+static constexpr unsigned nibbleCodeLength(const char* morse) {
+    MorseByteCode code{0, 0};
+    appendNibbleCode(code, morse);
+    return code.length;
+}
+
+// Частым полубайтам — короткие коды (при равенстве порядок прежний)
+static void assignNibbleCodes(const array<uint64_t, 16>& frequency, array<uint8_t, 16>& codes) {
+    array<uint8_t, 16> by_length, by_frequency;
+    iota(by_length.begin(), by_length.end(), 0);
+    iota(by_frequency.begin(), by_frequency.end(), 0);
+    stable_sort(by_length.begin(), by_length.end(), [](uint8_t a, uint8_t b) {
+        return nibbleCodeLength(NIBBLE_CODES[a]) < nibbleCodeLength(NIBBLE_CODES[b]);
+    });
+    stable_sort(by_frequency.begin(), by_frequency.end(), [&frequency](uint8_t a, uint8_t b) {
+        return frequency[a] > frequency[b];
+    });
+    for (size_t rank = 0; rank < 16; ++rank) {
+        codes[by_frequency[rank]] = by_length[rank];
+    }
+}
+
+static MorseNibbleMap buildAdaptiveMap(const MorseByteCounts& counts) {
+    array<uint64_t, 16> high{}, low{};
+    for (unsigned byte = 0; byte < 256; ++byte) {
+        high[byte >> 4] += counts[byte];
+        low[byte & 0x0F] += counts[byte];
+    }
+    MorseNibbleMap map;
+    assignNibbleCodes(high, map.high);
+    assignNibbleCodes(low, map.low);
+    return map;
+}
+
+// Точная длина кода по частотам байтов (без паузы перед первым)
+static uint64_t adaptiveBitLength(const MorseByteCounts& counts, const MorseByteCodes& codes) {
+    uint64_t bits = 0, bytes = 0;
+    for (unsigned byte = 0; byte < 256; ++byte) {
+        bits += counts[byte] * codes[byte].length;
+        bytes += counts[byte];
+    }
+    return bytes > 0 ? bits - BYTE_GAP_LENGTH : 0;
+}
+
+static void writeAdaptiveHeader(uint8_t* out, const MorseNibbleMap& map, uint64_t total_bits) {
+    memcpy(out, MORSE_ADAPTIVE_MAGIC, sizeof(MORSE_ADAPTIVE_MAGIC));
+    out += sizeof(MORSE_ADAPTIVE_MAGIC);
+    memcpy(out, map.high.data(), 16);
+    memcpy(out + 16, map.low.data(), 16);
+    putLE32(out + 32, static_cast<uint32_t>(total_bits));
+    putLE32(out + 36, static_cast<uint32_t>(total_bits >> 32));
+}
+
+static bool isNibblePermutation(const array<uint8_t, 16>& codes) {
+    unsigned seen = 0;
+    for (uint8_t code : codes) {
+        if (code >= 16) return false;
+        seen |= 1u << code;
+    }
+    return seen == 0xFFFF;
+}
+
+// Заголовок целиком (с сигнатурой); false — таблицы не перестановки
+static bool readAdaptiveHeader(const uint8_t* in, MorseNibbleMap& map, uint64_t& total_bits) {
+    in += sizeof(MORSE_ADAPTIVE_MAGIC);
+    memcpy(map.high.data(), in, 16);
+    memcpy(map.low.data(), in + 16, 16);
+    total_bits = getLE32(in + 32) | (uint64_t(getLE32(in + 36)) << 32);
+    return isNibblePermutation(map.high) && isNibblePermutation(map.low);
+}
+
+// Байт из номеров кодов (как их выдает табличный декодер) -> исходный байт
+static array<uint8_t, 256> buildMorseByteTranslation(const MorseNibbleMap& map) {
+    array<uint8_t, 16> high, low;
+    for (uint8_t nibble = 0; nibble < 16; ++nibble) {
+        high[map.high[nibble]] = nibble;
+        low[map.low[nibble]] = nibble;
+    }
+    array<uint8_t, 256> translate;
+    for (unsigned byte = 0; byte < 256; ++byte) {
+        translate[byte] = static_cast<uint8_t>((high[byte >> 4] << 4) | low[byte & 0x0F]);
+    }
+    return translate;
+}
+
+static void translateMorseBytes(string& text, const array<uint8_t, 256>& translate) {
+    for (size_t i = 0; i < text.size(); ++i) {
+        text[i] = static_cast<char>(translate[static_cast<uint8_t>(text[i])]);
+    }
+}
+
+MorseEncodedResult encodeTextToMorseAdaptive(const string &text, size_t threads) {
+    MetricTimer timer(encodeMetric, text.size());
+    MorseEncodedResult result;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(text.data());
+    MorseByteCounts counts{};
+    countMorseBytes(data, text.size(), counts);
+    MorseNibbleMap map = buildAdaptiveMap(counts);
+    MorseByteCodes codes = buildByteCodes(map);
+
+    uint64_t total_bits = encodeMorsePayload(data, text.size(), codes, threads,
+                                             MORSE_ADAPTIVE_HEADER_BYTES, result.binary_data);
+    writeAdaptiveHeader(result.binary_data.data(), map, total_bits);
+    result.success = true;
+    return result;
+}
+
+static MorseDecodedResult decodeAdaptiveMemory(const vector<unsigned char> &data) {
+    MorseDecodedResult result;
+    result.success = false;
+
+    MorseNibbleMap map;
+    uint64_t total_bits;
+    if (data.size() < MORSE_ADAPTIVE_HEADER_BYTES) {
+        result.error_message = "Данные обрываются в заголовке";
+        return result;
+    }
+    if (!readAdaptiveHeader(data.data(), map, total_bits)) {
+        result.error_message = "Поврежденная таблица кодов";
+        return result;
+    }
+
+    size_t payload = data.size() - MORSE_ADAPTIVE_HEADER_BYTES;
+    result.plaintext.reserve(static_cast<size_t>(min<uint64_t>(uint64_t(payload) * 8, total_bits) / 12 + 1));
+    MorseTableDecoder decoder;
+    decoder.feed(data.data() + MORSE_ADAPTIVE_HEADER_BYTES, payload, total_bits, result.plaintext);
+    decoder.finish(result.plaintext);
+    translateMorseBytes(result.plaintext, buildMorseByteTranslation(map));
+
+    result.success = true;
+    return result;
+}
+
+static MorseDecodedResult decodeMorseMemory(const vector<unsigned char> &data) {
+    MorseDecodedResult result;
+
+    if (data.size() < sizeof(uint64_t)) {
+        result.success = false;
+        result.error_message = "Данные слишком короткие";
+        return result;
+    }
+
+    if (memcmp(data.data(), MORSE_FRAMED_MAGIC, sizeof(MORSE_FRAMED_MAGIC)) == 0) {
+        return decodeFramedMemory(data);
+    }
+    if (memcmp(data.data(), MORSE_ADAPTIVE_MAGIC, sizeof(MORSE_ADAPTIVE_MAGIC)) == 0) {
+        return decodeAdaptiveMemory(data);
+    }
+
+    uint64_t total_bits;
+    memcpy(&total_bits, data.data(), sizeof(total_bits));
+
+    // Самый короткий байт занимает 12 бит вместе с паузой
+    size_t payload = data.size() - sizeof(total_bits);
+    result.plaintext.reserve(static_cast<size_t>(min<uint64_t>(uint64_t(payload) * 8, total_bits) / 12 + 1));
+
+    MorseTableDecoder decoder;
+    decoder.feed(data.data() + sizeof(total_bits), payload, total_bits, result.plaintext);
+    decoder.finish(result.plaintext);
+
+    result.success = true;
+    return result;
+}
+
+MorseDecodedResult decodeTextFromMorse(const vector<unsigned char> &data) {
+    MetricTimer timer(decodeMetric, data.size());
+    MorseDecodedResult result = decodeMorseMemory(data);
+    if (!result.success) timer.fail();
+    return result;
+}
+
+// Мелкие буферы объединяются в задачи примерно такого объема,
+// чтобы накладные расходы пула не превышали само декодирование
+const size_t MORSE_BATCH_TASK_BYTES = 64 * 1024;
+
+vector<MorseDecodedResult> decodeTextFromMorseBatch(const vector<vector<unsigned char>> &inputs, size_t threads) {
+    vector<MorseDecodedResult> results(inputs.size());
+    if (inputs.size() <= 1 || threads == 1) {
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            results[i] = decodeTextFromMorse(inputs[i]);
+        }
+        return results;
+    }
+
+    // Каждая задача пишет только в свои элементы results
+    TaskGroup group(min(threads ? threads : cryptoRuntimePool().threadCount(), inputs.size()));
+    size_t first = 0;
+    while (first < inputs.size()) {
+        size_t last = first;
+        size_t bytes = 0;
+        while (last < inputs.size() && (last == first || bytes < MORSE_BATCH_TASK_BYTES)) {
+            bytes += inputs[last++].size();
+        }
+        group.run([&inputs, &results, first, last] {
+            for (size_t i = first; i < last; ++i) {
+                results[i] = decodeTextFromMorse(inputs[i]);
+            }
+        });
+        first = last;
+    }
+    group.wait();
+    return results;
+}
+
+// Код всего потока input в output без заголовка; total_bits — длина кода.
+// Каждый байт дает не более 4 байт вывода; неполное слово переносится
+// между порциями в аккумуляторе
+static MorseFileOperationResult writeMorseStream(istream &input, ostream &output, const MorseByteCodes &codes,
+                                                 uint64_t &total_bits) {
+    vector<char> buffer(MORSE_STREAM_CHUNK);
+    vector<uint8_t> packed(MORSE_STREAM_CHUNK * sizeof(uint32_t) + sizeof(uint64_t));
+    MorseBitWriter writer(packed.data());
+    bool first_byte = true;
+    total_bits = 0;
+
+    while (input.read(buffer.data(), buffer.size()) || input.gcount() > 0) {
+        size_t count = static_cast<size_t>(input.gcount());
+        for (size_t i = 0; i < count; ++i) {
+            unsigned char byte = buffer[i];
+            total_bits += codes[byte].length - (first_byte ? BYTE_GAP_LENGTH : 0);
+            writer.appendByte(byte, first_byte, codes);
+            first_byte = false;
+        }
+
+        output.write(reinterpret_cast<const char*>(packed.data()), writer.position() - packed.data());
+        writer.setPosition(packed.data());
+        if (!output) {
+            return {false, "Ошибка записи выходных данных"};
+        }
+    }
+    if (input.bad()) {
+        return {false, "Ошибка чтения входных данных"};
+    }
+
+    writer.finish();
+    output.write(reinterpret_cast<const char*>(packed.data()), writer.position() - packed.data());
+    return {true, ""};
+}
+
+MorseFileOperationResult encodeStreamToMorse(istream &input, ostream &output) {
+    // Длина в битах неизвестна до конца потока: если вывод допускает
+    // позиционирование, заголовок исправляется в конце
+    streampos header_pos = output.tellp();
+    uint64_t total_bits = MORSE_UNKNOWN_LENGTH;
+    output.write(reinterpret_cast<const char*>(&total_bits), sizeof(total_bits));
+
+    MorseFileOperationResult result = writeMorseStream(input, output, MORSE_BYTE_CODES, total_bits);
+    if (!result.success) {
+        return result;
+    }
+
+    if (header_pos != streampos(-1)) {
+        output.seekp(header_pos);
+        output.write(reinterpret_cast<const char*>(&total_bits), sizeof(total_bits));
+        output.seekp(0, ios::end);
+    }
+    output.flush();
+    if (!output) {
+        return {false, "Ошибка записи выходных данных"};
+    }
+    return {true, "Данные успешно закодированы"};
+}
+
+// Два прохода по входу: частоты, затем код. Длина кода известна после
+// первого прохода, поэтому вывод может быть каналом.
+MorseFileOperationResult encodeStreamToMorseAdaptive(istream &input, ostream &output) {
+    streampos start = input.tellg();
+    if (start == streampos(-1)) {
+        return {false, "Вход не допускает повторного чтения"};
+    }
+
+    MorseByteCounts counts{};
+    vector<char> buffer(MORSE_STREAM_CHUNK);
+    while (input.read(buffer.data(), buffer.size()) || input.gcount() > 0) {
+        countMorseBytes(reinterpret_cast<const uint8_t*>(buffer.data()), static_cast<size_t>(input.gcount()), counts);
+    }
+    if (input.bad()) {
+        return {false, "Ошибка чтения входных данных"};
+    }
+    input.clear();
+    input.seekg(start);
+    if (!input) {
+        return {false, "Вход не допускает повторного чтения"};
+    }
+
+    MorseNibbleMap map = buildAdaptiveMap(counts);
+    MorseByteCodes codes = buildByteCodes(map);
+    uint64_t expected_bits = adaptiveBitLength(counts, codes);
+    uint8_t header[MORSE_ADAPTIVE_HEADER_BYTES];
+    writeAdaptiveHeader(header, map, expected_bits);
+    output.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    uint64_t total_bits;
+    MorseFileOperationResult result = writeMorseStream(input, output, codes, total_bits);
+    if (!result.success) {
+        return result;
+    }
+    if (total_bits != expected_bits) {
+        return {false, "Входные данные изменились во время кодирования"};
+    }
+    output.flush();
+    if (!output) {
+        return {false, "Ошибка записи выходных данных"};
+    }
+    return {true, "Данные успешно закодированы"};
+}
+
+// Разбор кода после заголовка; translate (если задан) переводит
+// каждый полученный байт
+static MorseFileOperationResult decodeMorseStreamBits(istream &input, ostream &output, uint64_t bits_left,
+                                                      const array<uint8_t, 256>* translate) {
+    vector<char> buffer(MORSE_STREAM_CHUNK);
+    MorseTableDecoder decoder;
+    string text;
+
+    while (bits_left > 0 && (input.read(buffer.data(), buffer.size()) || input.gcount() > 0)) {
+        size_t count = static_cast<size_t>(input.gcount());
+        text.clear();
+        decoder.feed(reinterpret_cast<const uint8_t*>(buffer.data()), count, bits_left, text);
+        if (translate) translateMorseBytes(text, *translate);
+        output.write(text.data(), text.size());
+        if (!output) {
+            return {false, "Ошибка записи выходных данных"};
+        }
+    }
+    if (input.bad()) {
+        return {false, "Ошибка чтения входных данных"};
+    }
+
+    text.clear();
+    decoder.finish(text);
+    if (translate) translateMorseBytes(text, *translate);
+    output.write(text.data(), text.size());
+    output.flush();
+    if (!output) {
+        return {false, "Ошибка записи выходных данных"};
+    }
+    return {true, "Данные успешно декодированы"};
+}
+
+MorseFileOperationResult decodeStreamFromMorse(istream &input, ostream &output) {
+    uint64_t total_bits;
+    if (!input.read(reinterpret_cast<char*>(&total_bits), sizeof(total_bits))) {
+        return {false, "Данные слишком короткие"};
+    }
+    if (memcmp(&total_bits, MORSE_FRAMED_MAGIC, sizeof(total_bits)) == 0) {
+        return decodeFramedStream(input, output);
+    }
+    if (memcmp(&total_bits, MORSE_ADAPTIVE_MAGIC, sizeof(total_bits)) == 0) {
+        uint8_t header[MORSE_ADAPTIVE_HEADER_BYTES];
+        memcpy(header, MORSE_ADAPTIVE_MAGIC, sizeof(MORSE_ADAPTIVE_MAGIC));
+        if (!input.read(reinterpret_cast<char*>(header) + sizeof(MORSE_ADAPTIVE_MAGIC),
+                        sizeof(header) - sizeof(MORSE_ADAPTIVE_MAGIC))) {
+            return {false, "Данные обрываются в заголовке"};
+        }
+        MorseNibbleMap map;
+        if (!readAdaptiveHeader(header, map, total_bits)) {
+            return {false, "Поврежденная таблица кодов"};
+        }
+        array<uint8_t, 256> translate = buildMorseByteTranslation(map);
+        return decodeMorseStreamBits(input, output, total_bits, &translate);
+    }
+    return decodeMorseStreamBits(input, output, total_bits, nullptr);
+}
+
+// Замер файловой операции; объем — размер входного файла,
+// ошибка — результат с success == false
+template <typename Operation>
+static MorseFileOperationResult measureFileOperation(OperationMetric& metric, const string& input_path,
+                                                     Operation operation) {
+    struct stat st;
+    MetricTimer timer(metric, stat(input_path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0);
+    MorseFileOperationResult result = operation();
+    if (!result.success) timer.fail();
+    return result;
+}
+
+MorseFileOperationResult encodeFileToMorseFramed(const string &input_path, const string &output_path) {
+    return measureFileOperation(fileEncodeMetric, input_path, [&]() -> MorseFileOperationResult {
+        ifstream input(input_path, ios::binary);
+        if (!input) {
+            return {false, "Невозможно открыть входной файл"};
+        }
+
+        ofstream output(output_path, ios::binary);
+        if (!output) {
+            return {false, "Невозможно открыть выходной файл"};
+        }
+
+        MorseFileOperationResult result = encodeStreamToMorseFramed(input, output);
+        if (!result.success) {
+            return result;
+        }
+        return {true, "Файл успешно закодирован"};
+    });
+}
+
+MorseFileOperationResult encodeFileToMorse(const string &input_path, const string &output_path) {
+    return measureFileOperation(fileEncodeMetric, input_path, [&]() -> MorseFileOperationResult {
+        ifstream input(input_path, ios::binary);
+        if (!input) {
+            return {false, "Невозможно открыть выходной файл"};
+        }
+
+        ofstream output(output_path, ios::binary);
+        if (!output) {
+            return {false, "Невозможно открыть выходной файл"};
+        }
+
+        MorseFileOperationResult result = encodeStreamToMorse(input, output);
+        if (!result.success) {
+            return result;
+        }
+        return {true, "Файл успешно закодирован"};
+    });
+}
+
+MorseFileOperationResult encodeFileToMorseAdaptive(const string &input_path, const string &output_path) {
+    return measureFileOperation(fileEncodeMetric, input_path, [&]() -> MorseFileOperationResult {
+        ifstream input(input_path, ios::binary);
+        if (!input) {
+            return {false, "Невозможно открыть входной файл"};
+        }
+
+        ofstream output(output_path, ios::binary);
+        if (!output) {
+            return {false, "Невозможно открыть выходной файл"};
+        }
+
+        MorseFileOperationResult result = encodeStreamToMorseAdaptive(input, output);
+        if (!result.success) {
+            return result;
+        }
+        return {true, "Файл успешно закодирован"};
+    });
+}
+
+MorseFileOperationResult decodeFileFromMorse(const string &input_path, const string &output_path) {
+    return measureFileOperation(fileDecodeMetric, input_path, [&]() -> MorseFileOperationResult {
+        ifstream input(input_path, ios::binary);
+        if (!input) {
+            return {false, "Невозможно открыть входной файл"};
+        }
+
+        ofstream output(output_path, ios::binary);
+        if (!output) {
+            return {false, "Не могу открыть выходной файл"};
+        }
+
+        MorseFileOperationResult result = decodeStreamFromMorse(input, output);
+        if (!result.success) {
+            return result;
+        }
+        return {true, "Файл успешно декодирован"};
+    });
+}
+
+// ==================== ЗВУКОВОЙ СИГНАЛ (WAV) ====================
+//
+// Текст озвучивается тоном: точка — 1 единица, тире — 3, пауза внутри
+// знака — 1, между знаками — 3, между словами — 7. Единица при скорости
+// W слов/мин равна 1.2 / W с (слово PARIS — 50 единиц). Формы точки и
+// тире с плавными фронтами вычисляются один раз и копируются в выходной
+// буфер, паузы — нули; память постоянна при любом объеме текста.
+
+const size_t MORSE_AUDIO_BUFFER_BYTES = 1 << 16;
+const size_t MORSE_WAV_HEADER_BYTES = 44;
+const uint32_t MORSE_WAV_UNKNOWN_SIZE = 0xFFFFFFFF;
+const unsigned MORSE_SAMPLE_BYTES = 2;   // PCM 16 бит, моно
+
+static void putLE16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void buildWavHeader(uint8_t* header, unsigned sample_rate, uint64_t data_bytes) {
+    // Размеры больше 4 ГБ в WAV не представимы: остается "неизвестно"
+    uint32_t data_size = data_bytes + 36 < MORSE_WAV_UNKNOWN_SIZE ? static_cast<uint32_t>(data_bytes)
+                                                                  : MORSE_WAV_UNKNOWN_SIZE;
+    uint32_t riff_size = data_size == MORSE_WAV_UNKNOWN_SIZE ? MORSE_WAV_UNKNOWN_SIZE : data_size + 36;
+    memcpy(header, "RIFF", 4);
+    putLE32(header + 4, riff_size);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    putLE32(header + 16, 16);
+    putLE16(header + 20, 1);                     // PCM
+    putLE16(header + 22, 1);                     // каналов
+    putLE32(header + 24, sample_rate);
+    putLE32(header + 28, sample_rate * MORSE_SAMPLE_BYTES);
+    putLE16(header + 32, MORSE_SAMPLE_BYTES);
+    putLE16(header + 34, 8 * MORSE_SAMPLE_BYTES);
+    memcpy(header + 36, "data", 4);
+    putLE32(header + 40, data_size);
+}
+
+static string checkAudioOptions(const MorseAudioOptions& options) {
+    if (options.sampleRate < 4000 || options.sampleRate > 192000) {
+        return "Частота дискретизации должна быть от 4000 до 192000 Гц";
+    }
+    if (!(options.wpm >= 1 && options.wpm <= 200)) {
+        return "Скорость должна быть от 1 до 200 слов/мин";
+    }
+    if (options.farnsworthWpm != 0 && !(options.farnsworthWpm >= 1 && options.farnsworthWpm <= options.wpm)) {
+        return "Общая скорость Фарнсворта должна быть от 1 до скорости знаков";
+    }
+    if (!(options.toneHz > 0 && options.toneHz < options.sampleRate / 2.0)) {
+        return "Частота тона должна быть меньше половины частоты дискретизации";
+    }
+    if (!(options.amplitude > 0 && options.amplitude <= 1)) {
+        return "Амплитуда должна быть в пределах (0, 1]";
+    }
+    return "";
+}
+
+// Генератор PCM: элементы складываются в буфер, полный буфер пишется в поток
+class MorseToneWriter {
+public:
+    MorseToneWriter(const MorseAudioOptions& options, ostream& output)
+        : output(output), buffer(MORSE_AUDIO_BUFFER_BYTES), used(0), data_bytes(0),
+          started(false), word_pending(false) {
+        double unit_seconds = 1.2 / options.wpm;
+        unit = static_cast<size_t>(options.sampleRate * unit_seconds + 0.5);
+        letter_gap = 3 * unit;
+        word_gap = 7 * unit;
+
+        // Фарнсворт: знаки передаются со скоростью wpm, а паузы между
+        // знаками и словами растягиваются до общей скорости (ARRL)
+        if (options.farnsworthWpm != 0 && options.farnsworthWpm < options.wpm) {
+            double c = options.wpm, s = options.farnsworthWpm;
+            double delay = (60 * c - 37.2 * s) / (s * c);
+            letter_gap = static_cast<size_t>(options.sampleRate * 3 * delay / 19 + 0.5);
+            word_gap = static_cast<size_t>(options.sampleRate * 7 * delay / 19 + 0.5);
+        }
+
+        dot = renderTone(options, unit);
+        dash = renderTone(options, 3 * unit);
+    }
+
+    void writeText(const char* text, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (isspace(c)) {
+                word_pending = started;
+                continue;
+            }
+            const char* code = MORSE_TABLES.encode[c];
+            if (!code) continue;
+
+            if (started) {
+                appendSilence(word_pending ? word_gap : letter_gap);
+            }
+            for (const char* element = code; *element; ++element) {
+                if (element != code) appendSilence(unit);
+                const vector<uint8_t>& wave = *element == '-' ? dash : dot;
+                appendBytes(wave.data(), wave.size());
+            }
+            started = true;
+            word_pending = false;
+        }
+    }
+
+    // Запись остатка буфера; false — ошибка вывода
+    bool flush() {
+        if (used) {
+            output.write(reinterpret_cast<const char*>(buffer.data()), used);
+            used = 0;
+        }
+        return static_cast<bool>(output);
+    }
+
+    uint64_t dataBytes() const { return data_bytes; }
+
+private:
+    // Тон длиной samples отсчетов; фронты — полупериод косинуса,
+    // чтобы в приемнике не было щелчков
+    static vector<uint8_t> renderTone(const MorseAudioOptions& options, size_t samples) {
+        vector<uint8_t> wave(samples * MORSE_SAMPLE_BYTES);
+        size_t ramp = min(static_cast<size_t>(options.sampleRate * options.rampMs / 1000), samples / 2);
+        double step = 2 * M_PI * options.toneHz / options.sampleRate;
+        for (size_t i = 0; i < samples; ++i) {
+            double envelope = 1.0;
+            size_t edge = min(i, samples - 1 - i);
+            if (edge < ramp) {
+                envelope = 0.5 - 0.5 * cos(M_PI * (edge + 0.5) / ramp);
+            }
+            double value = options.amplitude * envelope * sin(step * i);
+            int16_t sample = static_cast<int16_t>(lround(value * 32767));
+            putLE16(wave.data() + i * MORSE_SAMPLE_BYTES, static_cast<uint16_t>(sample));
+        }
+        return wave;
+    }
+
+    void appendBytes(const uint8_t* data, size_t size) {
+        data_bytes += size;
+        while (size) {
+            size_t part = min(size, buffer.size() - used);
+            memcpy(buffer.data() + used, data, part);
+            used += part;
+            data += part;
+            size -= part;
+            if (used == buffer.size()) flush();
+        }
+    }
+
+    void appendSilence(size_t samples) {
+        size_t size = samples * MORSE_SAMPLE_BYTES;
+        data_bytes += size;
+        while (size) {
+            size_t part = min(size, buffer.size() - used);
+            memset(buffer.data() + used, 0, part);
+            used += part;
+            size -= part;
+            if (used == buffer.size()) flush();
+        }
+    }
+
+    ostream& output;
+    vector<uint8_t> buffer;
+    size_t used;
+    uint64_t data_bytes;
+    size_t unit, letter_gap, word_gap;
+    vector<uint8_t> dot, dash;
+    bool started;
+    bool word_pending;
+};
+
+MorseFileOperationResult encodeStreamToMorseWav(istream &input, ostream &output, const MorseAudioOptions &options) {
+    string error = checkAudioOptions(options);
+    if (!error.empty()) {
+        return {false, error};
+    }
+
+    // Размер данных неизвестен до конца текста: если вывод допускает
+    // позиционирование, заголовок исправляется в конце
+    streampos header_pos = output.tellp();
+    uint8_t header[MORSE_WAV_HEADER_BYTES];
+    buildWavHeader(header, options.sampleRate, MORSE_WAV_UNKNOWN_SIZE);
+    output.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    MorseToneWriter writer(options, output);
+    vector<char> text(MORSE_STREAM_CHUNK);
+    while (input.read(text.data(), text.size()) || input.gcount() > 0) {
+        writer.writeText(text.data(), static_cast<size_t>(input.gcount()));
+        if (!output) {
+            return {false, "Ошибка записи выходных данных"};
+        }
+    }
+    if (input.bad()) {
+        return {false, "Ошибка чтения входных данных"};
+    }
+    if (!writer.flush()) {
+        return {false, "Ошибка записи выходных данных"};
+    }
+
+    if (header_pos != streampos(-1)) {
+        buildWavHeader(header, options.sampleRate, writer.dataBytes());
+        output.seekp(header_pos);
+        output.write(reinterpret_cast<const char*>(header), sizeof(header));
+        output.seekp(0, ios::end);
     }
-    
-    // Добавить место отдельно
-    reverseMap["/"] = ' ';
+    output.flush();
+    if (!output) {
+        return {false, "Ошибка записи выходных данных"};
+    }
+    return {true, "Звуковой файл успешно создан"};
 }
 
-string MorseCode::encodeChar(char c) const {
-    if (c == ' ') {
-        return "/";
+MorseFileOperationResult encodeFileToMorseWav(const string &input_path, const string &output_path,
+                                              const MorseAudioOptions &options) {
+    ifstream input(input_path, ios::binary);
+    if (!input) {
+        return {false, "Невозможно открыть входной файл"};
     }
-    
-    char upperChar = toupper(c);
-    auto it = morseMap.find(upperChar);
-    if (it != morseMap.end()) {
-        return it->second;
+
+    ofstream output(output_path, ios::binary);
+    if (!output) {
+        return {false, "Невозможно открыть выходной файл"};
     }
-    
-    return "";
+
+    return encodeStreamToMorseWav(input, output, options);
 }
 
-string MorseCode::encodeString(const string& text) const {
-    string result;
-    bool firstChar = true;
-    
-    for (char c : text) {
-        string morseChar = encodeChar(c);
-        
-        if (!morseChar.empty()) {
-            if (!firstChar) {
-                result += " ";
-            }
-            result += morseChar;
-            firstChar = false;
-        }
+// ==================== РАСПОЗНАВАНИЕ ЗВУКА (WAV -> текст) ====================
+//
+// Сигнал режется на блоки по 5 мс; для каждого блока вычисляется мощность
+// на частоте тона — тот же бин ДПФ, что дает фильтр Герцеля, но в виде
+// скалярных произведений с заранее вычисленными cos/sin, которые
+// векторизуются. Порог "тон есть" следит за уровнями сигнала и шума,
+// переходы фильтруются гистерезисом. Длительности тонов и пауз (в блоках)
+// классифицируются по адаптивным оценкам: тон длиннее двух точек — тире.
+// Паузы оцениваются отдельно от тонов (фронты и порог укорачивают тоны
+// и удлиняют паузы на один-два блока, на высоких скоростях это заметно):
+// граница "внутри знака/между знаками" — среднее геометрическое их
+// оценок, паузы между словами в 7/3 раза длиннее пауз между знаками (в
+// том числе по Фарнсворту). Начальные уровни и оценки берутся из первой секунды
+// сигнала и первых участков тона, после чего они разбираются заново, —
+// задержка и память ограничены.
+
+const double MORSE_TONE_BLOCK_SECONDS = 0.005;
+const size_t MORSE_WAV_READ_BYTES = 1 << 16;
+// Блоки, по которым оцениваются начальные уровни (1 с)
+const size_t MORSE_LEVEL_WARMUP_BLOCKS = 200;
+// Тоны, по которым оцениваются начальные длительности
+const size_t MORSE_TIMING_WARMUP_TONES = 16;
+// Скорость подстройки оценок длительностей
+const double MORSE_TIMING_ADAPT = 0.25;
+// Тон короче этой доли точки считается помехой
+const double MORSE_GLITCH_FRACTION = 0.3;
+// Постоянные времени слежения за уровнями, с. Уровень тона
+// уточняется только во время тона, шума — только в паузах; медленный
+// спад пика в паузах нужен, если сигнал ослаб ниже порога.
+const double MORSE_LEVEL_SECONDS = 0.2;
+const double MORSE_PEAK_DECAY_SECONDS = 10.0;
+// Тон не ищется, пока сигнал не превышает шум во столько раз
+const double MORSE_MIN_SNR = 4.0;
+const size_t MORSE_MAX_CODE_LENGTH = 8;
+
+// Мощность блока на частоте тона (без нормировки)
+typedef float (*MorseToneFunc)(const int16_t* samples, size_t count, const float* cos_table, const float* sin_table);
+
+static float toneMagnitudeScalar(const int16_t* samples, size_t count, const float* cos_table, const float* sin_table) {
+    float re = 0, im = 0;
+    for (size_t i = 0; i < count; ++i) {
+        re += samples[i] * cos_table[i];
+        im += samples[i] * sin_table[i];
     }
-    
-    return result;
+    return re * re + im * im;
 }
 
-char MorseCode::decodeChar(const string& morse) const {
-    // Сначала проверьте наличие места
-    if (morse == "/") {
-        return ' ';
+__attribute__((target("avx2,fma")))
+static float toneMagnitudeAVX2(const int16_t* samples, size_t count, const float* cos_table, const float* sin_table) {
+    __m256 re = _mm256_setzero_ps(), im = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(raw));
+        re = _mm256_fmadd_ps(x, _mm256_loadu_ps(cos_table + i), re);
+        im = _mm256_fmadd_ps(x, _mm256_loadu_ps(sin_table + i), im);
     }
-    
-    auto it = reverseMap.find(morse);
-    if (it != reverseMap.end()) {
-        return it->second;
+    alignas(32) float re_parts[8], im_parts[8];
+    _mm256_store_ps(re_parts, re);
+    _mm256_store_ps(im_parts, im);
+    float re_sum = 0, im_sum = 0;
+    for (int k = 0; k < 8; ++k) {
+        re_sum += re_parts[k];
+        im_sum += im_parts[k];
     }
-    
-    return '?';
+    for (; i < count; ++i) {
+        re_sum += samples[i] * cos_table[i];
+        im_sum += samples[i] * sin_table[i];
+    }
+    return re_sum * re_sum + im_sum * im_sum;
 }
 
-string MorseCode::decodeString(const string& morse) const {
-    string result;
-    string token;
-    
-    // Разобрать строку кода Морзе
-    for (size_t i = 0; i < morse.length(); i++) {
-        char c = morse[i];
-        
-        if (c == ' ') {
-            // Конец символа Морзе
-            if (!token.empty()) {
-                char decoded = decodeChar(token);
-                result += decoded;
-                token.clear();
-            }
-        } else {
-            token += c;
-        }
-    }
-    
-    // Обработать последний токен
-    if (!token.empty()) {
-        char decoded = decodeChar(token);
-        result += decoded;
+static MorseToneFunc morseToneMagnitude = toneMagnitudeScalar;
+
+// Выбор при загрузке библиотеки, дальше указатель только читается
+__attribute__((constructor))
+static void selectMorseToneKernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        morseToneMagnitude = toneMagnitudeAVX2;
     }
-    
-    return result;
 }
 
-bool MorseCode::isSupported(char c) const {
-    if (c == ' ') return true;
-    char upperChar = toupper(c);
-    return morseMap.find(upperChar) != morseMap.end();
-}
+// Формат из блока "fmt "
+struct MorseWavFormat {
+    unsigned channels = 0;
+    unsigned sampleRate = 0;
+    unsigned bitsPerSample = 0;
+    unsigned blockAlign = 0;
+};
 
-void MorseCode::printSupportedChars() const {
-    cout << "=== ПОДДЕРЖИВАЕМЫЕ СИМВОЛЫ ===" << endl;
-    cout << "Буквы: ABCDEFGHIJKLMNOPQRSTUVWXYZ" << endl;
-    cout << "Числа: 0123456789" << endl;
-    cout << "спец символы: . , ? ! @ /" << endl;
-    cout << "Пробел: /" << endl;
+static uint16_t getLE16(const uint8_t* in) {
+    return static_cast<uint16_t>(in[0] | (in[1] << 8));
 }
 
-void MorseCode::runDemo() const {
-    cout << "=== КОД МОРЗЕ ДЕМОНСТРАЦИОННЫЙ ===" << endl;
-    
-    // Проверка конкретных случаев
-    vector<pair<string, string>> tests = {
-        {"SOS", "... --- ..."},
-        {"HELLO", ".... . .-.. .-.. ---"},
-        {"WORLD", ".-- --- .-. .-.. -.."},
-        {"123", ".---- ..--- ...--"},
-        {"I LOVE YOU", ".. / .-.. --- ...- . / -.-- --- ..-"},
-        {"HELLO WORLD", ".... . .-.. .-.. --- / .-- --- .-. .-.. -.."}
-    };
-    
-    for (const auto& test : tests) {
-        cout << "\nTest: " << test.first << endl;
-        cout << "Ожидаемый Морзе: " << test.second << endl;
-        
-        // Кодировать
-        string encoded = encodeString(test.first);
-        cout << "Кодировать: " << encoded << endl;
-        
-        // Декрдировать 
-        string decoded = decodeString(test.second);
-        cout << "Декодировать: " << decoded << endl;
-        
-        bool encodeOk = (encoded == test.second);
-        bool decodeOk = (decoded == test.first);
-        
-        cout << "Кодировать: " << (encodeOk ? "OK" : "FAIL") << endl;
-        cout << "Декодировать: " << (decodeOk ? "OK" : "FAIL") << endl;
+// Разбор заголовка до начала блока "data"; data_bytes — его размер
+// (MORSE_WAV_UNKNOWN_SIZE или 0 — до конца потока)
+static string readWavHeader(istream& input, MorseWavFormat& format, uint64_t& data_bytes) {
+    uint8_t riff[12];
+    if (!input.read(reinterpret_cast<char*>(riff), sizeof(riff)) ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        return "Входные данные не являются WAV-файлом";
     }
-}
 
-// ==================== БИНАРНОЕ КОДИРОВАНИЕ ====================
+    uint8_t chunk[8];
+    while (input.read(reinterpret_cast<char*>(chunk), sizeof(chunk))) {
+        uint32_t size = getLE32(chunk + 4);
+        if (memcmp(chunk, "data", 4) == 0) {
+            if (format.sampleRate == 0) {
+                return "Блок data встретился раньше блока fmt";
+            }
+            data_bytes = size;
+            return "";
+        }
 
-static const map<unsigned char, string> nibble_to_morse = {
-    {0x0, "."},    {0x1, "-"},    {0x2, ".."},   {0x3, ".-"},
-    {0x4, "-."},   {0x5, "--"},   {0x6, "..."},  {0x7, "..-"},
-    {0x8, ".-."},  {0x9, ".--"},  {0xA, "-.."},  {0xB, "-.-"},
-    {0xC, "--."},  {0xD, "---"},  {0xE, "...."}, {0xF, "...-"}
-};
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (size < 16 || size > 1024) {
+                return "Некорректный блок fmt";
+            }
+            vector<uint8_t> fmt(size);
+            if (!input.read(reinterpret_cast<char*>(fmt.data()), size)) break;
+            unsigned tag = getLE16(fmt.data());
+            format.channels = getLE16(fmt.data() + 2);
+            format.sampleRate = getLE32(fmt.data() + 4);
+            format.blockAlign = getLE16(fmt.data() + 12);
+            format.bitsPerSample = getLE16(fmt.data() + 14);
+            // 0xFFFE — WAVE_FORMAT_EXTENSIBLE, подформат не проверяется
+            if ((tag != 1 && tag != 0xFFFE) || format.bitsPerSample != 16 || format.channels == 0 ||
+                format.blockAlign != format.channels * MORSE_SAMPLE_BYTES) {
+                return "Поддерживается только PCM 16 бит";
+            }
+            if (format.sampleRate < 1000 || format.sampleRate > 384000) {
+                return "Некорректная частота дискретизации";
+            }
+            if (size % 2) input.ignore(1);
+        } else {
+            // Прочие блоки пропускаются (с выравниванием до четного размера)
+            input.ignore(static_cast<streamsize>(size) + (size % 2));
+        }
+    }
+    return "Неожиданный конец WAV-заголовка";
+}
 
-static map<string, unsigned char> morse_to_nibble;
-static bool nibble_map_initialized = false;
+// Участок "тон" или "пауза" длиной в блоках
+struct MorseToneRun {
+    bool tone;
+    size_t length;
+};
 
-static void init_nibble_map() {
-    if (!nibble_map_initialized) {
-        for (const auto& pair : nibble_to_morse) {
-            morse_to_nibble[pair.second] = pair.first;
+// Разбор последовательности "тон/пауза" в текст
+class MorseToneDecoder {
+public:
+    MorseToneDecoder(const MorseAudioOptions& options, unsigned sample_rate)
+        : block(max<size_t>(8, static_cast<size_t>(sample_rate * MORSE_TONE_BLOCK_SECONDS + 0.5))),
+          cos_table(block), sin_table(block), filled(0), pending(block),
+          peak(0), floor(0), levels_ready(false), in_tone(false), run(0),
+          timing_ready(false), warm_tones(0), pending_gap(0), started(false), code_length(0) {
+        for (size_t i = 0; i < block; ++i) {
+            double phase = 2 * M_PI * options.toneHz * i / sample_rate;
+            cos_table[i] = static_cast<float>(cos(phase));
+            sin_table[i] = static_cast<float>(sin(phase));
         }
-        nibble_map_initialized = true;
+        double block_seconds = double(block) / sample_rate;
+        level_adapt = block_seconds / MORSE_LEVEL_SECONDS;
+        peak_decay = block_seconds / MORSE_PEAK_DECAY_SECONDS;
+        dot_hint = max(1.0, 1.2 / options.wpm / block_seconds);
+        dot = dot_hint;
+        dash = 3 * dot;
+        element_gap = dot;
+        letter_gap = 3 * dot;
     }
-}
 
-const string DOT_BITS = "1";
-const string DASH_BITS = "111";
-const string ELEMENT_GAP = "0";
-const string PART_GAP = "000";
-const string BYTE_GAP = "0000000";
+    void feed(const int16_t* samples, size_t count, string& out) {
+        // Незавершенный блок с прошлого вызова
+        if (filled) {
+            size_t part = min(count, block - filled);
+            memcpy(pending.data() + filled, samples, part * sizeof(int16_t));
+            filled += part;
+            samples += part;
+            count -= part;
+            if (filled < block) return;
+            processBlock(pending.data(), out);
+            filled = 0;
+        }
+        for (; count >= block; samples += block, count -= block) {
+            processBlock(samples, out);
+        }
+        memcpy(pending.data(), samples, count * sizeof(int16_t));
+        filled = count;
+    }
 
-string morse_to_bits(const string& morse) {
-    string bits;
-    for (size_t i = 0; i < morse.length(); ++i) {
-        bits += (morse[i] == '.') ? DOT_BITS : DASH_BITS;
-        if (i < morse.length() - 1) {
-            bits += ELEMENT_GAP;
+    void finish(string& out) {
+        if (!levels_ready) {
+            startLevels(out);
+        }
+        if (run) {
+            onRun(MorseToneRun{in_tone, run}, out);
         }
+        if (!timing_ready) {
+            startTiming(out);
+        }
+        flushChar(out);
     }
-    return bits;
-}
 
-MorseEncodedResult encodeTextToMorse(const string &text) {
-    MorseEncodedResult result;
-    string bit_string;
+private:
+    void processBlock(const int16_t* samples, string& out) {
+        float magnitude = sqrt(morseToneMagnitude(samples, block, cos_table.data(), sin_table.data())) / block;
+        if (levels_ready) {
+            detectTone(magnitude, out);
+            return;
+        }
+        warm_levels.push_back(magnitude);
+        if (warm_levels.size() == MORSE_LEVEL_WARMUP_BLOCKS) {
+            startLevels(out);
+        }
+    }
 
-    for (size_t i = 0; i < text.length(); ++i) {
-        unsigned char byte = text[i];
-        unsigned char high = (byte >> 4) & 0x0F;
-        unsigned char low = byte & 0x0F;
+    // Начальные уровни — процентили первой секунды (минимум и максимум
+    // шума слишком случайны), затем эти блоки разбираются заново
+    void startLevels(string& out) {
+        levels_ready = true;
+        if (warm_levels.empty()) return;
+        vector<float> sorted(warm_levels);
+        sort(sorted.begin(), sorted.end());
+        floor = sorted[sorted.size() / 5];
+        peak = sorted[sorted.size() * 19 / 20];
+        for (float magnitude : warm_levels) {
+            detectTone(magnitude, out);
+        }
+        warm_levels = vector<float>();
+    }
 
-        bit_string += morse_to_bits(nibble_to_morse.at(high));
-        bit_string += PART_GAP;
-        bit_string += morse_to_bits(nibble_to_morse.at(low));
+    void detectTone(float magnitude, string& out) {
+        if (in_tone) {
+            peak = max<double>(magnitude, peak + (magnitude - peak) * level_adapt);
+        } else {
+            floor += (magnitude - floor) * level_adapt;
+            peak = max<double>(magnitude, peak - peak * peak_decay);
+        }
 
-        if (i < text.length() - 1) {
-            bit_string += BYTE_GAP;
+        bool tone = false;
+        if (peak > floor * MORSE_MIN_SNR) {
+            double span = peak - floor;
+            tone = magnitude > floor + (in_tone ? 0.4 : 0.6) * span;
+        }
+        if (tone != in_tone && run) {
+            onRun(MorseToneRun{in_tone, run}, out);
+            run = 0;
         }
+        in_tone = tone;
+        ++run;
     }
 
-    vector<unsigned char> packed;
-    uint64_t total_bits = bit_string.length();
-    
-    packed.resize(sizeof(total_bits));
-    memcpy(packed.data(), &total_bits, sizeof(total_bits));
+    void onRun(const MorseToneRun& piece, string& out) {
+        if (timing_ready) {
+            handleRun(piece, out);
+            return;
+        }
+        warm_runs.push_back(piece);
+        if (piece.tone && ++warm_tones == MORSE_TIMING_WARMUP_TONES) {
+            startTiming(out);
+        }
+    }
 
-    unsigned char current = 0;
-    int bit_count = 0;
-    for (char bit : bit_string) {
-        current = (current << 1) | (bit - '0');
-        bit_count++;
-        if (bit_count == 8) {
-            packed.push_back(current);
-            bit_count = 0;
+    // Значения по двум кластерам: если наибольшее не меньше ratio
+    // наименьших, граница — среднее геометрическое, возвращается
+    // среднее нижнего кластера; иначе -1 (все значения одного типа)
+    static double lowerCluster(const vector<double>& values, double ratio) {
+        double low = *min_element(values.begin(), values.end());
+        double high = *max_element(values.begin(), values.end());
+        if (high < ratio * low) return -1;
+        double border = sqrt(low * high), sum = 0;
+        size_t count = 0;
+        for (double value : values) {
+            if (value < border) {
+                sum += value;
+                ++count;
+            }
         }
+        return sum / count;
     }
-    if (bit_count > 0) {
-        current <<= (8 - bit_count);
-        packed.push_back(current);
+
+    // Начальные длительности по первым участкам, затем они разбираются заново
+    void startTiming(string& out) {
+        timing_ready = true;
+        vector<double> tones;
+        for (const MorseToneRun& piece : warm_runs) {
+            if (piece.tone && piece.length > 1) tones.push_back(double(piece.length));
+        }
+        if (!tones.empty()) {
+            double shortest = lowerCluster(tones, 2.0);
+            if (shortest < 0) {
+                // Одни точки или одни тире: выбор по ожидаемой скорости
+                double mean = accumulate(tones.begin(), tones.end(), 0.0) / tones.size();
+                shortest = mean > 2 * dot_hint ? mean / 3 : mean;
+            }
+            dot = shortest;
+            dash = 3 * dot;
+            double sum = 0;
+            size_t count = 0;
+            for (double tone : tones) {
+                if (tone > 2 * dot) {
+                    sum += tone;
+                    ++count;
+                }
+            }
+            if (count) dash = min(4 * dot, sum / count);
+        }
+
+        // Паузы между тонами: самые короткие — внутри знака (если они
+        // не длиннее двух точек с запасом на искажение фронтами)
+        vector<double> gaps;
+        bool tone_seen = false;
+        for (const MorseToneRun& piece : warm_runs) {
+            if (!piece.tone && tone_seen) gaps.push_back(double(piece.length));
+            tone_seen = tone_seen || piece.tone;
+        }
+        element_gap = dot;
+        if (!gaps.empty()) {
+            double shortest = *min_element(gaps.begin(), gaps.end());
+            double sum = 0;
+            size_t count = 0;
+            for (double gap : gaps) {
+                if (gap < 2 * shortest) {
+                    sum += gap;
+                    ++count;
+                }
+            }
+            if (sum / count <= 2 * dot + 2) element_gap = sum / count;
+        }
+
+        vector<double> letter_gaps;
+        for (double gap : gaps) {
+            if (gap >= 2 * element_gap) letter_gaps.push_back(gap);
+        }
+        letter_gap = 3 * element_gap;
+        if (!letter_gaps.empty()) {
+            double letters = lowerCluster(letter_gaps, 1.8);
+            // Паузы одного типа считаются паузами между знаками
+            letter_gap = letters > 0 ? letters
+                                     : accumulate(letter_gaps.begin(), letter_gaps.end(), 0.0) / letter_gaps.size();
+        }
+
+        for (const MorseToneRun& piece : warm_runs) {
+            handleRun(piece, out);
+        }
+        warm_runs = vector<MorseToneRun>();
     }
 
-    result.binary_data = packed;
-    result.success = true;
-    return result;
-}
+    void handleRun(const MorseToneRun& piece, string& out) {
+        double length = double(piece.length);
+        // Паузы до первого тона не имеют значения; короткий тон — помеха,
+        // он присоединяется к паузе, в которую попал
+        if (!piece.tone || length < dot * MORSE_GLITCH_FRACTION) {
+            pending_gap += piece.length;
+            return;
+        }
 
-MorseDecodedResult decodeTextFromMorse(const vector<unsigned char> &data) {
-    MorseDecodedResult result;
-    init_nibble_map();
+        if (started) {
+            classifyGap(double(pending_gap), out);
+        }
+        pending_gap = 0;
+        started = true;
 
-    if (data.size() < sizeof(uint64_t)) {
-        result.success = false;
-        result.error_message = "Данные слишком короткие";
-        return result;
+        // Точки и тире отслеживаются раздельно, граница — среднее
+        // геометрическое. Отношение тире к точке удерживается в [2, 4]
+        // за счет оценки, не обновленной сейчас: иначе при смене скорости
+        // новые тире могли бы навсегда остаться "точками"
+        bool is_dash = length > sqrt(dot * dash);
+        if (is_dash) {
+            dash += (length - dash) * MORSE_TIMING_ADAPT;
+            dot = clamp(dot, dash / 4, dash / 2);
+        } else {
+            dot += (length - dot) * MORSE_TIMING_ADAPT;
+            dash = clamp(dash, 2 * dot, 4 * dot);
+        }
+        if (code_length < MORSE_MAX_CODE_LENGTH) {
+            code[code_length] = is_dash ? '-' : '.';
+        }
+        ++code_length;
     }
 
-    uint64_t total_bits;
-    memcpy(&total_bits, data.data(), sizeof(total_bits));
+    void classifyGap(double length, string& out) {
+        if (length < sqrt(element_gap * letter_gap)) {
+            element_gap += (length - element_gap) * MORSE_TIMING_ADAPT;
+            element_gap = min(element_gap, letter_gap / 2);
+            return;
+        }
 
-    string bit_string;
-    for (size_t i = sizeof(total_bits); i < data.size(); ++i) {
-        for (int j = 7; j >= 0; --j) {
-            bit_string += ((data[i] >> j) & 1) ? '1' : '0';
+        // Граница "знак/слово" — посередине между 3 и 7 единицами паузы
+        // Паузы много длиннее слова (оператор замолчал) длительности не меняют
+        bool word = length > letter_gap * 5 / 3;
+        if (length < letter_gap * 14 / 3) {
+            letter_gap += ((word ? length * 3 / 7 : length) - letter_gap) * MORSE_TIMING_ADAPT;
+            letter_gap = max(letter_gap, 2 * element_gap);
         }
+        flushChar(out);
+        if (word) out += ' ';
     }
-    if (bit_string.length() > total_bits) {
-        bit_string.resize(total_bits);
+
+    void flushChar(string& out) {
+        if (code_length == 0) return;
+        char symbol = code_length <= MORSE_MAX_CODE_LENGTH ? morse.decodeChar(string_view(code, code_length)) : '?';
+        out += symbol;
+        code_length = 0;
     }
-    
-    string text_result;
-    string current_morse;
-    unsigned char current_byte = 0;
-    bool high_nibble = true;
 
-    for (size_t i = 0; i < bit_string.length(); ) {
-        size_t gap = bit_string.find('0', i);
-        if (gap == string::npos) {
-            gap = bit_string.length();
-        }
+    size_t block;
+    vector<float> cos_table, sin_table;
+    size_t filled;
+    vector<int16_t> pending;
+    // Уровни сигнала и шума
+    double level_adapt, peak_decay;
+    double peak, floor;
+    bool levels_ready;
+    vector<float> warm_levels;
+    // Текущий участок
+    bool in_tone;
+    size_t run;
+    // Длительности
+    double dot_hint, dot, dash, element_gap, letter_gap;
+    bool timing_ready;
+    vector<MorseToneRun> warm_runs;
+    size_t warm_tones;
+    size_t pending_gap;    // пауза перед следующим тоном (с учетом помех)
+    // Текущий знак
+    bool started;
+    char code[MORSE_MAX_CODE_LENGTH];
+    size_t code_length;
+    MorseCode morse;
+};
 
-        string element = bit_string.substr(i, gap - i);
-        if (element == DOT_BITS) current_morse += '.';
-        else if (element == DASH_BITS) current_morse += '-';
+MorseFileOperationResult decodeStreamFromMorseWav(istream &input, ostream &output, const MorseAudioOptions &options) {
+    if (!(options.wpm >= 1 && options.wpm <= 200) || !(options.toneHz > 0)) {
+        return {false, "Некорректные параметры сигнала"};
+    }
 
-        i = gap;
-        
-        size_t zeros = 0;
-        while(i < bit_string.length() && bit_string[i] == '0') {
-            zeros++;
-            i++;
-        }
-
-        if (zeros >= 3 || i >= bit_string.length()) {
-            if (morse_to_nibble.count(current_morse)) {
-                unsigned char nibble = morse_to_nibble.at(current_morse);
-                if (high_nibble) {
-                    current_byte = (nibble << 4);
-                    high_nibble = false;
-                } else {
-                    current_byte |= nibble;
-                    text_result += static_cast<char>(current_byte);
-                    high_nibble = true;
-                }
-            }
-            current_morse.clear();
+    MorseWavFormat format;
+    uint64_t data_left = 0;
+    string error = readWavHeader(input, format, data_left);
+    if (!error.empty()) {
+        return {false, error};
+    }
+    if (data_left == 0 || data_left == MORSE_WAV_UNKNOWN_SIZE) {
+        data_left = UINT64_MAX;
+    }
+    if (options.toneHz >= format.sampleRate / 2.0) {
+        return {false, "Частота тона выше половины частоты дискретизации"};
+    }
+
+    MorseToneDecoder decoder(options, format.sampleRate);
+    vector<uint8_t> raw(MORSE_WAV_READ_BYTES - MORSE_WAV_READ_BYTES % format.blockAlign);
+    vector<int16_t> samples(raw.size() / format.blockAlign);
+    size_t carried = 0;   // байты неполного кадра с прошлого чтения
+    string text;
+
+    while (data_left > 0) {
+        size_t want = static_cast<size_t>(min<uint64_t>(raw.size() - carried, data_left));
+        input.read(reinterpret_cast<char*>(raw.data() + carried), want);
+        size_t got = static_cast<size_t>(input.gcount());
+        if (got == 0) break;
+        data_left -= got;
+        size_t bytes = carried + got;
+
+        // Берется первый канал
+        size_t frames = bytes / format.blockAlign;
+        for (size_t i = 0; i < frames; ++i) {
+            samples[i] = static_cast<int16_t>(getLE16(raw.data() + i * format.blockAlign));
+        }
+        carried = bytes - frames * format.blockAlign;
+        memmove(raw.data(), raw.data() + frames * format.blockAlign, carried);
+
+        decoder.feed(samples.data(), frames, text);
+        if (!text.empty()) {
+            output.write(text.data(), text.size());
+            text.clear();
         }
     }
+    if (input.bad()) {
+        return {false, "Ошибка чтения входных данных"};
+    }
 
-    result.plaintext = text_result;
-    result.success = true;
-    return result;
+    decoder.finish(text);
+    output.write(text.data(), text.size());
+    output.flush();
+    if (!output) {
+        return {false, "Ошибка записи выходных данных"};
+    }
+    return {true, "Звуковой файл успешно распознан"};
 }
 
-MorseFileOperationResult encodeFileToMorse(const string &input_path, const string &output_path) {
+MorseFileOperationResult decodeFileFromMorseWav(const string &input_path, const string &output_path,
+                                                const MorseAudioOptions &options) {
     ifstream input(input_path, ios::binary);
     if (!input) {
-        return {false, "Невозможно открыть выходной файл"};
+        return {false, "Невозможно открыть входной файл"};
     }
-    
-    string content((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
-    input.close();
-
-    MorseEncodedResult encoded = encodeTextToMorse(content);
 
     ofstream output(output_path, ios::binary);
     if (!output) {
         return {false, "Невозможно открыть выходной файл"};
     }
 
-    output.write(reinterpret_cast<const char*>(encoded.binary_data.data()), encoded.binary_data.size());
-    output.close();
-    
-    return {true, "Файл успешно закодирован"};
+    return decodeStreamFromMorseWav(input, output, options);
 }
 
-MorseFileOperationResult decodeFileFromMorse(const string &input_path, const string &output_path) {
-    ifstream input(input_path, ios::binary);
-    if (!input) {
-        return {false, "Невозможно открыть входной файл"};
-    }
+// ==================== ИНТЕРФЕЙС МОДУЛЯ (crypto_plugin.h) ====================
+//
+// Ключ не нужен (контекст — NULL). encrypt — формат с общим заголовком
+// длины (как encodeTextToMorse), код пишется прямо в буфер вызывающей
+// стороны; decrypt распознает все бинарные форматы.
+
+static int morsePluginInit(const uint8_t*, size_t, void** context) {
+    if (!context) return CRYPTO_PLUGIN_ERR_ARGUMENT;
+    *context = nullptr;
+    return CRYPTO_PLUGIN_OK;
+}
 
-    vector<unsigned char> content((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
-    input.close();
+static size_t morsePluginMaxOutput(void*, int operation, size_t inputLen) {
+    // Полубайт занимает не меньше четырех бит кода, поэтому декодированный
+    // текст не длиннее входа (плюс незавершенный хвост)
+    if (operation == CRYPTO_PLUGIN_DECRYPT) return inputLen + 1;
+    return sizeof(uint64_t) + inputLen * sizeof(uint32_t);
+}
 
-    MorseDecodedResult decoded = decodeTextFromMorse(content);
-    if (!decoded.success) {
-        return {false, decoded.error_message};
-    }
+static int morsePluginEncrypt(void*, const uint8_t* in, size_t inLen,
+                              uint8_t* out, size_t outCapacity, size_t* outLen) {
+    if (!outLen || (!in && inLen > 0)) return CRYPTO_PLUGIN_ERR_ARGUMENT;
+    MetricTimer timer(encodeMetric, inLen);
+    uint64_t total_bits = morseBitLength(in, inLen);
+    *outLen = sizeof(total_bits) + (total_bits + 7) / 8;
+    if (*outLen > outCapacity) return CRYPTO_PLUGIN_ERR_BUFFER;
+    memcpy(out, &total_bits, sizeof(total_bits));
+    encodeMorseBits(in, inLen, out + sizeof(total_bits));
+    return CRYPTO_PLUGIN_OK;
+}
 
-    ofstream output(output_path, ios::binary);
-    if (!output) {
-        return {false, "Не могу открыть выходной файл"};
+static int morsePluginDecrypt(void*, const uint8_t* in, size_t inLen,
+                              uint8_t* out, size_t outCapacity, size_t* outLen) {
+    if (!outLen || (!in && inLen > 0)) return CRYPTO_PLUGIN_ERR_ARGUMENT;
+    try {
+        MorseDecodedResult result = decodeTextFromMorse(vector<unsigned char>(in, in + inLen));
+        if (!result.success) return CRYPTO_PLUGIN_ERR_DATA;
+        *outLen = result.plaintext.size();
+        if (*outLen > outCapacity) return CRYPTO_PLUGIN_ERR_BUFFER;
+        memcpy(out, result.plaintext.data(), *outLen);
+        return CRYPTO_PLUGIN_OK;
+    } catch (const exception&) {
+        return CRYPTO_PLUGIN_ERR_INTERNAL;
     }
+}
 
-    output << decoded.plaintext;
-    output.close();
-
-    return {true, "Файл успешно декодирован"};
+static void morsePluginFree(void*) {
 }
 
+static const CryptoPluginDescriptor MORSE_PLUGIN_DESCRIPTOR = {
+    CRYPTO_PLUGIN_ABI_VERSION,
+    sizeof(CryptoPluginDescriptor),
+    "morse",
+    "Бинарный код Морзе (кодирование без ключа)",
+    nullptr,
+    CRYPTO_PLUGIN_CAP_ENCRYPT | CRYPTO_PLUGIN_CAP_DECRYPT | CRYPTO_PLUGIN_CAP_THREAD_SAFE,
+    morsePluginInit,
+    morsePluginMaxOutput,
+    morsePluginEncrypt,
+    morsePluginDecrypt,
+    morsePluginFree,
+};
+
 // ==================== C-ИНТЕРФЕЙС ДЛЯ БИБЛИОТЕКИ ====================
 
 extern "C" {
@@ -416,19 +2229,21 @@ void run_morse_demo() {
         cout << "3. Показать поддерживаемые символы" << endl;
         cout << "4. Бинарное кодирование файла" << endl;
         cout << "5. Бинарное декодирование файла" << endl;
+        cout << "6. Бинарное кодирование файла (кадровый формат)" << endl;
+        cout << "7. Озвучить текстовый файл (WAV)" << endl;
+        cout << "8. Распознать звуковой файл (WAV)" << endl;
+        cout << "9. Бинарное кодирование файла (коды по частотам)" << endl;
         cout << "Выберите действие: ";
         cin >> choice;
         cin.ignore();
         
-        MorseCode morseInstance;
-        
         switch (choice) {
             case 1: {
                 string text;
                 cout << "Введите текст для кодирования: ";
                 getline(cin, text);
                 
-                string encoded = morseInstance.encodeString(text);
+                string encoded = morse.encodeString(text);
                 cout << "Закодированный текст: " << encoded << endl;
                 break;
             }
@@ -438,13 +2253,13 @@ void run_morse_demo() {
                 cout << "Введите код Морзе для декодирования: ";
                 getline(cin, morseCode);
                 
-                string decoded = morseInstance.decodeString(morseCode);
+                string decoded = morse.decodeString(morseCode);
                 cout << "Декодированный текст: " << decoded << endl;
                 break;
             }
                 
             case 3:
-                morseInstance.printSupportedChars();
+                morse.printSupportedChars();
                 break;
                 
             case 4: {
@@ -470,6 +2285,67 @@ void run_morse_demo() {
                 cout << (result.success ? "✓ Успех: " : "✗ Ошибка: ") << result.message << endl;
                 break;
             }
+
+            case 6: {
+                string inputFile, outputFile;
+                cout << "Введите имя входного файла: ";
+                getline(cin, inputFile);
+                cout << "Введите имя выходного файла: ";
+                getline(cin, outputFile);
+
+                MorseFileOperationResult result = encodeFileToMorseFramed(inputFile, outputFile);
+                cout << (result.success ? "✓ Успех: " : "✗ Ошибка: ") << result.message << endl;
+                break;
+            }
+
+            case 7: {
+                string inputFile, outputFile;
+                MorseAudioOptions options;
+                cout << "Введите имя текстового файла: ";
+                getline(cin, inputFile);
+                cout << "Введите имя WAV-файла: ";
+                getline(cin, outputFile);
+                cout << "Скорость, слов/мин (" << options.wpm << "): ";
+                string line;
+                getline(cin, line);
+                if (!line.empty()) options.wpm = atof(line.c_str());
+                cout << "Частота тона, Гц (" << options.toneHz << "): ";
+                getline(cin, line);
+                if (!line.empty()) options.toneHz = atof(line.c_str());
+
+                MorseFileOperationResult result = encodeFileToMorseWav(inputFile, outputFile, options);
+                cout << (result.success ? "✓ Успех: " : "✗ Ошибка: ") << result.message << endl;
+                break;
+            }
+
+            case 8: {
+                string inputFile, outputFile;
+                MorseAudioOptions options;
+                cout << "Введите имя WAV-файла: ";
+                getline(cin, inputFile);
+                cout << "Введите имя текстового файла: ";
+                getline(cin, outputFile);
+                cout << "Частота тона, Гц (" << options.toneHz << "): ";
+                string line;
+                getline(cin, line);
+                if (!line.empty()) options.toneHz = atof(line.c_str());
+
+                MorseFileOperationResult result = decodeFileFromMorseWav(inputFile, outputFile, options);
+                cout << (result.success ? "✓ Успех: " : "✗ Ошибка: ") << result.message << endl;
+                break;
+            }
+
+            case 9: {
+                string inputFile, outputFile;
+                cout << "Введите имя входного файла: ";
+                getline(cin, inputFile);
+                cout << "Введите имя выходного файла: ";
+                getline(cin, outputFile);
+
+                MorseFileOperationResult result = encodeFileToMorseAdaptive(inputFile, outputFile);
+                cout << (result.success ? "✓ Успех: " : "✗ Ошибка: ") << result.message << endl;
+                break;
+            }
                 
             case 0:
                 cout << "Выход из режима Морзе." << endl;
@@ -481,4 +2357,89 @@ void run_morse_demo() {
     } while (choice != 0);
 }
 
-} // extern "C"
\ No newline at end of file
+const CryptoPluginDescriptor* crypto_plugin_descriptor() {
+    return &MORSE_PLUGIN_DESCRIPTOR;
+}
+
+// Режим фильтра: crypto_system filter morse <режим>, stdin -> stdout.
+// encode — кадровый бинарный формат, encode-raw — формат с общим
+// заголовком длины, encode-adaptive — коды по частотам (stdin должен
+// быть файлом: он читается дважды), decode распознает все три; text-encode/text-decode —
+// текстовый код Морзе построчно; wav [слов/мин [Гц [общая скорость]]] —
+// звуковой сигнал, wav-decode [Гц [слов/мин]] — его распознавание.
+// Сообщения выводятся только в stderr.
+int run_morse_filter(int argc, char* argv[]) {
+    bool wav = argc >= 1 && string(argv[0]) == "wav";
+    bool wav_decode = argc >= 1 && string(argv[0]) == "wav-decode";
+    if (argc < 1 || (wav ? argc > 4 : wav_decode ? argc > 3 : argc != 1)) {
+        cerr << "Использование: filter morse encode|encode-raw|encode-adaptive|decode|text-encode|text-decode|"
+             << "wav [слов/мин [Гц [общая скорость]]]|wav-decode [Гц [слов/мин]]" << endl;
+        return 2;
+    }
+
+    string mode = argv[0];
+    if (wav_decode) {
+        MorseAudioOptions options;
+        if (argc > 1) options.toneHz = atof(argv[1]);
+        if (argc > 2) options.wpm = atof(argv[2]);
+        MorseFileOperationResult result = decodeStreamFromMorseWav(cin, cout, options);
+        if (!result.success) {
+            cerr << "Ошибка: " << result.message << endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (wav) {
+        MorseAudioOptions options;
+        if (argc > 1) options.wpm = atof(argv[1]);
+        if (argc > 2) options.toneHz = atof(argv[2]);
+        if (argc > 3) options.farnsworthWpm = atof(argv[3]);
+        MorseFileOperationResult result = encodeStreamToMorseWav(cin, cout, options);
+        if (!result.success) {
+            cerr << "Ошибка: " << result.message << endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (mode == "text-encode" || mode == "text-decode") {
+        // Строка и результат переиспользуются: память выделяется только
+        // при росте длины строки
+        MorseCode morse;
+        bool encode = mode == "text-encode";
+        string line, converted;
+        while (getline(cin, line)) {
+            converted.resize(encode ? morse.encodedLength(line) : morse.decodedLength(line));
+            if (encode) {
+                morse.encodeString(string_view(line), converted.data());
+            } else {
+                morse.decodeString(string_view(line), converted.data());
+            }
+            converted += '\n';
+            cout << converted;
+        }
+        cout.flush();
+        return cout ? 0 : 1;
+    }
+
+    MorseFileOperationResult result;
+    if (mode == "encode") {
+        result = encodeStreamToMorseFramed(cin, cout);
+    } else if (mode == "encode-raw") {
+        result = encodeStreamToMorse(cin, cout);
+    } else if (mode == "encode-adaptive") {
+        result = encodeStreamToMorseAdaptive(cin, cout);
+    } else if (mode == "decode") {
+        result = decodeStreamFromMorse(cin, cout);
+    } else {
+        cerr << "Неизвестный режим: " << mode << endl;
+        return 2;
+    }
+
+    if (!result.success) {
+        cerr << "Ошибка: " << result.message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,218 @@
+#include "../include/plugin_registry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <elf.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static bool read_at(ifstream& file, uint64_t offset, void* buffer, size_t size) {
+    file.seekg(static_cast<streamoff>(offset));
+    return static_cast<bool>(file.read(static_cast<char*>(buffer), size));
+}
+
+// Диапазон [offset, offset + size) целиком лежит в файле
+static bool within_file(uint64_t offset, uint64_t size, uint64_t fileSize) {
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+// Поиск определенного символа в .dynsym без dlopen. Размеры таблиц берутся
+// из файла, поэтому перед выделением памяти они сверяются с его размером:
+// поврежденная библиотека просто не считается модулем.
+template <typename Ehdr, typename Shdr, typename Sym>
+static bool elf_defines_symbol(ifstream& file, uint64_t fileSize, const char* symbolName) {
+    Ehdr header;
+    if (!read_at(file, 0, &header, sizeof(header)) || header.e_shentsize != sizeof(Shdr) ||
+        !within_file(header.e_shoff, uint64_t(header.e_shnum) * sizeof(Shdr), fileSize)) {
+        return false;
+    }
+    vector<Shdr> sections(header.e_shnum);
+    if (sections.empty() ||
+        !read_at(file, header.e_shoff, sections.data(), sections.size() * sizeof(Shdr))) {
+        return false;
+    }
+
+    for (const Shdr& section : sections) {
+        if (section.sh_type != SHT_DYNSYM || section.sh_link >= sections.size()) continue;
+        const Shdr& strtab = sections[section.sh_link];
+        if (!within_file(section.sh_offset, section.sh_size, fileSize) ||
+            !within_file(strtab.sh_offset, strtab.sh_size, fileSize)) {
+            return false;
+        }
+        vector<Sym> symbols(section.sh_size / sizeof(Sym));
+        string names(strtab.sh_size, '\0');
+        if (!read_at(file, section.sh_offset, symbols.data(), symbols.size() * sizeof(Sym)) ||
+            !read_at(file, strtab.sh_offset, &names[0], names.size())) {
+            return false;
+        }
+        size_t nameLength = strlen(symbolName);
+        for (const Sym& symbol : symbols) {
+            if (symbol.st_shndx == SHN_UNDEF || symbol.st_name + nameLength >= names.size()) continue;
+            if (names.compare(symbol.st_name, nameLength + 1, symbolName, nameLength + 1) == 0) return true;
+        }
+    }
+    return false;
+}
+
+// Модуль — библиотека, экспортирующая crypto_plugin_descriptor; общие
+// библиотеки (libcryptort.so, libcryptoclient.so) в список не попадают
+static bool is_plugin_library(const string& path) {
+    error_code ec;
+    uint64_t fileSize = fs::file_size(path, ec);
+    if (ec) return false;
+
+    ifstream file(path, ios::binary);
+    unsigned char ident[EI_NIDENT];
+    if (!read_at(file, 0, ident, sizeof(ident)) || memcmp(ident, ELFMAG, SELFMAG) != 0) return false;
+    try {
+        if (ident[EI_CLASS] == ELFCLASS64) {
+            return elf_defines_symbol<Elf64_Ehdr, Elf64_Shdr, Elf64_Sym>(file, fileSize, CRYPTO_PLUGIN_DESCRIPTOR_SYMBOL);
+        }
+        if (ident[EI_CLASS] == ELFCLASS32) {
+            return elf_defines_symbol<Elf32_Ehdr, Elf32_Shdr, Elf32_Sym>(file, fileSize, CRYPTO_PLUGIN_DESCRIPTOR_SYMBOL);
+        }
+    } catch (const exception&) {
+    }
+    return false;
+}
+
+PluginRegistry::PluginRegistry(const string& directory) : dir(directory), stopping(false) {
+    if (dir.empty()) {
+        const char* env_dir = getenv("CRYPTO_SYSTEM_PLUGIN_DIR");
+        dir = env_dir ? env_dir : "./lib";
+    }
+
+    // Только просмотр имен и таблиц символов: ни одна библиотека не открывается
+    error_code ec;
+    for (const fs::directory_entry& file : fs::directory_iterator(dir, ec)) {
+        string filename = file.path().filename().string();
+        if (filename.size() <= 6 || filename.compare(0, 3, "lib") != 0 ||
+            filename.compare(filename.size() - 3, 3, ".so") != 0 || !is_plugin_library(file.path().string())) {
+            continue;
+        }
+        unique_ptr<Entry> entry(new Entry());
+        entry->name = filename.substr(3, filename.size() - 6);
+        entry->path = file.path().string();
+        entries.push_back(std::move(entry));
+    }
+    sort(entries.begin(), entries.end(),
+         [](const unique_ptr<Entry>& a, const unique_ptr<Entry>& b) { return a->name < b->name; });
+}
+
+PluginRegistry::~PluginRegistry() {
+    stopping = true;
+    if (warmer.joinable()) {
+        warmer.join();
+    }
+    for (const unique_ptr<Entry>& entry : entries) {
+        if (entry->handle) dlclose(entry->handle);
+    }
+}
+
+vector<string> PluginRegistry::names() const {
+    vector<string> result;
+    for (const unique_ptr<Entry>& entry : entries) {
+        result.push_back(entry->name);
+    }
+    return result;
+}
+
+bool PluginRegistry::has(const string& name) const {
+    return find(name) != nullptr;
+}
+
+string PluginRegistry::path(const string& name) const {
+    Entry* entry = find(name);
+    return entry ? entry->path : string();
+}
+
+PluginRegistry::Entry* PluginRegistry::find(const string& name) const {
+    for (const unique_ptr<Entry>& entry : entries) {
+        if (entry->name == name) return entry.get();
+    }
+    return nullptr;
+}
+
+void PluginRegistry::load(Entry& entry, int flags, bool background) {
+    auto start = chrono::steady_clock::now();
+    entry.handle = dlopen(entry.path.c_str(), flags);
+    if (!entry.handle) {
+        const char* dl_error = dlerror();
+        entry.error = dl_error ? dl_error : "не удалось загрузить " + entry.path;
+    }
+    entry.loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    entry.background = background;
+}
+
+void* PluginRegistry::handle(const string& name, string& error) {
+    Entry* entry = find(name);
+    if (!entry) {
+        error = "модуль " + name + " не найден в " + dir;
+        return nullptr;
+    }
+    // По требованию — ленивое связывание: символы разрешаются при вызове
+    call_once(entry->once, [&] { load(*entry, RTLD_LAZY | RTLD_LOCAL, false); });
+    if (!entry->handle) {
+        error = entry->error;
+    }
+    return entry->handle;
+}
+
+void* PluginRegistry::symbol(const string& name, const char* symbolName, string& error) {
+    void* library = handle(name, error);
+    if (!library) return nullptr;
+    // dlerror общий для процесса, поэтому результат проверяется по указателю
+    void* address = dlsym(library, symbolName);
+    if (!address) {
+        error = string("символ ") + symbolName + " не найден в модуле " + name;
+    }
+    return address;
+}
+
+const CryptoPluginDescriptor* PluginRegistry::descriptor(const string& name, string& error) {
+    void* library = handle(name, error);
+    return library ? loadPluginDescriptor(library, error) : nullptr;
+}
+
+void PluginRegistry::warmUp() {
+    if (warmer.joinable() || entries.empty()) return;
+    warmer = thread([this] {
+        for (const unique_ptr<Entry>& entry : entries) {
+            if (stopping) return;
+            call_once(entry->once, [&] { load(*entry, RTLD_NOW | RTLD_LOCAL, true); });
+        }
+    });
+}
+
+void PluginRegistry::report(ostream& out) const {
+    for (const unique_ptr<Entry>& entry : entries) {
+        // Значения пишутся внутри call_once, до этого библиотека не загружена
+        if (!entry->handle && entry->error.empty()) continue;
+        out << "  " << entry->name << ": " << fixed << setprecision(2) << entry->loadMs << " мс"
+            << (entry->background ? " (фоновая загрузка)" : "") << (entry->handle ? "" : ", ошибка") << endl;
+        out.unsetf(ios::floatfield);
+    }
+}
+
+const CryptoPluginDescriptor* loadPluginDescriptor(void* handle, string& error) {
+    CryptoPluginDescriptorFunc getDescriptor =
+        (CryptoPluginDescriptorFunc)dlsym(handle, CRYPTO_PLUGIN_DESCRIPTOR_SYMBOL);
+    if (!getDescriptor) {
+        error = "модуль не экспортирует " CRYPTO_PLUGIN_DESCRIPTOR_SYMBOL;
+        return nullptr;
+    }
+
+    const CryptoPluginDescriptor* descriptor = getDescriptor();
+    if (!descriptor || descriptor->abiVersion != CRYPTO_PLUGIN_ABI_VERSION ||
+        descriptor->structSize < sizeof(CryptoPluginDescriptor)) {
+        error = "несовместимая версия интерфейса модуля";
+        return nullptr;
+    }
+    return descriptor;
+}
@@ -1,4 +1,7 @@
 #include "../include/rsa_crypto.h"
+#include "../include/async_io.h"
+#include "../include/crypto_plugin.h"
+#include "../include/crypto_metrics.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -9,9 +12,18 @@
 #include <numeric>
 #include <stdexcept>
 #include <locale>
+#include <cctype>
+#include <cstring>
 
 using namespace std;
 
+// Метрики операций (crypto_metrics.h)
+static OperationMetric keygenMetric("rsa_keygen", "Генерация ключей RSA");
+static OperationMetric encryptMetric("rsa_encrypt", "Шифрование RSA в памяти");
+static OperationMetric decryptMetric("rsa_decrypt", "Дешифрование RSA в памяти");
+static OperationMetric fileEncryptMetric("rsa_file_encrypt", "Шифрование RSA файла");
+static OperationMetric fileDecryptMetric("rsa_file_decrypt", "Дешифрование RSA файла");
+
 // Вспомогательные функции (без RSA_API)
 
 int64_t gcd(int64_t a, int64_t b) {
@@ -115,6 +127,7 @@ RSA_API int64_t generatePrime(int64_t min, int64_t max) {
 }
 
 RSA_API RSAKeys generateRSAKeys() {
+    MetricTimer timer(keygenMetric);
     RSAKeys keys;
 
     // Генерация простых чисел p и q
@@ -147,6 +160,7 @@ RSA_API RSAKeys generateRSAKeys() {
 
 // НАДЕЖНАЯ реализация шифрования с обработкой UTF-8
 RSA_API vector<int64_t> encryptMessageRSA(const string& message, int64_t e, int64_t n) {
+    MetricTimer timer(encryptMetric, message.size());
     vector<int64_t> encrypted;
 
     for (unsigned char c : message) {
@@ -165,6 +179,7 @@ RSA_API vector<int64_t> encryptMessageRSA(const string& message, int64_t e, int6
 
 // НАДЕЖНАЯ реализация дешифрования с обработкой UTF-8
 RSA_API string decryptMessageRSA(const vector<int64_t>& encrypted, int64_t d, int64_t n) {
+    MetricTimer timer(decryptMetric, encrypted.size() * sizeof(int64_t));
     string decrypted;
 
     for (int64_t num : encrypted) {
@@ -185,54 +200,275 @@ RSA_API string decryptMessageRSA(const vector<int64_t>& encrypted, int64_t d, in
     return decrypted;
 }
 
-RSA_API void encryptFileRSA(const string& inputFile, const string& outputFile, int64_t e, int64_t n) {
-    ifstream in(inputFile, ios::binary);
-    if (!in) {
-        throw runtime_error("Не удалось открыть входной файл: " + inputFile);
-    }
-
-    ofstream out(outputFile, ios::binary);
-    if (!out) {
-        throw runtime_error("Не удалось создать выходной файл: " + outputFile);
-    }
+// Размер порции файловых операций
+const size_t RSA_FILE_BUFFER_SIZE = 1 << 20;
 
-    unsigned char c;
-    while (in.read(reinterpret_cast<char*>(&c), 1)) {
-        int64_t m = static_cast<int64_t>(c);
+// Файл шифруется побайтно, поэтому достаточно заранее вычислить текстовое
+// представление шифртекста для каждого из 256 значений байта
+static vector<string> buildEncryptionTable(int64_t e, int64_t n) {
+    vector<string> table(256);
+    for (int m = 0; m < 256; m++) {
         int64_t encrypted = powmod(m, e, n);
         encrypted = encrypted % n;
         if (encrypted < 0) encrypted += n;
-        out << encrypted << " ";
+        table[m] = to_string(encrypted) + " ";
     }
+    return table;
+}
 
-    in.close();
-    out.close();
+static void encryptBytesRSA(const vector<string>& table, const uint8_t* data, size_t size, vector<uint8_t>& output) {
+    for (size_t i = 0; i < size; i++) {
+        const string& text = table[data[i]];
+        output.insert(output.end(), text.begin(), text.end());
+    }
+}
+
+// Дешифрование чисел с кэшем результатов: в корректном файле
+// не более 256 различных шифртекстов
+class RSAByteDecryptor {
+public:
+    RSAByteDecryptor(int64_t d, int64_t n)
+        : d(d), n(n), cacheKeys(CACHE_SIZE), cacheValid(CACHE_SIZE, false), cacheValues(CACHE_SIZE) {}
+
+    unsigned char operator()(int64_t num) {
+        size_t slot = static_cast<uint64_t>(num) % CACHE_SIZE;
+        if (!cacheValid[slot] || cacheKeys[slot] != num) {
+            int64_t decrypted = powmod(num, d, n);
+            decrypted = decrypted % 256;
+            if (decrypted < 0) decrypted += 256;
+            if (decrypted < 0 || decrypted > 255) decrypted = 0;
+            cacheKeys[slot] = num;
+            cacheValid[slot] = true;
+            cacheValues[slot] = static_cast<unsigned char>(decrypted);
+        }
+        return cacheValues[slot];
+    }
+
+private:
+    static const size_t CACHE_SIZE = 1024;
+    int64_t d, n;
+    vector<int64_t> cacheKeys;
+    vector<bool> cacheValid;  // любое значение int64_t — допустимый шифртекст
+    vector<unsigned char> cacheValues;
+};
+
+// Разбор чисел, разделенных пробелами, с переносом незавершенного
+// числа через границу порций. Как и operator>>, останавливается
+// на первой лексеме, не являющейся числом или не помещающейся в int64_t.
+struct RSANumberParser {
+    bool inToken = false;
+    bool negative = false;
+    bool hasDigits = false;
+    bool stopped = false;
+    int64_t value = 0;
+
+    template <typename Emit>
+    void feed(const uint8_t* data, size_t size, Emit emit) {
+        for (size_t i = 0; i < size && !stopped; i++) {
+            char c = static_cast<char>(data[i]);
+            if (isspace(static_cast<unsigned char>(c))) {
+                if (inToken) finishToken(emit);
+            } else if (isdigit(static_cast<unsigned char>(c))) {
+                inToken = true;
+                hasDigits = true;
+                int digit = c - '0';
+                if (value > (INT64_MAX - digit) / 10) {
+                    stopped = true;
+                    break;
+                }
+                value = value * 10 + digit;
+            } else if (!inToken && (c == '-' || c == '+')) {
+                inToken = true;
+                negative = (c == '-');
+            } else {
+                if (hasDigits) emit(negative ? -value : value);
+                stopped = true;
+            }
+        }
+    }
+
+    template <typename Emit>
+    void finish(Emit emit) {
+        if (inToken && !stopped) finishToken(emit);
+    }
+
+private:
+    template <typename Emit>
+    void finishToken(Emit emit) {
+        if (hasDigits) {
+            emit(negative ? -value : value);
+        } else {
+            stopped = true;
+        }
+        inToken = negative = hasDigits = false;
+        value = 0;
+    }
+};
+
+RSA_API void encryptFileRSA(const string& inputFile, const string& outputFile, int64_t e, int64_t n) {
+    MetricTimer timer(fileEncryptMetric);
+    vector<string> table = buildEncryptionTable(e, n);
+    timer.addBytes(transformFileAsync(inputFile, outputFile, RSA_FILE_BUFFER_SIZE,
+        [&](const uint8_t* data, size_t size, vector<uint8_t>& output) {
+            encryptBytesRSA(table, data, size, output);
+        }));
 }
 
 RSA_API void decryptFileRSA(const string& inputFile, const string& outputFile, int64_t d, int64_t n) {
-    ifstream in(inputFile, ios::binary);
-    if (!in) {
-        throw runtime_error("Не удалось открыть входной файл: " + inputFile);
+    MetricTimer timer(fileDecryptMetric);
+    RSAByteDecryptor decryptor(d, n);
+    RSANumberParser parser;
+    timer.addBytes(transformFileAsync(inputFile, outputFile, RSA_FILE_BUFFER_SIZE,
+        [&](const uint8_t* data, size_t size, vector<uint8_t>& output) {
+            auto emit = [&](int64_t num) { output.push_back(decryptor(num)); };
+            if (size > 0) {
+                parser.feed(data, size, emit);
+            } else {
+                parser.finish(emit);
+            }
+        }));
+}
+
+// Пакетная обработка: каждый файл — отдельная задача пула
+// (размер шифртекста зависит от данных, поэтому файлы не делятся на порции)
+RSA_API BatchStats encryptDirectoryRSA(const string& inputDir, const string& outputDir,
+                                       int64_t e, int64_t n, size_t threads) {
+    vector<string> table = buildEncryptionTable(e, n);
+
+    BatchOperation operation;
+    operation.processWhole = [&table](const vector<uint8_t>& in, vector<uint8_t>& out) {
+        encryptBytesRSA(table, in.data(), in.size(), out);
+    };
+    return processDirectory(inputDir, outputDir, operation, threads);
+}
+
+RSA_API BatchStats decryptDirectoryRSA(const string& inputDir, const string& outputDir,
+                                       int64_t d, int64_t n, size_t threads) {
+    BatchOperation operation;
+    operation.processWhole = [d, n](const vector<uint8_t>& in, vector<uint8_t>& out) {
+        RSAByteDecryptor decryptor(d, n);
+        RSANumberParser parser;
+        auto emit = [&](int64_t num) { out.push_back(decryptor(num)); };
+        parser.feed(in.data(), in.size(), emit);
+        parser.finish(emit);
+    };
+    return processDirectory(inputDir, outputDir, operation, threads);
+}
+
+// ==================== ИНТЕРФЕЙС МОДУЛЯ (crypto_plugin.h) ====================
+//
+// Ключ — 24 байта: e, d, n (int64, little-endian); e или d может быть 0,
+// если соответствующая операция не нужна. Формат шифртекста — как у файлов:
+// десятичные числа через пробел.
+
+struct RSAPluginContext {
+    int64_t e, d, n;
+    vector<string> table;   // шифртексты байтов (если задан e)
+};
+
+static int64_t readLE64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | in[i];
     }
+    return static_cast<int64_t>(value);
+}
 
-    ofstream out(outputFile, ios::binary);
-    if (!out) {
-        throw runtime_error("Не удалось создать выходной файл: " + outputFile);
+static int rsaPluginInit(const uint8_t* key, size_t keyLen, void** context) {
+    if (!context) return CRYPTO_PLUGIN_ERR_ARGUMENT;
+    if (!key || keyLen != 24) return CRYPTO_PLUGIN_ERR_KEY;
+    int64_t e = readLE64(key), d = readLE64(key + 8), n = readLE64(key + 16);
+    // Байт должен однозначно восстанавливаться по модулю n
+    if (n <= 255 || e < 0 || d < 0 || (e == 0 && d == 0)) return CRYPTO_PLUGIN_ERR_KEY;
+    try {
+        RSAPluginContext* ctx = new RSAPluginContext{e, d, n, {}};
+        if (e != 0) ctx->table = buildEncryptionTable(e, n);
+        *context = ctx;
+        return CRYPTO_PLUGIN_OK;
+    } catch (const exception&) {
+        return CRYPTO_PLUGIN_ERR_INTERNAL;
     }
+}
 
-    int64_t num;
-    while (in >> num) {
-        int64_t decrypted = powmod(num, d, n);
-        decrypted = decrypted % 256;
-        if (decrypted < 0) decrypted += 256;
-        if (decrypted < 0 || decrypted > 255) decrypted = 0;
-        
-        unsigned char c = static_cast<unsigned char>(decrypted);
-        out.write(reinterpret_cast<const char*>(&c), 1);
+static size_t rsaPluginMaxOutput(void* context, int operation, size_t inputLen) {
+    const RSAPluginContext* ctx = static_cast<const RSAPluginContext*>(context);
+    if (operation == CRYPTO_PLUGIN_DECRYPT) {
+        // Каждое число — хотя бы одна цифра и разделитель
+        return inputLen / 2 + 1;
+    }
+    return inputLen * (to_string(ctx->n - 1).size() + 1);
+}
+
+static int rsaPluginEncrypt(void* context, const uint8_t* in, size_t inLen,
+                            uint8_t* out, size_t outCapacity, size_t* outLen) {
+    const RSAPluginContext* ctx = static_cast<const RSAPluginContext*>(context);
+    if (!ctx || !outLen || (!in && inLen > 0)) return CRYPTO_PLUGIN_ERR_ARGUMENT;
+    if (ctx->e == 0) return CRYPTO_PLUGIN_ERR_KEY;
+    MetricTimer timer(encryptMetric, inLen);
+
+    size_t needed = 0;
+    for (size_t i = 0; i < inLen; i++) {
+        needed += ctx->table[in[i]].size();
     }
+    *outLen = needed;
+    if (needed > outCapacity) return CRYPTO_PLUGIN_ERR_BUFFER;
+    for (size_t i = 0; i < inLen; i++) {
+        const string& text = ctx->table[in[i]];
+        memcpy(out, text.data(), text.size());
+        out += text.size();
+    }
+    return CRYPTO_PLUGIN_OK;
+}
+
+static int rsaPluginDecrypt(void* context, const uint8_t* in, size_t inLen,
+                            uint8_t* out, size_t outCapacity, size_t* outLen) {
+    const RSAPluginContext* ctx = static_cast<const RSAPluginContext*>(context);
+    if (!ctx || !outLen || (!in && inLen > 0)) return CRYPTO_PLUGIN_ERR_ARGUMENT;
+    if (ctx->d == 0) return CRYPTO_PLUGIN_ERR_KEY;
+    MetricTimer timer(decryptMetric, inLen);
+    try {
+        RSAByteDecryptor decryptor(ctx->d, ctx->n);
+        RSANumberParser parser;
+        size_t count = 0;
+        // При нехватке места разбор продолжается, чтобы вернуть нужный размер
+        auto emit = [&](int64_t num) {
+            if (count < outCapacity) out[count] = decryptor(num);
+            count++;
+        };
+        parser.feed(in, inLen, emit);
+        parser.finish(emit);
+        *outLen = count;
+        if (parser.stopped) {
+            timer.fail();
+            return CRYPTO_PLUGIN_ERR_DATA;
+        }
+        return count > outCapacity ? CRYPTO_PLUGIN_ERR_BUFFER : CRYPTO_PLUGIN_OK;
+    } catch (const exception&) {
+        timer.fail();
+        return CRYPTO_PLUGIN_ERR_INTERNAL;
+    }
+}
+
+static void rsaPluginFree(void* context) {
+    delete static_cast<RSAPluginContext*>(context);
+}
 
-    in.close();
-    out.close();
+static const CryptoPluginDescriptor RSA_PLUGIN_DESCRIPTOR = {
+    CRYPTO_PLUGIN_ABI_VERSION,
+    sizeof(CryptoPluginDescriptor),
+    "rsa",
+    "RSA (побайтное шифрование, шифртекст — десятичные числа)",
+    "24 байта: e, d, n (int64, little-endian); e или d может быть 0",
+    CRYPTO_PLUGIN_CAP_ENCRYPT | CRYPTO_PLUGIN_CAP_DECRYPT | CRYPTO_PLUGIN_CAP_KEY | CRYPTO_PLUGIN_CAP_THREAD_SAFE,
+    rsaPluginInit,
+    rsaPluginMaxOutput,
+    rsaPluginEncrypt,
+    rsaPluginDecrypt,
+    rsaPluginFree,
+};
+
+extern "C" RSA_API const CryptoPluginDescriptor* crypto_plugin_descriptor() {
+    return &RSA_PLUGIN_DESCRIPTOR;
 }
 
 // Функция для проверки корректности ключей
@@ -355,6 +591,8 @@ RSA_API void run_rsa_crypto() {
     cout << "3. Дешифровать сообщение\n";
     cout << "4. Шифровать файл\n";
     cout << "5. Дешифровать файл\n";
+    cout << "6. Пакетно шифровать каталог\n";
+    cout << "7. Пакетно дешифровать каталог\n";
     cout << "Выберите действие: ";
 
     int choice;
@@ -377,7 +615,7 @@ RSA_API void run_rsa_crypto() {
                 cin.ignore();
 
                 int64_t e, n;
-                RSAKeys autoKeys;
+                RSAKeys autoKeys{};
                 
                 if (keyChoice == 'm' || keyChoice == 'M') {
                     cout << "Введите ОТКРЫТЫЙ ключ для шифрования:\n";
@@ -538,6 +776,36 @@ RSA_API void run_rsa_crypto() {
                 cout << "Файл успешно расшифрован." << endl;
                 break;
             }
+            case 6:
+            case 7: {
+                int64_t exponent, n;
+                if (choice == 6) {
+                    cout << "Введите ОТКРЫТЫЙ ключ для шифрования:\n";
+                    if (!getPublicKeyManual(exponent, n)) {
+                        cout << "Ошибка ввода ключей!\n";
+                        break;
+                    }
+                } else {
+                    cout << "Введите ЗАКРЫТЫЙ ключ для дешифрования:\n";
+                    if (!getPrivateKeyManual(exponent, n)) {
+                        cout << "Ошибка ввода ключей!\n";
+                        break;
+                    }
+                }
+
+                cout << "Введите входной каталог: ";
+                string inputDir;
+                getline(cin, inputDir);
+
+                cout << "Введите выходной каталог: ";
+                string outputDir;
+                getline(cin, outputDir);
+
+                BatchStats stats = (choice == 6) ? encryptDirectoryRSA(inputDir, outputDir, exponent, n)
+                                                 : decryptDirectoryRSA(inputDir, outputDir, exponent, n);
+                printBatchStats(stats);
+                break;
+            }
             default:
                 cout << "Неверный выбор." << endl;
         }
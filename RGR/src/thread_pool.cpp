@@ -0,0 +1,137 @@
+#include "../include/thread_pool.h"
+
+using namespace std;
+
+// Пул и номер очереди текущего рабочего потока
+static thread_local WorkStealingPool* currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+WorkStealingPool::WorkStealingPool(size_t threadCount)
+    : queued(0), pending(0), throttle(0), nextQueue(0), stopping(false) {
+    if (threadCount == 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        queues.emplace_back(new WorkerQueue());
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    size_t target = (currentPool == this) ? currentWorker
+                                          : nextQueue.fetch_add(1, memory_order_relaxed) % queues.size();
+    pending.fetch_add(1);
+    {
+        lock_guard<mutex> lock(queues[target]->mtx);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1);
+    {
+        // Захват мьютекса исключает потерю пробуждения
+        lock_guard<mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+bool WorkStealingPool::popOrSteal(size_t self, Task& task) {
+    {
+        WorkerQueue& own = *queues[self];
+        lock_guard<mutex> lock(own.mtx);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        WorkerQueue& victim = *queues[(self + i) % queues.size()];
+        lock_guard<mutex> lock(victim.mtx);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::finishTask() {
+    size_t left = pending.fetch_sub(1) - 1;
+    if (left == 0 || left < throttle.load()) {
+        lock_guard<mutex> lock(sleepMutex);
+        idle.notify_all();
+    }
+}
+
+void WorkStealingPool::runTask(Task& task) {
+    queued.fetch_sub(1);
+    try {
+        task();
+    } catch (...) {
+        lock_guard<mutex> lock(sleepMutex);
+        if (!firstError) firstError = current_exception();
+    }
+    finishTask();
+}
+
+bool WorkStealingPool::runOneTask() {
+    // Рабочий поток начинает со своей очереди, посторонний — с очередной
+    size_t self = (currentPool == this) ? currentWorker
+                                        : nextQueue.load(memory_order_relaxed) % queues.size();
+    Task task;
+    if (!popOrSteal(self, task)) {
+        return false;
+    }
+    runTask(task);
+    return true;
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentWorker = index;
+
+    while (true) {
+        Task task;
+        if (popOrSteal(index, task)) {
+            runTask(task);
+            continue;
+        }
+
+        unique_lock<mutex> lock(sleepMutex);
+        wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+void WorkStealingPool::wait() {
+    unique_lock<mutex> lock(sleepMutex);
+    idle.wait(lock, [&] { return pending.load() == 0; });
+    if (firstError) {
+        exception_ptr error = firstError;
+        firstError = nullptr;
+        rethrow_exception(error);
+    }
+}
+
+void WorkStealingPool::waitPendingBelow(size_t limit) {
+    if (pending.load() < limit) return;
+    throttle.store(limit);
+    unique_lock<mutex> lock(sleepMutex);
+    idle.wait(lock, [&] { return pending.load() < limit; });
+    throttle.store(0);
+}
@@ -0,0 +1,263 @@
+#include "../include/threeway_crypto.h"
+#include "../include/threeway_kernels.h"
+#include <fstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// ==================== КОНТЕЙНЕР С ПРОИЗВОЛЬНЫМ ДОСТУПОМ ====================
+//
+// Формат файла (все числа little-endian):
+//   заголовок: "3WAYSEEK" | версия u32 | размер чанка u32 | соль 12 байт | резерв u32
+//   чанки:     шифртекст в режиме CTR, по chunkSize байт (последний короче)
+//   индекс:    смещение начала каждого чанка, u64
+//   трейлер:   размер открытого текста u64 | число чанков u64 | "3WAYINDX"
+//
+// Ключ файла — E_K(соль): 96 случайных бит соли делают совпадение ключевых
+// потоков двух контейнеров под одним ключом K практически невозможным.
+// Блок счетчика для j-го блока i-го чанка: слова [nonce, i, j], nonce —
+// первое слово соли. CTR не требует дополнения, поэтому размер шифртекста
+// равен размеру открытого текста, а любой байт расшифровывается независимо.
+
+static const char CONTAINER_MAGIC[8] = {'3', 'W', 'A', 'Y', 'S', 'E', 'E', 'K'};
+static const char INDEX_MAGIC[8] = {'3', 'W', 'A', 'Y', 'I', 'N', 'D', 'X'};
+static const uint32_t CONTAINER_VERSION = 1;
+static const uint32_t CONTAINER_CHUNK_SIZE = THREE_WAY_BLOCK_SIZE * 5461; // ~64 КБ
+static const size_t CONTAINER_HEADER_SIZE = 32;
+static const size_t CONTAINER_TRAILER_SIZE = 24;
+
+struct ContainerLayout {
+    uint32_t chunkSize;
+    uint8_t salt[THREE_WAY_BLOCK_SIZE];
+    uint32_t nonce;
+    uint64_t plaintextSize;
+    uint64_t chunkCount;
+    uint64_t indexOffset;
+};
+
+static void putLE32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+static void putLE64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+static uint32_t getLE32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t getLE64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+// XOR участка чанка с ключевым потоком CTR.
+// chunkOffset — смещение data от начала чанка; шифруются только
+// блоки счетчика, покрывающие [chunkOffset, chunkOffset + length)
+static void applyKeystream(uint8_t* data, size_t length, uint32_t nonce, uint32_t chunkIndex,
+                           size_t chunkOffset, const uint32_t roundKeys[THREE_WAY_ROUNDS][3],
+                           vector<uint8_t>& keystream) {
+    if (length == 0) return;
+
+    size_t firstBlock = chunkOffset / THREE_WAY_BLOCK_SIZE;
+    size_t lastBlock = (chunkOffset + length - 1) / THREE_WAY_BLOCK_SIZE;
+    size_t blocks = lastBlock - firstBlock + 1;
+
+    keystream.resize(blocks * THREE_WAY_BLOCK_SIZE);
+    for (size_t j = 0; j < blocks; j++) {
+        uint32_t counter[3] = {nonce, chunkIndex, static_cast<uint32_t>(firstBlock + j)};
+        unpackBlockToBytes(counter, keystream.data() + j * THREE_WAY_BLOCK_SIZE);
+    }
+    threeWayEncryptBlocks(keystream.data(), keystream.data(), blocks, roundKeys);
+
+    const uint8_t* ks = keystream.data() + chunkOffset % THREE_WAY_BLOCK_SIZE;
+    for (size_t i = 0; i < length; i++) {
+        data[i] ^= ks[i];
+    }
+}
+
+// Раундовые ключи ключевого потока контейнера: ключ файла E_K(соль)
+static void containerRoundKeys(const ContainerLayout& layout, const ThreeWayKeys& keys,
+                               uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    generateRoundKeys(keys.key, roundKeys);
+    uint8_t fileKeyBytes[THREE_WAY_BLOCK_SIZE];
+    threeWayEncryptBlocks(layout.salt, fileKeyBytes, 1, roundKeys);
+    uint32_t fileKey[3];
+    packBytesToBlock(fileKeyBytes, fileKey);
+    generateRoundKeys(fileKey, roundKeys);
+}
+
+// Чтение заголовка и трейлера с проверкой целостности разметки
+static ContainerLayout readContainerLayout(ifstream& in, const string& file) {
+    uint8_t header[CONTAINER_HEADER_SIZE];
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        memcmp(header, CONTAINER_MAGIC, sizeof(CONTAINER_MAGIC)) != 0) {
+        throw runtime_error("Файл не является контейнером 3-WAY: " + file);
+    }
+    if (getLE32(header + 8) != CONTAINER_VERSION) {
+        throw runtime_error("Неподдерживаемая версия контейнера 3-WAY: " + file);
+    }
+
+    ContainerLayout layout;
+    layout.chunkSize = getLE32(header + 12);
+    memcpy(layout.salt, header + 16, sizeof(layout.salt));
+    layout.nonce = getLE32(layout.salt);
+
+    in.seekg(0, ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    if (fileSize < CONTAINER_HEADER_SIZE + CONTAINER_TRAILER_SIZE || layout.chunkSize == 0 ||
+        layout.chunkSize % THREE_WAY_BLOCK_SIZE != 0) {
+        throw runtime_error("Поврежден контейнер 3-WAY: " + file);
+    }
+
+    uint8_t trailer[CONTAINER_TRAILER_SIZE];
+    in.seekg(fileSize - CONTAINER_TRAILER_SIZE);
+    if (!in.read(reinterpret_cast<char*>(trailer), sizeof(trailer)) ||
+        memcmp(trailer + 16, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        throw runtime_error("Не найден индекс контейнера 3-WAY: " + file);
+    }
+
+    layout.plaintextSize = getLE64(trailer);
+    layout.chunkCount = getLE64(trailer + 8);
+
+    uint64_t expectedChunks = (layout.plaintextSize + layout.chunkSize - 1) / layout.chunkSize;
+    uint64_t dataEnd = fileSize - CONTAINER_TRAILER_SIZE;
+    if (layout.chunkCount != expectedChunks || layout.chunkCount > dataEnd / 8) {
+        throw runtime_error("Поврежден индекс контейнера 3-WAY: " + file);
+    }
+    layout.indexOffset = dataEnd - layout.chunkCount * 8;
+    return layout;
+}
+
+void encryptFileThreeWaySeekable(const string& inputFile, const string& outputFile, const ThreeWayKeys& keys) {
+    ifstream in(inputFile, ios::binary);
+    if (!in) {
+        throw runtime_error("Не удалось открыть входной файл: " + inputFile);
+    }
+
+    ofstream out(outputFile, ios::binary);
+    if (!out) {
+        throw runtime_error("Не удалось создать выходной файл: " + outputFile);
+    }
+
+    ContainerLayout layout;
+    random_device rd;
+    for (size_t i = 0; i < sizeof(layout.salt); i += 4) {
+        putLE32(layout.salt + i, rd());
+    }
+    layout.nonce = getLE32(layout.salt);
+
+    uint32_t roundKeys[THREE_WAY_ROUNDS][3];
+    containerRoundKeys(layout, keys, roundKeys);
+
+    uint8_t header[CONTAINER_HEADER_SIZE] = {0};
+    memcpy(header, CONTAINER_MAGIC, sizeof(CONTAINER_MAGIC));
+    putLE32(header + 8, CONTAINER_VERSION);
+    putLE32(header + 12, CONTAINER_CHUNK_SIZE);
+    memcpy(header + 16, layout.salt, sizeof(layout.salt));
+    out.write(reinterpret_cast<char*>(header), sizeof(header));
+
+    // Шифрование по чанкам с запоминанием их смещений
+    vector<uint8_t> buffer(CONTAINER_CHUNK_SIZE);
+    vector<uint8_t> keystream;
+    vector<uint64_t> chunkOffsets;
+    uint64_t position = CONTAINER_HEADER_SIZE;
+    uint64_t plaintextSize = 0;
+
+    while (in) {
+        in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+        size_t bytesRead = static_cast<size_t>(in.gcount());
+        if (bytesRead == 0) break;
+
+        uint32_t chunkIndex = static_cast<uint32_t>(chunkOffsets.size());
+        applyKeystream(buffer.data(), bytesRead, layout.nonce, chunkIndex, 0, roundKeys, keystream);
+        out.write(reinterpret_cast<char*>(buffer.data()), bytesRead);
+
+        chunkOffsets.push_back(position);
+        position += bytesRead;
+        plaintextSize += bytesRead;
+    }
+
+    // Индекс и трейлер
+    vector<uint8_t> index(chunkOffsets.size() * 8);
+    for (size_t i = 0; i < chunkOffsets.size(); i++) {
+        putLE64(index.data() + i * 8, chunkOffsets[i]);
+    }
+    out.write(reinterpret_cast<char*>(index.data()), index.size());
+
+    uint8_t trailer[CONTAINER_TRAILER_SIZE];
+    putLE64(trailer, plaintextSize);
+    putLE64(trailer + 8, chunkOffsets.size());
+    memcpy(trailer + 16, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    out.write(reinterpret_cast<char*>(trailer), sizeof(trailer));
+
+    if (!out) {
+        throw runtime_error("Ошибка записи выходного файла: " + outputFile);
+    }
+}
+
+uint64_t seekablePlaintextSizeThreeWay(const string& file) {
+    ifstream in(file, ios::binary);
+    if (!in) {
+        throw runtime_error("Не удалось открыть входной файл: " + file);
+    }
+    return readContainerLayout(in, file).plaintextSize;
+}
+
+vector<uint8_t> decryptRangeThreeWay(const string& file, uint64_t offset, size_t length, const ThreeWayKeys& keys) {
+    ifstream in(file, ios::binary);
+    if (!in) {
+        throw runtime_error("Не удалось открыть входной файл: " + file);
+    }
+
+    ContainerLayout layout = readContainerLayout(in, file);
+    if (offset > layout.plaintextSize) {
+        throw out_of_range("Смещение за пределами контейнера 3-WAY");
+    }
+    length = static_cast<size_t>(min<uint64_t>(length, layout.plaintextSize - offset));
+    vector<uint8_t> result(length);
+    if (length == 0) {
+        return result;
+    }
+
+    uint32_t roundKeys[THREE_WAY_ROUNDS][3];
+    containerRoundKeys(layout, keys, roundKeys);
+
+    // Читаем только нужный участок индекса
+    uint64_t firstChunk = offset / layout.chunkSize;
+    uint64_t lastChunk = (offset + length - 1) / layout.chunkSize;
+    size_t chunks = static_cast<size_t>(lastChunk - firstChunk + 1);
+
+    vector<uint8_t> index(chunks * 8);
+    in.seekg(layout.indexOffset + firstChunk * 8);
+    if (!in.read(reinterpret_cast<char*>(index.data()), index.size())) {
+        throw runtime_error("Поврежден индекс контейнера 3-WAY: " + file);
+    }
+
+    vector<uint8_t> keystream;
+    size_t written = 0;
+    for (size_t i = 0; i < chunks; i++) {
+        uint64_t chunkIndex = firstChunk + i;
+        size_t begin = (i == 0) ? static_cast<size_t>(offset % layout.chunkSize) : 0;
+        size_t end = min<uint64_t>(layout.chunkSize, offset + length - chunkIndex * layout.chunkSize);
+
+        in.seekg(getLE64(index.data() + i * 8) + begin);
+        if (!in.read(reinterpret_cast<char*>(result.data() + written), end - begin)) {
+            throw runtime_error("Поврежден чанк контейнера 3-WAY: " + file);
+        }
+        applyKeystream(result.data() + written, end - begin, layout.nonce,
+                       static_cast<uint32_t>(chunkIndex), begin, roundKeys, keystream);
+        written += end - begin;
+    }
+
+    return result;
+}
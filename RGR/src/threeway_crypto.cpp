@@ -1,9 +1,14 @@
 #include "../include/threeway_crypto.h"
+#include "../include/threeway_kernels.h"
+#include "../include/async_io.h"
+#include "../include/crypto_plugin.h"
+#include "../include/crypto_metrics.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
 #include <random>
+#include <cstdlib>
 #include <cmath>
 #include <algorithm>
 #include <numeric>
@@ -11,99 +16,22 @@
 #include <locale>
 #include <sstream>
 #include <iomanip>
+#include <iterator>
+#include <span>
+#include <unistd.h>
 
 using namespace std;
 
-// Константы для упрощенного 3-WAY
-const int THREE_WAY_BLOCK_SIZE = 12; // 96 бит = 12 байт
-const int THREE_WAY_ROUNDS = 4;      // Простое количество раундов
-
-// Вспомогательные функции
-
-// Циклический сдвиг влево
-uint32_t rotateLeft(uint32_t x, int n) {
-    n = n % 32;
-    return (x << n) | (x >> (32 - n));
-}
-
-// Циклический сдвиг вправо
-uint32_t rotateRight(uint32_t x, int n) {
-    n = n % 32;
-    return (x >> n) | (x << (32 - n));
-}
-
-// ОЧЕНЬ ПРОСТАЯ обратимая функция для одного раунда
-void roundFunction(uint32_t block[3], const uint32_t roundKey[3]) {
-    // Простое обратимое преобразование
-    uint32_t a = block[0], b = block[1], c = block[2];
-    
-    // Шаг 1: XOR с ключом
-    a ^= roundKey[0];
-    b ^= roundKey[1];
-    c ^= roundKey[2];
-    
-    // Шаг 2: Простая перестановка
-    block[0] = b;
-    block[1] = c;
-    block[2] = a;
-    
-    // Шаг 3: Простой сдвиг
-    block[0] = rotateLeft(block[0], 5);
-    block[1] = rotateRight(block[1], 3);
-    block[2] = rotateLeft(block[2], 7);
-}
-
-// Обратная функция для одного раунда
-void roundFunctionInverse(uint32_t block[3], const uint32_t roundKey[3]) {
-    // Обратные операции в обратном порядке
-    
-    // Шаг 3: Обратные сдвиги
-    block[0] = rotateRight(block[0], 5);
-    block[1] = rotateLeft(block[1], 3);
-    block[2] = rotateRight(block[2], 7);
-    
-    // Шаг 2: Обратная перестановка
-    uint32_t a = block[2], b = block[0], c = block[1];
-    
-    // Шаг 1: XOR с ключом (обратная операция)
-    block[0] = a ^ roundKey[0];
-    block[1] = b ^ roundKey[1];
-    block[2] = c ^ roundKey[2];
-}
-
-// Генерация раундовых ключей
-void generateRoundKeys(const uint32_t key[3], uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
-    uint32_t temp[3] = {key[0], key[1], key[2]};
-    
-    for (int round = 0; round < THREE_WAY_ROUNDS; round++) {
-        // Сохраняем текущий ключ
-        roundKeys[round][0] = temp[0];
-        roundKeys[round][1] = temp[1];
-        roundKeys[round][2] = temp[2];
-        
-        // Обновление ключа для следующего раунда
-        temp[0] = rotateLeft(temp[0] + 0x9E3779B9, 7);
-        temp[1] = rotateLeft(temp[1] + 0xB7E15162, 13);
-        temp[2] = rotateLeft(temp[2] + 0xBF715880, 17);
-    }
-}
-
-// Основное шифрование
-void threeWayEncrypt(uint32_t block[3], const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
-    for (int round = 0; round < THREE_WAY_ROUNDS; round++) {
-        roundFunction(block, roundKeys[round]);
-    }
-}
-
-// Основное дешифрование
-void threeWayDecrypt(uint32_t block[3], const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
-    for (int round = THREE_WAY_ROUNDS - 1; round >= 0; round--) {
-        roundFunctionInverse(block, roundKeys[round]);
-    }
-}
+// Метрики операций (crypto_metrics.h)
+static OperationMetric keygenMetric("threeway_keygen", "Генерация ключа 3-WAY");
+static OperationMetric encryptMetric("threeway_encrypt", "Шифрование 3-WAY в памяти");
+static OperationMetric decryptMetric("threeway_decrypt", "Дешифрование 3-WAY в памяти");
+static OperationMetric fileEncryptMetric("threeway_file_encrypt", "Шифрование 3-WAY файла или потока");
+static OperationMetric fileDecryptMetric("threeway_file_decrypt", "Дешифрование 3-WAY файла или потока");
 
 // Генерация ключей
 ThreeWayKeys generateThreeWayKeys() {
+    MetricTimer timer(keygenMetric);
     ThreeWayKeys keys;
     
     random_device rd;
@@ -118,221 +46,220 @@ ThreeWayKeys generateThreeWayKeys() {
     return keys;
 }
 
-// Упаковка байтов в 32-битные слова
-void packBytesToBlock(const uint8_t* bytes, uint32_t block[3]) {
-    block[0] = (static_cast<uint32_t>(bytes[0]) << 24) |
-               (static_cast<uint32_t>(bytes[1]) << 16) |
-               (static_cast<uint32_t>(bytes[2]) << 8) |
-               (static_cast<uint32_t>(bytes[3]));
-               
-    block[1] = (static_cast<uint32_t>(bytes[4]) << 24) |
-               (static_cast<uint32_t>(bytes[5]) << 16) |
-               (static_cast<uint32_t>(bytes[6]) << 8) |
-               (static_cast<uint32_t>(bytes[7]));
-               
-    block[2] = (static_cast<uint32_t>(bytes[8]) << 24) |
-               (static_cast<uint32_t>(bytes[9]) << 16) |
-               (static_cast<uint32_t>(bytes[10]) << 8) |
-               (static_cast<uint32_t>(bytes[11]));
+// Размер шифртекста: открытый текст и от 1 до 12 байтов дополнения
+size_t requiredSizeThreeWay(size_t messageLen) {
+    return (messageLen / THREE_WAY_BLOCK_SIZE + 1) * THREE_WAY_BLOCK_SIZE;
 }
 
-// Распаковка 32-битных слов в байты
-void unpackBlockToBytes(const uint32_t block[3], uint8_t* bytes) {
-    bytes[0] = static_cast<uint8_t>((block[0] >> 24) & 0xFF);
-    bytes[1] = static_cast<uint8_t>((block[0] >> 16) & 0xFF);
-    bytes[2] = static_cast<uint8_t>((block[0] >> 8) & 0xFF);
-    bytes[3] = static_cast<uint8_t>(block[0] & 0xFF);
-    
-    bytes[4] = static_cast<uint8_t>((block[1] >> 24) & 0xFF);
-    bytes[5] = static_cast<uint8_t>((block[1] >> 16) & 0xFF);
-    bytes[6] = static_cast<uint8_t>((block[1] >> 8) & 0xFF);
-    bytes[7] = static_cast<uint8_t>(block[1] & 0xFF);
-    
-    bytes[8] = static_cast<uint8_t>((block[2] >> 24) & 0xFF);
-    bytes[9] = static_cast<uint8_t>((block[2] >> 16) & 0xFF);
-    bytes[10] = static_cast<uint8_t>((block[2] >> 8) & 0xFF);
-    bytes[11] = static_cast<uint8_t>(block[2] & 0xFF);
+static const char* const INVALID_CIPHERTEXT =
+    "данные не являются шифртекстом 3-WAY (неверный размер или дополнение) или ключ неверен";
+
+// Шифрование с дополнением; out вмещает requiredSizeThreeWay(length) байт
+static void encryptPaddedThreeWay(const uint8_t* in, size_t length, uint8_t* out,
+                                  const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    // Полные блоки обрабатываются векторным ядром
+    size_t fullBlocks = length / THREE_WAY_BLOCK_SIZE;
+    threeWayEncryptBlocks(in, out, fullBlocks, roundKeys);
+
+    size_t tailStart = fullBlocks * THREE_WAY_BLOCK_SIZE;
+    uint8_t blockBytes[THREE_WAY_BLOCK_SIZE];
+    padThreeWayBlock(in + tailStart, length - tailStart, blockBytes);
+    threeWayEncryptBlocks(blockBytes, out + tailStart, 1, roundKeys);
 }
 
-// Шифрование сообщения
-vector<uint8_t> encryptMessageThreeWay(const string& message, const ThreeWayKeys& keys) {
-    vector<uint8_t> encrypted;
-    
+// Последний блок расшифровывается первым: он определяет точную длину.
+// Возвращает длину открытого текста или SIZE_MAX, если размер шифртекста
+// или дополнение неверны.
+static size_t decryptLastBlockThreeWay(const uint8_t* in, size_t length, uint8_t lastBlock[THREE_WAY_BLOCK_SIZE],
+                                       const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    if (length == 0 || length % THREE_WAY_BLOCK_SIZE != 0) return SIZE_MAX;
+    threeWayDecryptBlocks(in + length - THREE_WAY_BLOCK_SIZE, lastBlock, 1, roundKeys);
+    size_t padding = threeWayPaddingLength(lastBlock);
+    return padding == 0 ? SIZE_MAX : length - padding;
+}
+
+// Расшифровка остальных блоков и копирование начала последнего
+static void decryptRemainingThreeWay(const uint8_t* in, size_t length, const uint8_t lastBlock[THREE_WAY_BLOCK_SIZE],
+                                     size_t decryptedLen, uint8_t* out,
+                                     const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    size_t tailStart = length - THREE_WAY_BLOCK_SIZE;
+    threeWayDecryptBlocks(in, out, tailStart / THREE_WAY_BLOCK_SIZE, roundKeys);
+    copy(lastBlock, lastBlock + (decryptedLen - tailStart), out + tailStart);
+}
+
+// Шифрование сообщения в буфер вызывающей стороны
+size_t encryptMessageThreeWay(span<const uint8_t> message, span<uint8_t> out, const ThreeWayKeys& keys) {
+    MetricTimer timer(encryptMetric, message.size());
+    size_t encryptedLen = requiredSizeThreeWay(message.size());
+    if (out.size() < encryptedLen) {
+        throw length_error("Недостаточный размер выходного буфера 3-WAY");
+    }
+
     // Генерация раундовых ключей
     uint32_t roundKeys[THREE_WAY_ROUNDS][3];
     generateRoundKeys(keys.key, roundKeys);
-    
-    // Обработка сообщения блоками по 12 байт
-    size_t messageLen = message.length();
-    size_t blocks = (messageLen + THREE_WAY_BLOCK_SIZE - 1) / THREE_WAY_BLOCK_SIZE;
-    
-    for (size_t blockNum = 0; blockNum < blocks; blockNum++) {
-        uint8_t blockBytes[THREE_WAY_BLOCK_SIZE] = {0};
-        uint32_t block[3] = {0, 0, 0};
-        
-        // Заполнение блока данными (с паддингом если нужно)
-        size_t blockStart = blockNum * THREE_WAY_BLOCK_SIZE;
-        size_t bytesToCopy = min(static_cast<size_t>(THREE_WAY_BLOCK_SIZE), messageLen - blockStart);
-        
-        for (size_t i = 0; i < bytesToCopy; i++) {
-            blockBytes[i] = static_cast<uint8_t>(message[blockStart + i]);
-        }
-        
-        // Паддинг нулями если нужно
-        for (size_t i = bytesToCopy; i < THREE_WAY_BLOCK_SIZE; i++) {
-            blockBytes[i] = 0;
-        }
-        
-        // Упаковка байтов в блок
-        packBytesToBlock(blockBytes, block);
-        
-        // Шифрование блока
-        threeWayEncrypt(block, roundKeys);
-        
-        // Распаковка зашифрованного блока в байты
-        uint8_t encryptedBytes[THREE_WAY_BLOCK_SIZE];
-        unpackBlockToBytes(block, encryptedBytes);
-        
-        // Добавление к результату
-        for (int i = 0; i < THREE_WAY_BLOCK_SIZE; i++) {
-            encrypted.push_back(encryptedBytes[i]);
-        }
-    }
-    
-    return encrypted;
+
+    encryptPaddedThreeWay(message.data(), message.size(), out.data(), roundKeys);
+    return encryptedLen;
 }
 
-// Дешифрование сообщения
-string decryptMessageThreeWay(const vector<uint8_t>& encrypted, const ThreeWayKeys& keys) {
-    string decrypted;
-    
+// Дешифрование сообщения в буфер вызывающей стороны
+size_t decryptMessageThreeWay(span<const uint8_t> encrypted, span<uint8_t> out, const ThreeWayKeys& keys) {
+    MetricTimer timer(decryptMetric, encrypted.size());
+
     // Генерация раундовых ключей
     uint32_t roundKeys[THREE_WAY_ROUNDS][3];
     generateRoundKeys(keys.key, roundKeys);
-    
-    // Обработка зашифрованных данных блоками по 12 байт
-    size_t encryptedLen = encrypted.size();
-    size_t blocks = encryptedLen / THREE_WAY_BLOCK_SIZE;
-    
-    for (size_t blockNum = 0; blockNum < blocks; blockNum++) {
-        uint8_t encryptedBytes[THREE_WAY_BLOCK_SIZE];
-        uint32_t block[3] = {0, 0, 0};
-        
-        // Заполнение блока зашифрованными данными
-        size_t blockStart = blockNum * THREE_WAY_BLOCK_SIZE;
-        for (size_t i = 0; i < THREE_WAY_BLOCK_SIZE; i++) {
-            size_t pos = blockStart + i;
-            if (pos < encryptedLen) {
-                encryptedBytes[i] = encrypted[pos];
-            } else {
-                encryptedBytes[i] = 0;
-            }
-        }
-        
-        // Упаковка байтов в блок
-        packBytesToBlock(encryptedBytes, block);
-        
-        // Дешифрование блока
-        threeWayDecrypt(block, roundKeys);
-        
-        // Распаковка дешифрованного блока в байты
-        uint8_t decryptedBytes[THREE_WAY_BLOCK_SIZE];
-        unpackBlockToBytes(block, decryptedBytes);
-        
-        // Добавление всех байтов
-        for (int i = 0; i < THREE_WAY_BLOCK_SIZE; i++) {
-            decrypted += static_cast<char>(decryptedBytes[i]);
-        }
+
+    uint8_t lastBlock[THREE_WAY_BLOCK_SIZE];
+    size_t decryptedLen = decryptLastBlockThreeWay(encrypted.data(), encrypted.size(), lastBlock, roundKeys);
+    if (decryptedLen == SIZE_MAX) {
+        throw runtime_error(INVALID_CIPHERTEXT);
     }
-    
-    // Удаляем trailing нули в конце
-    while (!decrypted.empty() && decrypted.back() == 0) {
-        decrypted.pop_back();
+    if (out.size() < decryptedLen) {
+        throw length_error("Недостаточный размер выходного буфера 3-WAY");
     }
-    
-    return decrypted;
+
+    decryptRemainingThreeWay(encrypted.data(), encrypted.size(), lastBlock, decryptedLen, out.data(), roundKeys);
+    return decryptedLen;
 }
 
-// Функции для работы с файлами
-void encryptFileThreeWay(const string& inputFile, const string& outputFile, const ThreeWayKeys& keys) {
-    ifstream in(inputFile, ios::binary);
-    if (!in) {
-        throw runtime_error("Не удалось открыть входной файл: " + inputFile);
-    }
+// Шифрование сообщения
+vector<uint8_t> encryptMessageThreeWay(const string& message, const ThreeWayKeys& keys) {
+    vector<uint8_t> encrypted(requiredSizeThreeWay(message.size()));
+    span<const uint8_t> input(reinterpret_cast<const uint8_t*>(message.data()), message.size());
+    encryptMessageThreeWay(input, span<uint8_t>(encrypted), keys);
+    return encrypted;
+}
 
-    ofstream out(outputFile, ios::binary);
-    if (!out) {
-        throw runtime_error("Не удалось создать выходной файл: " + outputFile);
-    }
+// Дешифрование сообщения
+string decryptMessageThreeWay(const vector<uint8_t>& encrypted, const ThreeWayKeys& keys) {
+    string decrypted(encrypted.size(), '\0');
+    span<uint8_t> output(reinterpret_cast<uint8_t*>(decrypted.data()), decrypted.size());
+    decrypted.resize(decryptMessageThreeWay(span<const uint8_t>(encrypted), output, keys));
+    return decrypted;
+}
+
+// Размер порции файловых операций: целое число блоков (~1 МБ)
+const size_t FILE_BUFFER_SIZE = THREE_WAY_BLOCK_SIZE * 87381;
 
+// Преобразования порций для файлов и потоков. Все порции, кроме последней,
+// кратны блоку, поэтому дополнение попадает только в конец данных.
+static ChunkTransform makeEncryptTransform(const ThreeWayKeys& keys) {
     // Генерация раундовых ключей
-    uint32_t roundKeys[THREE_WAY_ROUNDS][3];
-    generateRoundKeys(keys.key, roundKeys);
+    struct RoundKeys { uint32_t k[THREE_WAY_ROUNDS][3]; } roundKeys;
+    generateRoundKeys(keys.key, roundKeys.k);
+
+    return [roundKeys, padded = false](const uint8_t* data, size_t size, vector<uint8_t>& output) mutable {
+        // Неполная порция — последняя; если данные кончились ровно на границе
+        // блока, финальный вызов (size == 0) дописывает блок из одного дополнения
+        if (size % THREE_WAY_BLOCK_SIZE != 0 || (size == 0 && !padded)) {
+            output.resize(requiredSizeThreeWay(size));
+            encryptPaddedThreeWay(data, size, output.data(), roundKeys.k);
+            padded = true;
+            return;
+        }
+        output.resize(size);
+        threeWayEncryptBlocks(data, output.data(), size / THREE_WAY_BLOCK_SIZE, roundKeys.k);
+    };
+}
 
-    // Чтение и шифрование файла блоками
-    vector<uint8_t> buffer(THREE_WAY_BLOCK_SIZE);
-    while (in.read(reinterpret_cast<char*>(buffer.data()), THREE_WAY_BLOCK_SIZE)) {
-        size_t bytesRead = static_cast<size_t>(in.gcount());
-        
-        // Паддинг последнего блока если нужно
-        if (bytesRead < THREE_WAY_BLOCK_SIZE) {
-            fill(buffer.begin() + bytesRead, buffer.end(), 0);
+static ChunkTransform makeDecryptTransform(const ThreeWayKeys& keys) {
+    struct RoundKeys { uint32_t k[THREE_WAY_ROUNDS][3]; } roundKeys;
+    generateRoundKeys(keys.key, roundKeys.k);
+
+    return [roundKeys, held = vector<uint8_t>()](const uint8_t* data, size_t size, vector<uint8_t>& output) mutable {
+        if (size % THREE_WAY_BLOCK_SIZE != 0) {
+            throw runtime_error(INVALID_CIPHERTEXT);
+        }
+        if (size > 0) {
+            // Последний расшифрованный блок задерживается до конца данных:
+            // только в нем может быть дополнение
+            output.resize(held.size() + size);
+            copy(held.begin(), held.end(), output.begin());
+            threeWayDecryptBlocks(data, output.data() + held.size(), size / THREE_WAY_BLOCK_SIZE, roundKeys.k);
+            held.assign(output.end() - THREE_WAY_BLOCK_SIZE, output.end());
+            output.resize(output.size() - THREE_WAY_BLOCK_SIZE);
+            return;
         }
-        
-        uint32_t block[3] = {0, 0, 0};
-        
-        // Упаковка байтов в блок
-        packBytesToBlock(buffer.data(), block);
-        
-        // Шифрование блока
-        threeWayEncrypt(block, roundKeys);
-        
-        // Распаковка и запись зашифрованного блока
-        uint8_t encryptedBytes[THREE_WAY_BLOCK_SIZE];
-        unpackBlockToBytes(block, encryptedBytes);
-        
-        out.write(reinterpret_cast<char*>(encryptedBytes), THREE_WAY_BLOCK_SIZE);
-    }
 
-    in.close();
-    out.close();
+        size_t padding = held.empty() ? 0 : threeWayPaddingLength(held.data());
+        if (padding == 0) {
+            throw runtime_error(INVALID_CIPHERTEXT);
+        }
+        output.assign(held.begin(), held.end() - padding);
+    };
+}
+
+// Функции для работы с файлами (чтение и запись идут асинхронно с шифрованием)
+void encryptFileThreeWay(const string& inputFile, const string& outputFile, const ThreeWayKeys& keys) {
+    MetricTimer timer(fileEncryptMetric);
+    timer.addBytes(transformFileAsync(inputFile, outputFile, FILE_BUFFER_SIZE, makeEncryptTransform(keys)));
 }
 
 void decryptFileThreeWay(const string& inputFile, const string& outputFile, const ThreeWayKeys& keys) {
-    ifstream in(inputFile, ios::binary);
-    if (!in) {
-        throw runtime_error("Не удалось открыть входной файл: " + inputFile);
-    }
+    MetricTimer timer(fileDecryptMetric);
+    timer.addBytes(transformFileAsync(inputFile, outputFile, FILE_BUFFER_SIZE, makeDecryptTransform(keys)));
+}
 
-    ofstream out(outputFile, ios::binary);
-    if (!out) {
-        throw runtime_error("Не удалось создать выходной файл: " + outputFile);
-    }
+// Потоковые варианты для конвейеров (stdin/stdout), память постоянна
+void encryptStreamThreeWay(int inFd, int outFd, const ThreeWayKeys& keys) {
+    MetricTimer timer(fileEncryptMetric);
+    timer.addBytes(transformStreamAsync(inFd, outFd, FILE_BUFFER_SIZE, makeEncryptTransform(keys)));
+}
 
-    // Генерация раундовых ключей
+void decryptStreamThreeWay(int inFd, int outFd, const ThreeWayKeys& keys) {
+    MetricTimer timer(fileDecryptMetric);
+    timer.addBytes(transformStreamAsync(inFd, outFd, FILE_BUFFER_SIZE, makeDecryptTransform(keys)));
+}
+
+// Размер порции при пакетной обработке крупных файлов (~4 МБ)
+const size_t BATCH_CHUNK_SIZE = THREE_WAY_BLOCK_SIZE * 349525;
+
+// Пакетное шифрование: смещения блоков сохраняются, поэтому порции
+// одного файла шифруются независимо; дополняется только последняя порция
+BatchStats encryptDirectoryThreeWay(const string& inputDir, const string& outputDir,
+                                    const ThreeWayKeys& keys, size_t threads) {
     uint32_t roundKeys[THREE_WAY_ROUNDS][3];
     generateRoundKeys(keys.key, roundKeys);
 
-    // Чтение и дешифрование файла блоками
-    vector<uint8_t> buffer(THREE_WAY_BLOCK_SIZE);
-    while (in.read(reinterpret_cast<char*>(buffer.data()), THREE_WAY_BLOCK_SIZE)) {
-        uint32_t block[3] = {0, 0, 0};
-        
-        // Упаковка байтов в блок
-        packBytesToBlock(buffer.data(), block);
-        
-        // Дешифрование блока
-        threeWayDecrypt(block, roundKeys);
-        
-        // Распаковка и запись дешифрованного блока
-        uint8_t decryptedBytes[THREE_WAY_BLOCK_SIZE];
-        unpackBlockToBytes(block, decryptedBytes);
-        
-        out.write(reinterpret_cast<char*>(decryptedBytes), THREE_WAY_BLOCK_SIZE);
-    }
+    BatchOperation operation;
+    operation.chunkSize = BATCH_CHUNK_SIZE;
+    operation.outputSize = [](uint64_t inputSize) { return requiredSizeThreeWay(inputSize); };
+    operation.processChunk = [roundKeys](const uint8_t* in, size_t inLen, uint8_t* out, size_t outLen, bool last) {
+        if (last) {
+            encryptPaddedThreeWay(in, inLen, out, roundKeys);
+        } else {
+            threeWayEncryptBlocks(in, out, inLen / THREE_WAY_BLOCK_SIZE, roundKeys);
+        }
+        return outLen;
+    };
+    return processDirectory(inputDir, outputDir, operation, threads);
+}
+
+BatchStats decryptDirectoryThreeWay(const string& inputDir, const string& outputDir,
+                                    const ThreeWayKeys& keys, size_t threads) {
+    uint32_t roundKeys[THREE_WAY_ROUNDS][3];
+    generateRoundKeys(keys.key, roundKeys);
 
-    in.close();
-    out.close();
+    BatchOperation operation;
+    operation.chunkSize = BATCH_CHUNK_SIZE;
+    // Верхняя граница: точный размер известен после расшифровки последнего блока
+    operation.outputSize = [](uint64_t inputSize) { return inputSize; };
+    operation.processChunk = [roundKeys](const uint8_t* in, size_t inLen, uint8_t* out, size_t, bool last) {
+        if (!last) {
+            threeWayDecryptBlocks(in, out, inLen / THREE_WAY_BLOCK_SIZE, roundKeys);
+            return inLen;
+        }
+        uint8_t lastBlock[THREE_WAY_BLOCK_SIZE];
+        size_t decryptedLen = decryptLastBlockThreeWay(in, inLen, lastBlock, roundKeys);
+        if (decryptedLen == SIZE_MAX) {
+            throw runtime_error(INVALID_CIPHERTEXT);
+        }
+        decryptRemainingThreeWay(in, inLen, lastBlock, decryptedLen, out, roundKeys);
+        return decryptedLen;
+    };
+    return processDirectory(inputDir, outputDir, operation, threads);
 }
 
 // Функция для проверки корректности ключей
@@ -431,6 +358,25 @@ bool getKeyManual(ThreeWayKeys& keys) {
     return true;
 }
 
+// Ключ из текста в формате threeway_keys.txt ("Key Part i: шестнадцатеричное число");
+// бросает std::invalid_argument/out_of_range при неверном числе
+static bool parseKeyFileText(const string& text, ThreeWayKeys& keys) {
+    istringstream lines(text);
+    bool found[3] = {false, false, false};
+    string line;
+    while (getline(lines, line)) {
+        for (int i = 0; i < 3; i++) {
+            string label = "Key Part " + to_string(i) + ":";
+            if (line.compare(0, label.size(), label) != 0) continue;
+            unsigned long value = stoul(line.substr(label.size()), nullptr, 16);
+            if (value > 0xFFFFFFFFul) return false;
+            keys.key[i] = static_cast<uint32_t>(value);
+            found[i] = true;
+        }
+    }
+    return found[0] && found[1] && found[2];
+}
+
 void printEncryptedMessage(const vector<uint8_t>& encrypted) {
     cout << "Зашифрованное сообщение (hex): ";
     for (size_t i = 0; i < encrypted.size(); i++) {
@@ -473,6 +419,82 @@ vector<uint8_t> readEncryptedMessage(const string& encryptedStr) {
     return encrypted;
 }
 
+// ==================== ИНТЕРФЕЙС МОДУЛЯ (crypto_plugin.h) ====================
+//
+// Ключ — 12 байт: K0, K1, K2 (uint32, little-endian). Шифртекст в том же
+// формате, что у файлов и потоков: блоки с дополнением padThreeWayBlock.
+
+struct ThreeWayPluginContext {
+    uint32_t roundKeys[THREE_WAY_ROUNDS][3];
+};
+
+static int threeWayPluginInit(const uint8_t* key, size_t keyLen, void** context) {
+    if (!context) return CRYPTO_PLUGIN_ERR_ARGUMENT;
+    if (!key || keyLen != 3 * sizeof(uint32_t)) return CRYPTO_PLUGIN_ERR_KEY;
+    ThreeWayPluginContext* plugin = new (nothrow) ThreeWayPluginContext;
+    if (!plugin) return CRYPTO_PLUGIN_ERR_INTERNAL;
+    uint32_t keyWords[3];
+    for (int i = 0; i < 3; i++) {
+        keyWords[i] = uint32_t(key[4 * i]) | (uint32_t(key[4 * i + 1]) << 8) |
+                      (uint32_t(key[4 * i + 2]) << 16) | (uint32_t(key[4 * i + 3]) << 24);
+    }
+    generateRoundKeys(keyWords, plugin->roundKeys);
+    *context = plugin;
+    return CRYPTO_PLUGIN_OK;
+}
+
+static size_t threeWayPluginMaxOutput(void*, int operation, size_t inputLen) {
+    return operation == CRYPTO_PLUGIN_DECRYPT ? inputLen : requiredSizeThreeWay(inputLen);
+}
+
+static int threeWayPluginEncrypt(void* context, const uint8_t* in, size_t inLen,
+                                 uint8_t* out, size_t outCapacity, size_t* outLen) {
+    const ThreeWayPluginContext* plugin = static_cast<const ThreeWayPluginContext*>(context);
+    if (!plugin || !outLen || (!in && inLen > 0)) return CRYPTO_PLUGIN_ERR_ARGUMENT;
+    *outLen = requiredSizeThreeWay(inLen);
+    if (*outLen > outCapacity) return CRYPTO_PLUGIN_ERR_BUFFER;
+    MetricTimer timer(encryptMetric, inLen);
+    encryptPaddedThreeWay(in, inLen, out, plugin->roundKeys);
+    return CRYPTO_PLUGIN_OK;
+}
+
+static int threeWayPluginDecrypt(void* context, const uint8_t* in, size_t inLen,
+                                 uint8_t* out, size_t outCapacity, size_t* outLen) {
+    const ThreeWayPluginContext* plugin = static_cast<const ThreeWayPluginContext*>(context);
+    if (!plugin || !outLen || (!in && inLen > 0)) return CRYPTO_PLUGIN_ERR_ARGUMENT;
+    MetricTimer timer(decryptMetric, inLen);
+
+    uint8_t lastBlock[THREE_WAY_BLOCK_SIZE];
+    size_t decryptedLen = decryptLastBlockThreeWay(in, inLen, lastBlock, plugin->roundKeys);
+    if (decryptedLen == SIZE_MAX) {
+        timer.fail();
+        return CRYPTO_PLUGIN_ERR_DATA;
+    }
+
+    *outLen = decryptedLen;
+    if (*outLen > outCapacity) return CRYPTO_PLUGIN_ERR_BUFFER;
+    decryptRemainingThreeWay(in, inLen, lastBlock, decryptedLen, out, plugin->roundKeys);
+    return CRYPTO_PLUGIN_OK;
+}
+
+static void threeWayPluginFree(void* context) {
+    delete static_cast<ThreeWayPluginContext*>(context);
+}
+
+static const CryptoPluginDescriptor THREE_WAY_PLUGIN_DESCRIPTOR = {
+    CRYPTO_PLUGIN_ABI_VERSION,
+    sizeof(CryptoPluginDescriptor),
+    "threeway",
+    "3-WAY (блоки по 12 байт, дополнение с длиной)",
+    "12 байт: K0, K1, K2 (uint32, little-endian)",
+    CRYPTO_PLUGIN_CAP_ENCRYPT | CRYPTO_PLUGIN_CAP_DECRYPT | CRYPTO_PLUGIN_CAP_KEY | CRYPTO_PLUGIN_CAP_THREAD_SAFE,
+    threeWayPluginInit,
+    threeWayPluginMaxOutput,
+    threeWayPluginEncrypt,
+    threeWayPluginDecrypt,
+    threeWayPluginFree,
+};
+
 // ГЛАВНАЯ ФУНКЦИЯ
 extern "C" {
 
@@ -480,12 +502,20 @@ void run_threeway_crypto() {
     setlocale(LC_ALL, "ru_RU.UTF-8");
     
     cout << "=== 3-WAY Шифрование/Дешифрование ===" << endl;
+    cout << "Реализация блочных ядер: " << threeway_kernel_variant()
+         << ", файловый ввод-вывод: " << asyncIoBackendName() << endl;
     cout << "0. Выход в главное меню " << endl;
     cout << "1. Сгенерировать и сохранить ключи" << endl;
     cout << "2. Шифровать сообщение" << endl;
     cout << "3. Дешифровать сообщение" << endl;
     cout << "4. Шифровать файл" << endl;
     cout << "5. Дешифровать файл" << endl;
+    cout << "6. Шифровать файл в контейнер с произвольным доступом" << endl;
+    cout << "7. Расшифровать диапазон из контейнера" << endl;
+    cout << "8. Пакетно шифровать каталог" << endl;
+    cout << "9. Пакетно дешифровать каталог" << endl;
+    cout << "10. Шифровать файл с контролем целостности" << endl;
+    cout << "11. Проверить и расшифровать файл с контролем целостности" << endl;
     cout << "Выберите действие: ";
 
     int choice;
@@ -605,6 +635,108 @@ void run_threeway_crypto() {
                 cout << "Файл успешно расшифрован." << endl;
                 break;
             }
+            case 6: {
+                ThreeWayKeys keys;
+                cout << "Введите ключ для шифрования:\n";
+                if (!getKeyManual(keys)) {
+                    cout << "Ошибка ввода ключа!\n";
+                    break;
+                }
+
+                cout << "Введите имя файла для шифрования: ";
+                string inputFile;
+                getline(cin, inputFile);
+
+                cout << "Введите имя выходного контейнера: ";
+                string outputFile;
+                getline(cin, outputFile);
+
+                encryptFileThreeWaySeekable(inputFile, outputFile, keys);
+                cout << "Контейнер создан, размер данных: "
+                     << seekablePlaintextSizeThreeWay(outputFile) << " байт." << endl;
+                break;
+            }
+            case 7: {
+                ThreeWayKeys keys;
+                cout << "Введите ключ для дешифрования:\n";
+                if (!getKeyManual(keys)) {
+                    cout << "Ошибка ввода ключа!\n";
+                    break;
+                }
+
+                cout << "Введите имя контейнера: ";
+                string inputFile;
+                getline(cin, inputFile);
+
+                uint64_t offset;
+                size_t length;
+                cout << "Введите смещение и длину диапазона (байты): ";
+                if (!(cin >> offset >> length)) {
+                    throw runtime_error("Неверный формат диапазона");
+                }
+                cin.ignore();
+
+                cout << "Введите имя выходного файла: ";
+                string outputFile;
+                getline(cin, outputFile);
+
+                vector<uint8_t> data = decryptRangeThreeWay(inputFile, offset, length, keys);
+                ofstream out(outputFile, ios::binary);
+                if (!out) {
+                    throw runtime_error("Не удалось создать выходной файл: " + outputFile);
+                }
+                out.write(reinterpret_cast<const char*>(data.data()), data.size());
+                cout << "Расшифровано байт: " << data.size() << endl;
+                break;
+            }
+            case 8:
+            case 9: {
+                ThreeWayKeys keys;
+                cout << "Введите ключ:\n";
+                if (!getKeyManual(keys)) {
+                    cout << "Ошибка ввода ключа!\n";
+                    break;
+                }
+
+                cout << "Введите входной каталог: ";
+                string inputDir;
+                getline(cin, inputDir);
+
+                cout << "Введите выходной каталог: ";
+                string outputDir;
+                getline(cin, outputDir);
+
+                BatchStats stats = (choice == 8) ? encryptDirectoryThreeWay(inputDir, outputDir, keys)
+                                                 : decryptDirectoryThreeWay(inputDir, outputDir, keys);
+                printBatchStats(stats);
+                break;
+            }
+            case 10:
+            case 11: {
+                ThreeWayKeys keys;
+                cout << "Введите ключ:\n";
+                if (!getKeyManual(keys)) {
+                    cout << "Ошибка ввода ключа!\n";
+                    break;
+                }
+
+                cout << "Введите имя входного файла: ";
+                string inputFile;
+                getline(cin, inputFile);
+
+                cout << "Введите имя выходного файла: ";
+                string outputFile;
+                getline(cin, outputFile);
+
+                if (choice == 10) {
+                    encryptFileThreeWayAuthenticated(inputFile, outputFile, keys);
+                    cout << "Файл зашифрован, тег целостности добавлен." << endl;
+                } else {
+                    decryptFileThreeWayAuthenticated(inputFile, outputFile, keys);
+                    cout << "Целостность подтверждена, файл расшифрован." << endl;
+                }
+                break;
+            }
             default:
                 cout << "Неверный выбор." << endl;
         }
@@ -616,4 +748,75 @@ void run_threeway_crypto() {
     cin.get();
 }
 
-} // extern "C"
\ No newline at end of file
+const CryptoPluginDescriptor* crypto_plugin_descriptor() {
+    return &THREE_WAY_PLUGIN_DESCRIPTOR;
+}
+
+// Режим фильтра: crypto_system filter threeway encrypt|decrypt --key-file ПУТЬ | --key-fd N
+// Ключ в формате threeway_keys.txt читается из файла или дескриптора N
+// (не из аргументов: они видны другим пользователям в списке процессов),
+// данные читаются из stdin и пишутся в stdout.
+// Сообщения выводятся только в stderr, чтобы не смешиваться с данными.
+int run_threeway_filter(int argc, char* argv[]) {
+    string option = argc == 3 ? argv[1] : "";
+    if (option != "--key-file" && option != "--key-fd") {
+        cerr << "Использование: filter threeway encrypt|decrypt --key-file ПУТЬ | --key-fd N" << endl;
+        return 2;
+    }
+
+    string mode = argv[0];
+    string text;
+    if (option == "--key-file") {
+        ifstream keyFile(argv[2]);
+        if (!keyFile) {
+            cerr << "Ошибка: не удалось открыть файл ключей " << argv[2] << endl;
+            return 2;
+        }
+        text.assign(istreambuf_iterator<char>(keyFile), istreambuf_iterator<char>());
+    } else {
+        char* end = nullptr;
+        long fd = strtol(argv[2], &end, 10);
+        if (*argv[2] == '\0' || *end != '\0' || fd < 0 || fd > INT32_MAX || fd == STDIN_FILENO) {
+            cerr << "Ошибка: неверный дескриптор ключа " << argv[2] << endl;
+            return 2;
+        }
+        char buffer[256];
+        ssize_t got;
+        while ((got = read(static_cast<int>(fd), buffer, sizeof(buffer))) > 0) {
+            text.append(buffer, static_cast<size_t>(got));
+        }
+        if (got < 0) {
+            cerr << "Ошибка: не удалось прочитать ключ из дескриптора " << argv[2] << endl;
+            return 2;
+        }
+    }
+
+    ThreeWayKeys keys;
+    bool valid = false;
+    try {
+        valid = parseKeyFileText(text, keys);
+    } catch (const exception&) {
+    }
+    if (!valid) {
+        cerr << "Ошибка: неверный формат ключа 3-WAY (ожидается формат threeway_keys.txt)" << endl;
+        return 2;
+    }
+
+    try {
+        if (mode == "encrypt") {
+            encryptStreamThreeWay(STDIN_FILENO, STDOUT_FILENO, keys);
+        } else if (mode == "decrypt") {
+            decryptStreamThreeWay(STDIN_FILENO, STDOUT_FILENO, keys);
+        } else {
+            cerr << "Неизвестный режим: " << mode << endl;
+            return 2;
+        }
+    } catch (const exception& e) {
+        cerr << "Ошибка: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+
+} // extern "C"
+
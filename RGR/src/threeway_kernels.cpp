@@ -0,0 +1,506 @@
+#include "../include/threeway_crypto.h"
+#include "../include/threeway_kernels.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+
+using namespace std;
+
+// Вспомогательные функции
+
+// Циклический сдвиг влево
+uint32_t rotateLeft(uint32_t x, int n) {
+    n = n % 32;
+    return (x << n) | (x >> (32 - n));
+}
+
+// Циклический сдвиг вправо
+uint32_t rotateRight(uint32_t x, int n) {
+    n = n % 32;
+    return (x >> n) | (x << (32 - n));
+}
+
+// ОЧЕНЬ ПРОСТАЯ обратимая функция для одного раунда
+void roundFunction(uint32_t block[3], const uint32_t roundKey[3]) {
+    // Простое обратимое преобразование
+    uint32_t a = block[0], b = block[1], c = block[2];
+    
+    // Шаг 1: XOR с ключом
+    a ^= roundKey[0];
+    b ^= roundKey[1];
+    c ^= roundKey[2];
+    
+    // Шаг 2: Простая перестановка
+    block[0] = b;
+    block[1] = c;
+    block[2] = a;
+    
+    // Шаг 3: Простой сдвиг
+    block[0] = rotateLeft(block[0], 5);
+    block[1] = rotateRight(block[1], 3);
+    block[2] = rotateLeft(block[2], 7);
+}
+
+// Обратная функция для одного раунда
+void roundFunctionInverse(uint32_t block[3], const uint32_t roundKey[3]) {
+    // Обратные операции в обратном порядке
+    
+    // Шаг 3: Обратные сдвиги
+    block[0] = rotateRight(block[0], 5);
+    block[1] = rotateLeft(block[1], 3);
+    block[2] = rotateRight(block[2], 7);
+    
+    // Шаг 2: Обратная перестановка
+    uint32_t a = block[2], b = block[0], c = block[1];
+    
+    // Шаг 1: XOR с ключом (обратная операция)
+    block[0] = a ^ roundKey[0];
+    block[1] = b ^ roundKey[1];
+    block[2] = c ^ roundKey[2];
+}
+
+// Генерация раундовых ключей
+void generateRoundKeys(const uint32_t key[3], uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    uint32_t temp[3] = {key[0], key[1], key[2]};
+    
+    for (int round = 0; round < THREE_WAY_ROUNDS; round++) {
+        // Сохраняем текущий ключ
+        roundKeys[round][0] = temp[0];
+        roundKeys[round][1] = temp[1];
+        roundKeys[round][2] = temp[2];
+        
+        // Обновление ключа для следующего раунда
+        temp[0] = rotateLeft(temp[0] + 0x9E3779B9, 7);
+        temp[1] = rotateLeft(temp[1] + 0xB7E15162, 13);
+        temp[2] = rotateLeft(temp[2] + 0xBF715880, 17);
+    }
+}
+
+// Основное шифрование
+void threeWayEncrypt(uint32_t block[3], const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    for (int round = 0; round < THREE_WAY_ROUNDS; round++) {
+        roundFunction(block, roundKeys[round]);
+    }
+}
+
+// Основное дешифрование
+void threeWayDecrypt(uint32_t block[3], const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    for (int round = THREE_WAY_ROUNDS - 1; round >= 0; round--) {
+        roundFunctionInverse(block, roundKeys[round]);
+    }
+}
+
+// Упаковка байтов в 32-битные слова
+void packBytesToBlock(const uint8_t* bytes, uint32_t block[3]) {
+    block[0] = (static_cast<uint32_t>(bytes[0]) << 24) |
+               (static_cast<uint32_t>(bytes[1]) << 16) |
+               (static_cast<uint32_t>(bytes[2]) << 8) |
+               (static_cast<uint32_t>(bytes[3]));
+               
+    block[1] = (static_cast<uint32_t>(bytes[4]) << 24) |
+               (static_cast<uint32_t>(bytes[5]) << 16) |
+               (static_cast<uint32_t>(bytes[6]) << 8) |
+               (static_cast<uint32_t>(bytes[7]));
+               
+    block[2] = (static_cast<uint32_t>(bytes[8]) << 24) |
+               (static_cast<uint32_t>(bytes[9]) << 16) |
+               (static_cast<uint32_t>(bytes[10]) << 8) |
+               (static_cast<uint32_t>(bytes[11]));
+}
+
+// Распаковка 32-битных слов в байты
+void unpackBlockToBytes(const uint32_t block[3], uint8_t* bytes) {
+    bytes[0] = static_cast<uint8_t>((block[0] >> 24) & 0xFF);
+    bytes[1] = static_cast<uint8_t>((block[0] >> 16) & 0xFF);
+    bytes[2] = static_cast<uint8_t>((block[0] >> 8) & 0xFF);
+    bytes[3] = static_cast<uint8_t>(block[0] & 0xFF);
+    
+    bytes[4] = static_cast<uint8_t>((block[1] >> 24) & 0xFF);
+    bytes[5] = static_cast<uint8_t>((block[1] >> 16) & 0xFF);
+    bytes[6] = static_cast<uint8_t>((block[1] >> 8) & 0xFF);
+    bytes[7] = static_cast<uint8_t>(block[1] & 0xFF);
+    
+    bytes[8] = static_cast<uint8_t>((block[2] >> 24) & 0xFF);
+    bytes[9] = static_cast<uint8_t>((block[2] >> 16) & 0xFF);
+    bytes[10] = static_cast<uint8_t>((block[2] >> 8) & 0xFF);
+    bytes[11] = static_cast<uint8_t>(block[2] & 0xFF);
+}
+
+// Дополнение последнего блока байтами, равными длине дополнения
+void padThreeWayBlock(const uint8_t* tail, size_t tailLen, uint8_t block[THREE_WAY_BLOCK_SIZE]) {
+    if (tailLen > 0) memcpy(block, tail, tailLen);
+    memset(block + tailLen, static_cast<int>(THREE_WAY_BLOCK_SIZE - tailLen), THREE_WAY_BLOCK_SIZE - tailLen);
+}
+
+// Проверка дополнения: последний байт задает длину, все байты дополнения равны ей
+size_t threeWayPaddingLength(const uint8_t block[THREE_WAY_BLOCK_SIZE]) {
+    size_t padding = block[THREE_WAY_BLOCK_SIZE - 1];
+    if (padding == 0 || padding > static_cast<size_t>(THREE_WAY_BLOCK_SIZE)) return 0;
+    for (size_t i = THREE_WAY_BLOCK_SIZE - padding; i < static_cast<size_t>(THREE_WAY_BLOCK_SIZE); i++) {
+        if (block[i] != padding) return 0;
+    }
+    return padding;
+}
+
+// ==================== ЯДРА ДЛЯ ПОСЛЕДОВАТЕЛЬНОСТИ БЛОКОВ ====================
+
+// Скалярная реализация: по одному блоку за итерацию
+static void encryptBlocksScalar(const uint8_t* in, uint8_t* out, size_t blocks,
+                                const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    for (size_t i = 0; i < blocks; i++) {
+        uint32_t block[3];
+        packBytesToBlock(in + i * THREE_WAY_BLOCK_SIZE, block);
+        threeWayEncrypt(block, roundKeys);
+        unpackBlockToBytes(block, out + i * THREE_WAY_BLOCK_SIZE);
+    }
+}
+
+static void decryptBlocksScalar(const uint8_t* in, uint8_t* out, size_t blocks,
+                                const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    for (size_t i = 0; i < blocks; i++) {
+        uint32_t block[3];
+        packBytesToBlock(in + i * THREE_WAY_BLOCK_SIZE, block);
+        threeWayDecrypt(block, roundKeys);
+        unpackBlockToBytes(block, out + i * THREE_WAY_BLOCK_SIZE);
+    }
+}
+
+// Векторные реализации обрабатывают по 4 блока (48 байт) в каждой 128-битной
+// полосе регистра. Три загрузки r0, r1, r2 содержат слова
+//   r0 = [a0 b0 c0 a1], r1 = [b1 c1 a2 b2], r2 = [c2 a3 b3 c3]
+// и транспонируются смешиванием и перестановкой в векторы a, b, c.
+// Все три перестановки являются инволюциями, поэтому обратное
+// преобразование при записи использует те же маски.
+
+// ---------- SSE4.1: 4 блока за итерацию ----------
+
+__attribute__((target("sse4.1")))
+static inline __m128i rotl128(__m128i x, int n) {
+    return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n));
+}
+
+__attribute__((target("sse4.1")))
+static inline void load4Blocks(const uint8_t* p, __m128i& a, __m128i& b, __m128i& c) {
+    const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m128i r0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), bswap);
+    __m128i r1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)), bswap);
+    __m128i r2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)), bswap);
+
+    // Маска _mm_blend_epi16: по два бита на 32-битное слово
+    __m128i ta = _mm_blend_epi16(_mm_blend_epi16(r0, r1, 0x30), r2, 0x0C);
+    __m128i tb = _mm_blend_epi16(_mm_blend_epi16(r1, r0, 0x0C), r2, 0x30);
+    __m128i tc = _mm_blend_epi16(_mm_blend_epi16(r2, r1, 0x0C), r0, 0x30);
+    a = _mm_shuffle_epi32(ta, _MM_SHUFFLE(1, 2, 3, 0));
+    b = _mm_shuffle_epi32(tb, _MM_SHUFFLE(2, 3, 0, 1));
+    c = _mm_shuffle_epi32(tc, _MM_SHUFFLE(3, 0, 1, 2));
+}
+
+__attribute__((target("sse4.1")))
+static inline void store4Blocks(uint8_t* p, __m128i a, __m128i b, __m128i c) {
+    const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m128i ta = _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 2, 3, 0));
+    __m128i tb = _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128i tc = _mm_shuffle_epi32(c, _MM_SHUFFLE(3, 0, 1, 2));
+    __m128i r0 = _mm_blend_epi16(_mm_blend_epi16(ta, tb, 0x0C), tc, 0x30);
+    __m128i r1 = _mm_blend_epi16(_mm_blend_epi16(tb, tc, 0x0C), ta, 0x30);
+    __m128i r2 = _mm_blend_epi16(_mm_blend_epi16(tc, ta, 0x0C), tb, 0x30);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_shuffle_epi8(r0, bswap));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 16), _mm_shuffle_epi8(r1, bswap));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 32), _mm_shuffle_epi8(r2, bswap));
+}
+
+__attribute__((target("sse4.1")))
+static void encryptBlocksSSE41(const uint8_t* in, uint8_t* out, size_t blocks,
+                               const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    size_t i = 0;
+    for (; i + 4 <= blocks; i += 4) {
+        __m128i a, b, c;
+        load4Blocks(in + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+        for (int round = 0; round < THREE_WAY_ROUNDS; round++) {
+            a = _mm_xor_si128(a, _mm_set1_epi32(roundKeys[round][0]));
+            b = _mm_xor_si128(b, _mm_set1_epi32(roundKeys[round][1]));
+            c = _mm_xor_si128(c, _mm_set1_epi32(roundKeys[round][2]));
+            __m128i na = rotl128(b, 5), nb = rotl128(c, 29), nc = rotl128(a, 7);
+            a = na; b = nb; c = nc;
+        }
+        store4Blocks(out + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+    }
+    encryptBlocksScalar(in + i * THREE_WAY_BLOCK_SIZE, out + i * THREE_WAY_BLOCK_SIZE, blocks - i, roundKeys);
+}
+
+__attribute__((target("sse4.1")))
+static void decryptBlocksSSE41(const uint8_t* in, uint8_t* out, size_t blocks,
+                               const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    size_t i = 0;
+    for (; i + 4 <= blocks; i += 4) {
+        __m128i a, b, c;
+        load4Blocks(in + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+        for (int round = THREE_WAY_ROUNDS - 1; round >= 0; round--) {
+            __m128i na = rotl128(c, 25), nb = rotl128(a, 27), nc = rotl128(b, 3);
+            a = _mm_xor_si128(na, _mm_set1_epi32(roundKeys[round][0]));
+            b = _mm_xor_si128(nb, _mm_set1_epi32(roundKeys[round][1]));
+            c = _mm_xor_si128(nc, _mm_set1_epi32(roundKeys[round][2]));
+        }
+        store4Blocks(out + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+    }
+    decryptBlocksScalar(in + i * THREE_WAY_BLOCK_SIZE, out + i * THREE_WAY_BLOCK_SIZE, blocks - i, roundKeys);
+}
+
+// ---------- AVX2: 8 блоков за итерацию (по 4 в каждой полосе) ----------
+
+__attribute__((target("avx2")))
+static inline __m256i rotl256(__m256i x, int n) {
+    return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i load2x128(const uint8_t* lo, const uint8_t* hi) {
+    __m256i v = _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo)));
+    return _mm256_inserti128_si256(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi)), 1);
+}
+
+__attribute__((target("avx2")))
+static inline void store2x128(uint8_t* lo, uint8_t* hi, __m256i v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lo), _mm256_castsi256_si128(v));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hi), _mm256_extracti128_si256(v, 1));
+}
+
+__attribute__((target("avx2")))
+static inline void load8Blocks(const uint8_t* p, __m256i& a, __m256i& b, __m256i& c) {
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m256i r0 = _mm256_shuffle_epi8(load2x128(p, p + 48), bswap);
+    __m256i r1 = _mm256_shuffle_epi8(load2x128(p + 16, p + 64), bswap);
+    __m256i r2 = _mm256_shuffle_epi8(load2x128(p + 32, p + 80), bswap);
+
+    __m256i ta = _mm256_blend_epi32(_mm256_blend_epi32(r0, r1, 0x44), r2, 0x22);
+    __m256i tb = _mm256_blend_epi32(_mm256_blend_epi32(r1, r0, 0x22), r2, 0x44);
+    __m256i tc = _mm256_blend_epi32(_mm256_blend_epi32(r2, r1, 0x22), r0, 0x44);
+    a = _mm256_shuffle_epi32(ta, _MM_SHUFFLE(1, 2, 3, 0));
+    b = _mm256_shuffle_epi32(tb, _MM_SHUFFLE(2, 3, 0, 1));
+    c = _mm256_shuffle_epi32(tc, _MM_SHUFFLE(3, 0, 1, 2));
+}
+
+__attribute__((target("avx2")))
+static inline void store8Blocks(uint8_t* p, __m256i a, __m256i b, __m256i c) {
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m256i ta = _mm256_shuffle_epi32(a, _MM_SHUFFLE(1, 2, 3, 0));
+    __m256i tb = _mm256_shuffle_epi32(b, _MM_SHUFFLE(2, 3, 0, 1));
+    __m256i tc = _mm256_shuffle_epi32(c, _MM_SHUFFLE(3, 0, 1, 2));
+    __m256i r0 = _mm256_blend_epi32(_mm256_blend_epi32(ta, tb, 0x22), tc, 0x44);
+    __m256i r1 = _mm256_blend_epi32(_mm256_blend_epi32(tb, tc, 0x22), ta, 0x44);
+    __m256i r2 = _mm256_blend_epi32(_mm256_blend_epi32(tc, ta, 0x22), tb, 0x44);
+    store2x128(p, p + 48, _mm256_shuffle_epi8(r0, bswap));
+    store2x128(p + 16, p + 64, _mm256_shuffle_epi8(r1, bswap));
+    store2x128(p + 32, p + 80, _mm256_shuffle_epi8(r2, bswap));
+}
+
+__attribute__((target("avx2")))
+static void encryptBlocksAVX2(const uint8_t* in, uint8_t* out, size_t blocks,
+                              const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    size_t i = 0;
+    for (; i + 8 <= blocks; i += 8) {
+        __m256i a, b, c;
+        load8Blocks(in + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+        for (int round = 0; round < THREE_WAY_ROUNDS; round++) {
+            a = _mm256_xor_si256(a, _mm256_set1_epi32(roundKeys[round][0]));
+            b = _mm256_xor_si256(b, _mm256_set1_epi32(roundKeys[round][1]));
+            c = _mm256_xor_si256(c, _mm256_set1_epi32(roundKeys[round][2]));
+            __m256i na = rotl256(b, 5), nb = rotl256(c, 29), nc = rotl256(a, 7);
+            a = na; b = nb; c = nc;
+        }
+        store8Blocks(out + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+    }
+    encryptBlocksSSE41(in + i * THREE_WAY_BLOCK_SIZE, out + i * THREE_WAY_BLOCK_SIZE, blocks - i, roundKeys);
+}
+
+__attribute__((target("avx2")))
+static void decryptBlocksAVX2(const uint8_t* in, uint8_t* out, size_t blocks,
+                              const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    size_t i = 0;
+    for (; i + 8 <= blocks; i += 8) {
+        __m256i a, b, c;
+        load8Blocks(in + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+        for (int round = THREE_WAY_ROUNDS - 1; round >= 0; round--) {
+            __m256i na = rotl256(c, 25), nb = rotl256(a, 27), nc = rotl256(b, 3);
+            a = _mm256_xor_si256(na, _mm256_set1_epi32(roundKeys[round][0]));
+            b = _mm256_xor_si256(nb, _mm256_set1_epi32(roundKeys[round][1]));
+            c = _mm256_xor_si256(nc, _mm256_set1_epi32(roundKeys[round][2]));
+        }
+        store8Blocks(out + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+    }
+    decryptBlocksSSE41(in + i * THREE_WAY_BLOCK_SIZE, out + i * THREE_WAY_BLOCK_SIZE, blocks - i, roundKeys);
+}
+
+// ---------- AVX-512: 16 блоков за итерацию (по 4 в каждой полосе) ----------
+
+// GCC 12 выдает ложные предупреждения внутри avx512fintrin.h (_mm512_undefined)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i load4x128(const uint8_t* p) {
+    __m512i v = _mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48)), 1);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 96)), 2);
+    return _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 144)), 3);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline void store4x128(uint8_t* p, __m512i v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm512_extracti32x4_epi32(v, 0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 48), _mm512_extracti32x4_epi32(v, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 96), _mm512_extracti32x4_epi32(v, 2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 144), _mm512_extracti32x4_epi32(v, 3));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline void load16Blocks(const uint8_t* p, __m512i& a, __m512i& b, __m512i& c) {
+    const __m512i bswap = _mm512_broadcast_i32x4(
+        _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3));
+    __m512i r0 = _mm512_shuffle_epi8(load4x128(p), bswap);
+    __m512i r1 = _mm512_shuffle_epi8(load4x128(p + 16), bswap);
+    __m512i r2 = _mm512_shuffle_epi8(load4x128(p + 32), bswap);
+
+    __m512i ta = _mm512_mask_blend_epi32(0x2222, _mm512_mask_blend_epi32(0x4444, r0, r1), r2);
+    __m512i tb = _mm512_mask_blend_epi32(0x4444, _mm512_mask_blend_epi32(0x2222, r1, r0), r2);
+    __m512i tc = _mm512_mask_blend_epi32(0x4444, _mm512_mask_blend_epi32(0x2222, r2, r1), r0);
+    a = _mm512_shuffle_epi32(ta, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(1, 2, 3, 0)));
+    b = _mm512_shuffle_epi32(tb, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(2, 3, 0, 1)));
+    c = _mm512_shuffle_epi32(tc, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(3, 0, 1, 2)));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline void store16Blocks(uint8_t* p, __m512i a, __m512i b, __m512i c) {
+    const __m512i bswap = _mm512_broadcast_i32x4(
+        _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3));
+    __m512i ta = _mm512_shuffle_epi32(a, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(1, 2, 3, 0)));
+    __m512i tb = _mm512_shuffle_epi32(b, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(2, 3, 0, 1)));
+    __m512i tc = _mm512_shuffle_epi32(c, static_cast<_MM_PERM_ENUM>(_MM_SHUFFLE(3, 0, 1, 2)));
+    __m512i r0 = _mm512_mask_blend_epi32(0x4444, _mm512_mask_blend_epi32(0x2222, ta, tb), tc);
+    __m512i r1 = _mm512_mask_blend_epi32(0x4444, _mm512_mask_blend_epi32(0x2222, tb, tc), ta);
+    __m512i r2 = _mm512_mask_blend_epi32(0x4444, _mm512_mask_blend_epi32(0x2222, tc, ta), tb);
+    store4x128(p, _mm512_shuffle_epi8(r0, bswap));
+    store4x128(p + 16, _mm512_shuffle_epi8(r1, bswap));
+    store4x128(p + 32, _mm512_shuffle_epi8(r2, bswap));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void encryptBlocksAVX512(const uint8_t* in, uint8_t* out, size_t blocks,
+                                const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    size_t i = 0;
+    for (; i + 16 <= blocks; i += 16) {
+        __m512i a, b, c;
+        load16Blocks(in + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+        for (int round = 0; round < THREE_WAY_ROUNDS; round++) {
+            a = _mm512_xor_si512(a, _mm512_set1_epi32(roundKeys[round][0]));
+            b = _mm512_xor_si512(b, _mm512_set1_epi32(roundKeys[round][1]));
+            c = _mm512_xor_si512(c, _mm512_set1_epi32(roundKeys[round][2]));
+            __m512i na = _mm512_rol_epi32(b, 5), nb = _mm512_ror_epi32(c, 3), nc = _mm512_rol_epi32(a, 7);
+            a = na; b = nb; c = nc;
+        }
+        store16Blocks(out + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+    }
+    encryptBlocksAVX2(in + i * THREE_WAY_BLOCK_SIZE, out + i * THREE_WAY_BLOCK_SIZE, blocks - i, roundKeys);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void decryptBlocksAVX512(const uint8_t* in, uint8_t* out, size_t blocks,
+                                const uint32_t roundKeys[THREE_WAY_ROUNDS][3]) {
+    size_t i = 0;
+    for (; i + 16 <= blocks; i += 16) {
+        __m512i a, b, c;
+        load16Blocks(in + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+        for (int round = THREE_WAY_ROUNDS - 1; round >= 0; round--) {
+            __m512i na = _mm512_ror_epi32(c, 7), nb = _mm512_ror_epi32(a, 5), nc = _mm512_rol_epi32(b, 3);
+            a = _mm512_xor_si512(na, _mm512_set1_epi32(roundKeys[round][0]));
+            b = _mm512_xor_si512(nb, _mm512_set1_epi32(roundKeys[round][1]));
+            c = _mm512_xor_si512(nc, _mm512_set1_epi32(roundKeys[round][2]));
+        }
+        store16Blocks(out + i * THREE_WAY_BLOCK_SIZE, a, b, c);
+    }
+    decryptBlocksAVX2(in + i * THREE_WAY_BLOCK_SIZE, out + i * THREE_WAY_BLOCK_SIZE, blocks - i, roundKeys);
+}
+
+#pragma GCC diagnostic pop
+
+// ==================== ВЫБОР РЕАЛИЗАЦИИ ====================
+
+struct ThreeWayKernelVariant {
+    const char* name;
+    ThreeWayBlocksFunc encryptBlocks;
+    ThreeWayBlocksFunc decryptBlocks;
+};
+
+static const ThreeWayKernelVariant kernelVariants[] = {
+    {"avx512", encryptBlocksAVX512, decryptBlocksAVX512},
+    {"avx2",   encryptBlocksAVX2,   decryptBlocksAVX2},
+    {"sse4.1", encryptBlocksSSE41,  decryptBlocksSSE41},
+    {"scalar", encryptBlocksScalar, decryptBlocksScalar},
+};
+
+static bool variantSupported(const ThreeWayKernelVariant& variant) {
+    if (strcmp(variant.name, "avx512") == 0) {
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    }
+    if (strcmp(variant.name, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (strcmp(variant.name, "sse4.1") == 0) {
+        return __builtin_cpu_supports("sse4.1");
+    }
+    return true;
+}
+
+ThreeWayBlocksFunc threeWayEncryptBlocks = encryptBlocksScalar;
+ThreeWayBlocksFunc threeWayDecryptBlocks = decryptBlocksScalar;
+static const char* activeVariantName = "scalar";
+
+// Опрос CPUID выполняется один раз при dlopen библиотеки.
+// Переменная окружения THREEWAY_KERNEL позволяет принудительно выбрать
+// более узкую реализацию (например, для сравнения производительности).
+// Если процессор ее не поддерживает, берется лучшая из более узких;
+// неизвестное имя игнорируется с предупреждением.
+__attribute__((constructor))
+static void selectThreeWayKernel() {
+    __builtin_cpu_init();
+    const size_t count = sizeof(kernelVariants) / sizeof(kernelVariants[0]);
+    const char* forced = getenv("THREEWAY_KERNEL");
+    if (forced && *forced == '\0') forced = nullptr;
+
+    // Варианты упорядочены от самого широкого, поиск начинается с запрошенного
+    size_t first = 0;
+    if (forced) {
+        while (first < count && strcmp(forced, kernelVariants[first].name) != 0) first++;
+        if (first == count) {
+            fprintf(stderr, "THREEWAY_KERNEL=%s: неизвестная реализация "
+                            "(avx512, avx2, sse4.1, scalar), выбор по процессору\n", forced);
+            first = 0;
+            forced = nullptr;
+        }
+    }
+
+    for (size_t i = first; i < count; i++) {
+        const ThreeWayKernelVariant& variant = kernelVariants[i];
+        if (!variantSupported(variant)) continue;
+
+        if (forced && i != first) {
+            fprintf(stderr, "THREEWAY_KERNEL=%s: не поддерживается процессором, используется %s\n",
+                    forced, variant.name);
+        }
+        threeWayEncryptBlocks = variant.encryptBlocks;
+        threeWayDecryptBlocks = variant.decryptBlocks;
+        activeVariantName = variant.name;
+        return;
+    }
+}
+
+extern "C" {
+
+const char* threeway_kernel_variant() {
+    return activeVariantName;
+}
+
+} // extern "C"
@@ -0,0 +1,401 @@
+#include "../include/threeway_crypto.h"
+#include "../include/threeway_kernels.h"
+#include "../include/crypto_runtime.h"
+#include "../include/async_io.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// PMAC над 3-WAY. Каждый блок M_i маскируется смещением Δ_i и шифруется
+// независимо, результаты складываются XOR, поэтому порции сообщения
+// обрабатываются разными потоками, а частичные суммы объединяются в конце.
+//
+// Смещения строятся в GF(2^96) по модулю x^96 + x^10 + x^9 + x^6 + 1:
+//   L_* = E(0), L_$ = 2·L_*, L_0 = 2·L_$, L_j = 2·L_{j-1},
+//   Δ_i = Δ_{i-1} ⊕ L_ntz(i), то есть Δ_i — XOR L_j по битам кода Грея i,
+// и смещение начала любой порции вычисляется сразу, без прохода по предыдущим.
+// Тег: E(Σ ⊕ M_m ⊕ L_$) для полного последнего блока, E(Σ ⊕ pad(M_m)) — для неполного.
+
+// Число блоков в порции, обрабатываемой одной задачей (~1 МБ)
+const size_t MAC_CHUNK_BLOCKS = 87381;
+
+// Байт редукции x^10 + x^9 + x^6 + 1 (младшие байты блока)
+const uint8_t MAC_REDUCTION_HIGH = 0x06;
+const uint8_t MAC_REDUCTION_LOW = 0x41;
+
+// Константа для выработки ключа MAC из ключа шифрования
+const uint8_t MAC_KEY_LABEL[THREE_WAY_BLOCK_SIZE] = {'3', 'W', 'A', 'Y', '-', 'P', 'M', 'A', 'C', '-', 'K', '1'};
+
+struct PmacKey {
+    uint32_t roundKeys[THREE_WAY_ROUNDS][3];
+    uint8_t lStar[THREE_WAY_BLOCK_SIZE];
+    uint8_t lDollar[THREE_WAY_BLOCK_SIZE];
+    uint8_t l[64][THREE_WAY_BLOCK_SIZE];
+};
+
+// Умножение на x в GF(2^96), блок — big-endian число
+static void gfDouble(const uint8_t in[THREE_WAY_BLOCK_SIZE], uint8_t out[THREE_WAY_BLOCK_SIZE]) {
+    bool carry = in[0] & 0x80;
+    for (int i = 0; i < THREE_WAY_BLOCK_SIZE - 1; i++) {
+        out[i] = static_cast<uint8_t>((in[i] << 1) | (in[i + 1] >> 7));
+    }
+    out[THREE_WAY_BLOCK_SIZE - 1] = static_cast<uint8_t>(in[THREE_WAY_BLOCK_SIZE - 1] << 1);
+    if (carry) {
+        out[THREE_WAY_BLOCK_SIZE - 2] ^= MAC_REDUCTION_HIGH;
+        out[THREE_WAY_BLOCK_SIZE - 1] ^= MAC_REDUCTION_LOW;
+    }
+}
+
+static void xorBlock(uint8_t* dst, const uint8_t* src) {
+    for (int i = 0; i < THREE_WAY_BLOCK_SIZE; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+// Ключ MAC отделен от ключа шифрования: K_mac = E_K(метка)
+static void initPmacKey(const ThreeWayKeys& keys, PmacKey& mac) {
+    uint32_t cipherRoundKeys[THREE_WAY_ROUNDS][3];
+    generateRoundKeys(keys.key, cipherRoundKeys);
+
+    uint8_t derived[THREE_WAY_BLOCK_SIZE];
+    threeWayEncryptBlocks(MAC_KEY_LABEL, derived, 1, cipherRoundKeys);
+    uint32_t macKey[3];
+    packBytesToBlock(derived, macKey);
+    generateRoundKeys(macKey, mac.roundKeys);
+
+    uint8_t zero[THREE_WAY_BLOCK_SIZE] = {0};
+    threeWayEncryptBlocks(zero, mac.lStar, 1, mac.roundKeys);
+    gfDouble(mac.lStar, mac.lDollar);
+    gfDouble(mac.lDollar, mac.l[0]);
+    for (int j = 1; j < 64; j++) {
+        gfDouble(mac.l[j - 1], mac.l[j]);
+    }
+}
+
+// Смещение Δ_index (index >= 0, Δ_0 = 0)
+static void offsetAt(const PmacKey& mac, uint64_t index, uint8_t offset[THREE_WAY_BLOCK_SIZE]) {
+    memset(offset, 0, THREE_WAY_BLOCK_SIZE);
+    uint64_t gray = index ^ (index >> 1);
+    while (gray) {
+        xorBlock(offset, mac.l[__builtin_ctzll(gray)]);
+        gray &= gray - 1;
+    }
+}
+
+// Частичная сумма Σ по блокам с номерами firstIndex .. firstIndex + blocks - 1
+// (нумерация с 1); блоки шифруются векторным ядром одним вызовом.
+// scratch — не меньше blocks * THREE_WAY_BLOCK_SIZE байт.
+static void pmacSigmaBlocks(const PmacKey& mac, const uint8_t* data, uint64_t firstIndex, size_t blocks,
+                            uint8_t sigma[THREE_WAY_BLOCK_SIZE], uint8_t* scratch) {
+    if (blocks == 0) return;
+
+    uint8_t offset[THREE_WAY_BLOCK_SIZE];
+    offsetAt(mac, firstIndex - 1, offset);
+    for (size_t k = 0; k < blocks; k++) {
+        xorBlock(offset, mac.l[__builtin_ctzll(firstIndex + k)]);
+        uint8_t* masked = scratch + k * THREE_WAY_BLOCK_SIZE;
+        memcpy(masked, data + k * THREE_WAY_BLOCK_SIZE, THREE_WAY_BLOCK_SIZE);
+        xorBlock(masked, offset);
+    }
+
+    threeWayEncryptBlocks(scratch, scratch, blocks, mac.roundKeys);
+
+    uint32_t acc[3] = {0, 0, 0};
+    for (size_t k = 0; k < blocks; k++) {
+        uint32_t words[3];
+        memcpy(words, scratch + k * THREE_WAY_BLOCK_SIZE, THREE_WAY_BLOCK_SIZE);
+        acc[0] ^= words[0];
+        acc[1] ^= words[1];
+        acc[2] ^= words[2];
+    }
+    uint8_t accBytes[THREE_WAY_BLOCK_SIZE];
+    memcpy(accBytes, acc, THREE_WAY_BLOCK_SIZE);
+    xorBlock(sigma, accBytes);
+}
+
+// Обработка последнего блока (lastLen от 0 до 12) и выработка тега
+static void pmacFinish(const PmacKey& mac, uint8_t sigma[THREE_WAY_BLOCK_SIZE],
+                       const uint8_t* last, size_t lastLen, uint8_t tag[THREE_WAY_BLOCK_SIZE]) {
+    if (lastLen == THREE_WAY_BLOCK_SIZE) {
+        xorBlock(sigma, last);
+        xorBlock(sigma, mac.lDollar);
+    } else {
+        uint8_t padded[THREE_WAY_BLOCK_SIZE] = {0};
+        if (lastLen > 0) memcpy(padded, last, lastLen);
+        padded[lastLen] = 0x80;
+        xorBlock(sigma, padded);
+    }
+    threeWayEncryptBlocks(sigma, tag, 1, mac.roundKeys);
+}
+
+ThreeWayTag macThreeWay(span<const uint8_t> data, const ThreeWayKeys& keys, size_t threads) {
+    PmacKey mac;
+    initPmacKey(keys, mac);
+
+    // Последний блок (возможно неполный или пустой) обрабатывается отдельно
+    size_t blocks = data.empty() ? 0 : (data.size() - 1) / THREE_WAY_BLOCK_SIZE;
+    size_t chunks = (blocks + MAC_CHUNK_BLOCKS - 1) / MAC_CHUNK_BLOCKS;
+    vector<ThreeWayTag> sigmas(chunks, ThreeWayTag{});
+
+    // Порции блоков — на общем пуле; рабочий буфер — из арены потока
+    parallelForRange(blocks, MAC_CHUNK_BLOCKS, threads, [&](size_t first, size_t end) {
+        ScratchScope scratch;
+        uint8_t* buffer = scratch.allocate((end - first) * THREE_WAY_BLOCK_SIZE);
+        pmacSigmaBlocks(mac, data.data() + first * THREE_WAY_BLOCK_SIZE, first + 1, end - first,
+                        sigmas[first / MAC_CHUNK_BLOCKS].data(), buffer);
+    });
+
+    uint8_t sigma[THREE_WAY_BLOCK_SIZE] = {0};
+    for (const ThreeWayTag& partial : sigmas) {
+        xorBlock(sigma, partial.data());
+    }
+    ThreeWayTag tag;
+    pmacFinish(mac, sigma, data.data() + blocks * THREE_WAY_BLOCK_SIZE,
+               data.size() - blocks * THREE_WAY_BLOCK_SIZE, tag.data());
+    return tag;
+}
+
+// Сравнение тегов за постоянное время
+static bool tagsEqual(const uint8_t* a, const uint8_t* b) {
+    uint8_t diff = 0;
+    for (int i = 0; i < THREE_WAY_BLOCK_SIZE; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+// Проход по шифртексту файла порциями на пуле потоков.
+// Каждая порция читается из inFd по своему смещению, передается
+// в transform (шифрует или расшифровывает на месте) и учитывается в MAC.
+// macBeforeTransform указывает, взят ли шифртекст до преобразования
+// (дешифрование) или после (шифрование). Без transform и outFd
+// выполняется только проверка.
+struct AuthenticatedPass {
+    const PmacKey* mac;
+    int inFd;
+    int outFd;
+    uint64_t inputSize;     // байт входных данных
+    uint64_t blocks;        // блоков шифртекста (все полные, с дополнением)
+    bool macBeforeTransform;
+    const uint32_t (*roundKeys)[3];
+    ThreeWayBlocksFunc transform;
+};
+
+static ThreeWayTag runAuthenticatedPass(const AuthenticatedPass& pass, size_t threads) {
+    size_t chunks = static_cast<size_t>((pass.blocks + MAC_CHUNK_BLOCKS - 1) / MAC_CHUNK_BLOCKS);
+    vector<ThreeWayTag> sigmas(chunks, ThreeWayTag{});
+    uint8_t lastBlock[THREE_WAY_BLOCK_SIZE] = {0};
+
+    {
+        TaskGroup group(threads);
+        for (size_t c = 0; c < chunks; c++) {
+            group.run([&pass, &sigmas, &lastBlock, c] {
+                uint64_t first = static_cast<uint64_t>(c) * MAC_CHUNK_BLOCKS;
+                size_t count = static_cast<size_t>(min<uint64_t>(MAC_CHUNK_BLOCKS, pass.blocks - first));
+                uint64_t offset = first * THREE_WAY_BLOCK_SIZE;
+                size_t bytes = count * THREE_WAY_BLOCK_SIZE;
+                size_t available = static_cast<size_t>(min<uint64_t>(bytes, pass.inputSize - offset));
+
+                // Порция и рабочий буфер MAC — из арены потока.
+                // Последний блок открытого текста дополняется, как на
+                // остальных путях 3-WAY (padThreeWayBlock).
+                ScratchScope scratch;
+                uint8_t* chunk = scratch.allocate(bytes);
+                preadFull(pass.inFd, chunk, available, offset);
+                if (available < bytes) {
+                    uint8_t* tail = chunk + bytes - THREE_WAY_BLOCK_SIZE;
+                    uint8_t padded[THREE_WAY_BLOCK_SIZE];
+                    padThreeWayBlock(tail, available - (bytes - THREE_WAY_BLOCK_SIZE), padded);
+                    memcpy(tail, padded, THREE_WAY_BLOCK_SIZE);
+                }
+
+                if (pass.transform && !pass.macBeforeTransform) {
+                    pass.transform(chunk, chunk, count, pass.roundKeys);
+                }
+                bool last = first + count == pass.blocks;
+                pmacSigmaBlocks(*pass.mac, chunk, first + 1, last ? count - 1 : count,
+                                sigmas[c].data(), scratch.allocate(bytes));
+                if (last) {
+                    memcpy(lastBlock, chunk + bytes - THREE_WAY_BLOCK_SIZE, THREE_WAY_BLOCK_SIZE);
+                }
+                if (pass.transform && pass.macBeforeTransform) {
+                    pass.transform(chunk, chunk, count, pass.roundKeys);
+                }
+                if (pass.outFd >= 0) {
+                    pwriteFull(pass.outFd, chunk, bytes, offset);
+                }
+            });
+        }
+        group.wait();
+    }
+
+    uint8_t sigma[THREE_WAY_BLOCK_SIZE] = {0};
+    for (const ThreeWayTag& partial : sigmas) {
+        xorBlock(sigma, partial.data());
+    }
+    ThreeWayTag tag;
+    pmacFinish(*pass.mac, sigma, lastBlock, pass.blocks > 0 ? THREE_WAY_BLOCK_SIZE : 0, tag.data());
+    return tag;
+}
+
+static int openForRead(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw runtime_error("Не удалось открыть входной файл: " + path);
+    }
+    return fd;
+}
+
+static int openForWrite(const string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw runtime_error("Не удалось создать выходной файл: " + path);
+    }
+    return fd;
+}
+
+// Временный файл в каталоге path: rename на path затем атомарен
+static int openTemporaryFor(const string& path, string& tempPath) {
+    tempPath = path + ".XXXXXX";
+    int fd = mkostemp(&tempPath[0], O_CLOEXEC);
+    if (fd < 0 || fchmod(fd, 0644) != 0) {
+        if (fd >= 0) {
+            close(fd);
+            unlink(tempPath.c_str());
+        }
+        throw runtime_error("Не удалось создать выходной файл: " + path);
+    }
+    return fd;
+}
+
+static uint64_t fileSize(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        throw runtime_error(string("Не удалось определить размер файла: ") + strerror(errno));
+    }
+    return static_cast<uint64_t>(st.st_size);
+}
+
+// Шифрование с последующей выработкой MAC по шифртексту (encrypt-then-MAC);
+// тег дописывается в конец файла
+void encryptFileThreeWayAuthenticated(const string& inputFile, const string& outputFile,
+                                      const ThreeWayKeys& keys, size_t threads) {
+    PmacKey mac;
+    initPmacKey(keys, mac);
+    uint32_t roundKeys[THREE_WAY_ROUNDS][3];
+    generateRoundKeys(keys.key, roundKeys);
+
+    FileDescriptor in(openForRead(inputFile));
+    uint64_t size = fileSize(in.get());
+    FileDescriptor out(openForWrite(outputFile));
+
+    AuthenticatedPass pass;
+    pass.mac = &mac;
+    pass.inFd = in.get();
+    pass.outFd = out.get();
+    pass.inputSize = size;
+    pass.blocks = requiredSizeThreeWay(size) / THREE_WAY_BLOCK_SIZE;
+    pass.macBeforeTransform = false;
+    pass.roundKeys = roundKeys;
+    pass.transform = threeWayEncryptBlocks;
+
+    ThreeWayTag tag = runAuthenticatedPass(pass, threads);
+    pwriteFull(out.get(), tag.data(), tag.size(), pass.blocks * THREE_WAY_BLOCK_SIZE);
+}
+
+// Проверка тега совмещена с расшифровкой в одном параллельном проходе;
+// при несовпадении выходной файл удаляется. Дополнение снимается
+// усечением временного файла после проверки тега.
+void decryptFileThreeWayAuthenticated(const string& inputFile, const string& outputFile,
+                                      const ThreeWayKeys& keys, size_t threads) {
+    PmacKey mac;
+    initPmacKey(keys, mac);
+    uint32_t roundKeys[THREE_WAY_ROUNDS][3];
+    generateRoundKeys(keys.key, roundKeys);
+
+    FileDescriptor in(openForRead(inputFile));
+    uint64_t size = fileSize(in.get());
+    if (size < THREE_WAY_MAC_SIZE + THREE_WAY_BLOCK_SIZE ||
+        (size - THREE_WAY_MAC_SIZE) % THREE_WAY_BLOCK_SIZE != 0) {
+        throw runtime_error("Неверный размер файла с тегом 3-WAY");
+    }
+    uint64_t dataSize = size - THREE_WAY_MAC_SIZE;
+
+    ThreeWayTag stored;
+    preadFull(in.get(), stored.data(), stored.size(), dataSize);
+
+    // Открытый текст пишется во временный файл и появляется под именем
+    // outputFile только после проверки тега
+    string tempFile;
+    FileDescriptor out(openTemporaryFor(outputFile, tempFile));
+    try {
+        AuthenticatedPass pass;
+        pass.mac = &mac;
+        pass.inFd = in.get();
+        pass.outFd = out.get();
+        pass.inputSize = dataSize;
+        pass.blocks = dataSize / THREE_WAY_BLOCK_SIZE;
+        pass.macBeforeTransform = true;
+        pass.roundKeys = roundKeys;
+        pass.transform = threeWayDecryptBlocks;
+        ThreeWayTag computed = runAuthenticatedPass(pass, threads);
+        if (!tagsEqual(stored.data(), computed.data())) {
+            throw runtime_error("Проверка целостности не пройдена: файл поврежден или ключ неверен");
+        }
+
+        uint8_t lastBlock[THREE_WAY_BLOCK_SIZE];
+        preadFull(out.get(), lastBlock, THREE_WAY_BLOCK_SIZE, dataSize - THREE_WAY_BLOCK_SIZE);
+        size_t padding = threeWayPaddingLength(lastBlock);
+        if (padding == 0) {
+            throw runtime_error("Неверное дополнение 3-WAY: файл записан в другом формате");
+        }
+        if (ftruncate(out.get(), static_cast<off_t>(dataSize - padding)) != 0) {
+            throw runtime_error(string("Ошибка усечения файла: ") + strerror(errno));
+        }
+    } catch (...) {
+        unlink(tempFile.c_str());
+        throw;
+    }
+
+    if (rename(tempFile.c_str(), outputFile.c_str()) != 0) {
+        int error = errno;
+        unlink(tempFile.c_str());
+        throw runtime_error("Не удалось создать выходной файл: " + outputFile + ": " + strerror(error));
+    }
+}
+
+// Проверка тега без записи открытого текста
+bool verifyFileThreeWay(const string& file, const ThreeWayKeys& keys, size_t threads) {
+    PmacKey mac;
+    initPmacKey(keys, mac);
+
+    FileDescriptor in(openForRead(file));
+    uint64_t size = fileSize(in.get());
+    if (size < THREE_WAY_MAC_SIZE + THREE_WAY_BLOCK_SIZE ||
+        (size - THREE_WAY_MAC_SIZE) % THREE_WAY_BLOCK_SIZE != 0) {
+        return false;
+    }
+    uint64_t blocks = (size - THREE_WAY_MAC_SIZE) / THREE_WAY_BLOCK_SIZE;
+
+    ThreeWayTag stored;
+    preadFull(in.get(), stored.data(), stored.size(), blocks * THREE_WAY_BLOCK_SIZE);
+
+    AuthenticatedPass pass;
+    pass.mac = &mac;
+    pass.inFd = in.get();
+    pass.outFd = -1;
+    pass.inputSize = blocks * THREE_WAY_BLOCK_SIZE;
+    pass.blocks = blocks;
+    pass.macBeforeTransform = true;
+    pass.roundKeys = nullptr;
+    pass.transform = nullptr;
+    ThreeWayTag computed = runAuthenticatedPass(pass, threads);
+    return tagsEqual(stored.data(), computed.data());
+}